@@ -0,0 +1 @@
+../../../reference/src/examples/consistency_example.c
\ No newline at end of file
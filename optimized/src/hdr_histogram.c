@@ -0,0 +1 @@
+../../reference/src/hdr_histogram.c
\ No newline at end of file
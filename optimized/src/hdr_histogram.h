@@ -0,0 +1 @@
+../../reference/src/hdr_histogram.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../reference/src/kem_latency.c
\ No newline at end of file
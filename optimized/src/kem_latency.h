@@ -0,0 +1 @@
+../../reference/src/kem_latency.h
\ No newline at end of file
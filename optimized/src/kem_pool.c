@@ -0,0 +1 @@
+../../reference/src/kem_pool.c
\ No newline at end of file
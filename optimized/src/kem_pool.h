@@ -0,0 +1 @@
+../../reference/src/kem_pool.h
\ No newline at end of file
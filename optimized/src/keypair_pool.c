@@ -0,0 +1 @@
+../../reference/src/keypair_pool.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../reference/src/keypair_pool.h
\ No newline at end of file
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the autotuner of the engines of the products with __A__.
+ *
+ * The engines chosen are remembered in a small table, per shape of the
+ * product and backend, of which the entries are claimed and read atomically.
+ * Threads that tune the same shape concurrently may each time the engines,
+ * the first one to claim an entry decides.
+ *
+ * @endcond
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pst_autotune.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pst_backend.h"
+
+/** The number of times each engine is timed, the fastest time counts */
+#define AUTOTUNE_RUNS 3
+
+/** The number of shapes of which the chosen engine is remembered */
+#define AUTOTUNE_SLOTS 128
+
+/** Flag of the entries of the table that are in use (bits 0 and 1 hold the engine) */
+#define AUTOTUNE_USED 4U
+
+/** The bits of the entries of the table that hold the engine */
+#define AUTOTUNE_ENGINE 3U
+
+/** The number of bits of the entries of the table below the key */
+#define AUTOTUNE_KEY_SHIFT 3
+
+/**
+ * The engines timed by the autotuner. The merged engine has not been faster
+ * than the sparse one for any of the parameter sets on any of the backends,
+ * so it is only used when set with `ROUND2_ENGINE`.
+ */
+#define AUTOTUNE_CANDIDATES (PST_ENGINE_BIT(PST_ENGINE_SPARSE) | PST_ENGINE_BIT(PST_ENGINE_DENSE))
+
+/** Value of `forced_engine` before `ROUND2_ENGINE` has been read */
+#define ENGINE_UNSET -1
+
+/** Value of `forced_engine` if the engine is chosen by the autotuner */
+#define ENGINE_AUTO 3
+
+/** The engines chosen, as `key << AUTOTUNE_KEY_SHIFT | AUTOTUNE_USED | engine` (accessed atomically) */
+static uint64_t tuned[AUTOTUNE_SLOTS];
+
+/** The engine set by `ROUND2_ENGINE`, if any (accessed atomically) */
+static int forced_engine = ENGINE_UNSET;
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/**
+ * Determines the engine set with the environment variable `ROUND2_ENGINE`.
+ *
+ * @return the engine, or `ENGINE_AUTO` if it is to be chosen by the
+ *         autotuner
+ */
+static int engine_override(void) {
+    int forced = __atomic_load_n(&forced_engine, __ATOMIC_ACQUIRE);
+
+    if (forced == ENGINE_UNSET) {
+        const char *name = getenv("ROUND2_ENGINE");
+        forced = ENGINE_AUTO;
+        if (name != NULL && *name != '\0') {
+            if (strcmp(name, "sparse") == 0) {
+                forced = PST_ENGINE_SPARSE;
+            } else if (strcmp(name, "dense") == 0) {
+                forced = PST_ENGINE_DENSE;
+            } else if (strcmp(name, "merged") == 0) {
+                forced = PST_ENGINE_MERGED;
+            } else if (strcmp(name, "auto") != 0) {
+                fprintf(stderr, "Engine %s (ROUND2_ENGINE) is not available, using the autotuner\n", name);
+            }
+        }
+        __atomic_store_n(&forced_engine, forced, __ATOMIC_RELEASE);
+    }
+
+    return forced;
+}
+
+/**
+ * Determines the index of the backend in use.
+ *
+ * @return the index of the backend
+ */
+static uint64_t backend_index(void) {
+    const pst_backend *backend = pst_backend_get();
+    size_t i;
+
+    for (i = 0; i < pst_nr_backends(); ++i) {
+        if (pst_backend_at(i) == backend) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/**
+ * Times the computation of a product with an engine.
+ *
+ * @param[in] engine   the engine
+ * @param[in] product  computes the product with an engine
+ * @param[in] context  the product, passed to _product_
+ * @return the fastest of `AUTOTUNE_RUNS` runs, in nanoseconds
+ */
+static uint64_t time_engine(const pst_engine engine, pst_engine_product product, void *context) {
+    uint64_t fastest = UINT64_MAX;
+    struct timespec start, stop;
+    int run;
+
+    for (run = 0; run < AUTOTUNE_RUNS; ++run) {
+        uint64_t elapsed;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        product(engine, context);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        elapsed = (uint64_t) (stop.tv_sec - start.tv_sec) * 1000000000U + (uint64_t) stop.tv_nsec - (uint64_t) start.tv_nsec;
+        if (elapsed < fastest) {
+            fastest = elapsed;
+        }
+    }
+
+    return fastest;
+}
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+pst_engine pst_autotune_engine(const uint16_t d, const uint16_t h, const uint16_t nr_vectors, const uint8_t variant, const unsigned engines, pst_engine_product product, void *context) {
+    const int forced = engine_override();
+    const uint64_t key = (uint64_t) d | (uint64_t) h << 16 | (uint64_t) (nr_vectors & 0xff) << 32 | (uint64_t) (variant & 0xf) << 40 | (backend_index() & 0xff) << 44;
+    uint64_t entry;
+    uint64_t fastest = UINT64_MAX;
+    pst_engine engine = PST_ENGINE_SPARSE;
+    int candidate;
+    size_t i;
+
+    if (forced != ENGINE_AUTO) {
+        return engines & PST_ENGINE_BIT(forced) ? (pst_engine) forced : PST_ENGINE_SPARSE;
+    }
+
+    /* Look up the shape */
+    for (i = 0; i < AUTOTUNE_SLOTS; ++i) {
+        entry = __atomic_load_n(&tuned[i], __ATOMIC_ACQUIRE);
+        if (entry == 0) {
+            break;
+        }
+        if (entry >> AUTOTUNE_KEY_SHIFT == key) {
+            return (pst_engine) (entry & AUTOTUNE_ENGINE);
+        }
+    }
+
+    /* Not tuned yet: time the engines */
+    for (candidate = PST_ENGINE_SPARSE; candidate <= PST_ENGINE_MERGED; ++candidate) {
+        if (engines & AUTOTUNE_CANDIDATES & PST_ENGINE_BIT(candidate)) {
+            const uint64_t elapsed = time_engine((pst_engine) candidate, product, context);
+            if (elapsed < fastest) {
+                fastest = elapsed;
+                engine = (pst_engine) candidate;
+            }
+        }
+    }
+
+    /* Remember the engine (unless the table is full or the shape has been
+     * tuned concurrently) */
+    entry = key << AUTOTUNE_KEY_SHIFT | AUTOTUNE_USED | (uint64_t) engine;
+    for (; i < AUTOTUNE_SLOTS; ++i) {
+        uint64_t expected = 0;
+        if (__atomic_compare_exchange_n(&tuned[i], &expected, entry, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        if (expected >> AUTOTUNE_KEY_SHIFT == key) {
+            return (pst_engine) (expected & AUTOTUNE_ENGINE);
+        }
+    }
+
+    return engine;
+}
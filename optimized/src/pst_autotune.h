@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Declaration of the autotuner of the engines of the products with __A__.
+ *
+ * The products of `compute_B` and `compute_U` can be computed by several
+ * engines: the sparse one, which works with the secret vectors in index form
+ * and gathers _h_ coefficients of __A__ per output and vector, the merged
+ * one, which merges the indices of all vectors into a single ascending
+ * stream, so that __A__ is read in one monotone sweep for all vectors, and
+ * (for `compute_B`) the dense one, which multiplies the rows of __A__, read
+ * contiguously, with the vectors in dense form. Which of the sparse and
+ * the dense one is faster depends on the parameter set and on the cpu (and
+ * the backend in use), so the autotuner times them on the first product of
+ * each shape and uses the fastest one from then on. The merged engine has not
+ * been found faster than the sparse one, so it is not timed; it is only used
+ * when set with the environment variable `ROUND2_ENGINE` (`sparse`,
+ * `merged`, `dense` or `auto`, the default), which overrides the choice.
+ * All engines give bit-identical results.
+ *
+ * @endcond
+ */
+
+#ifndef PST_AUTOTUNE_H
+#define PST_AUTOTUNE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * The engines of the products with __A__.
+     */
+    typedef enum {
+        PST_ENGINE_SPARSE = 0, /**< The vectors in index form, gathering the coefficients of __A__ */
+        PST_ENGINE_DENSE = 1, /**< The vectors in dense form, reading the rows of __A__ contiguously */
+        PST_ENGINE_MERGED = 2 /**< The indices of all vectors merged into one stream, reading __A__ in one sweep */
+    } pst_engine;
+
+    /**
+     * The bit of an engine in a set of engines.
+     *
+     * @param[in] engine the engine
+     * @return the bit of the engine
+     */
+#define PST_ENGINE_BIT(engine) (1U << (engine))
+
+    /**
+     * Computes a product with the given engine, for the autotuner. The result
+     * must be the same for all engines, the product must not have any other
+     * effect.
+     *
+     * @param[in] engine   the engine to use
+     * @param[in] context  the product to compute
+     */
+    typedef void (*pst_engine_product)(const pst_engine engine, void *context);
+
+    /**
+     * Determines the engine to use for a product of the given shape. On the
+     * first call for a shape (with the backend in use) the engines that can
+     * compute it, other than the merged one, are timed on the product
+     * itself, i.e. the product is computed a few times with each of them.
+     * An engine set with `ROUND2_ENGINE` that cannot compute the product is
+     * replaced by the sparse one, which can compute all of them.
+     *
+     * @param[in] d           the dimension of the matrix
+     * @param[in] h           the hamming weight of the vectors
+     * @param[in] nr_vectors  the number of vectors
+     * @param[in] variant     the variant of the product (at most 4 bits)
+     * @param[in] engines     the engines that can compute the product (`PST_ENGINE_BIT`s)
+     * @param[in] product     computes the product with an engine
+     * @param[in] context     the product, passed to _product_
+     * @return the engine to use
+     */
+    pst_engine pst_autotune_engine(const uint16_t d, const uint16_t h, const uint16_t nr_vectors, const uint8_t variant, const unsigned engines, pst_engine_product product, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PST_AUTOTUNE_H */
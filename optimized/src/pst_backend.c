@@ -0,0 +1,1246 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the compute backends of the core functions.
+ *
+ * The kernels are written once, as generic (always inlined) functions: a
+ * scalar version, used by the portable backend and the reference for the
+ * others, and (for GCC and Clang) a version on the vector extensions of the
+ * compiler (`vector_size`), which the compiler maps onto the registers of the
+ * instruction set it generates code for. Each backend consists of small
+ * wrappers around these, compiled with its own target attributes, so that
+ * the code for the instruction set of the backend is generated from the same
+ * source.
+ *
+ * @endcond
+ */
+
+#include "pst_backend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "misc.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/** Indicates that the x86 backends (for specific instruction sets) are built */
+#define PST_BACKEND_X86
+#include <immintrin.h>
+#endif
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/**
+ * The generic version of `pst_backend.mult_rows_idx`, see there for the
+ * parameters. Called with a constant number of vectors and hamming weight it
+ * is inlined into a specialised version for that shape.
+ */
+static ALWAYS_INLINE void mult_rows_idx_generic(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *idx, const size_t nr_rows, const uint16_t nr_vectors, const uint16_t h, const uint16_t mod_mask) {
+    size_t i;
+    uint16_t j, l;
+
+    for (i = 0; i < nr_rows; ++i) {
+        const uint16_t *row = A + row_displacements[i];
+        for (j = 0; j < nr_vectors; ++j) {
+            const uint16_t *vec_idx = idx + j * h;
+            uint16_t acc = 0;
+            for (l = 0; l < h / 2; ++l) { /* Positions where the vector is 1 */
+                acc = (uint16_t) (acc + row[vec_idx[l]]);
+            }
+            for (l = h / 2; l < h; ++l) { /* Positions where the vector is -1 */
+                acc = (uint16_t) (acc - row[vec_idx[l]]);
+            }
+            *result++ = acc & mod_mask;
+        }
+    }
+}
+
+/**
+ * The shapes (number of vectors, hamming weight) of the products in the
+ * parameter sets of `api_to_internal_parameters.h`. For these the
+ * `mult_rows_idx` kernel of the backends (except the portable one) uses a
+ * version specialised for the shape, in which the loops have constant
+ * bounds.
+ */
+#define MULT_ROWS_IDX_SHAPES(X) \
+    X(1, 62) X(1, 66) X(1, 72) X(1, 74) X(1, 78) X(1, 88) X(1, 96) \
+    X(1, 104) X(1, 108) X(1, 112) X(1, 120) X(1, 130) X(1, 140) \
+    X(5, 74) X(6, 114) X(6, 126) X(7, 74) X(8, 110) X(8, 114) X(8, 116) \
+    X(8, 126) X(8, 156) X(8, 166) X(10, 156) X(10, 166)
+
+/** Calls the version of the kernel specialised for the given shape if it matches */
+#define MULT_ROWS_IDX_SPECIALISED(vectors, weight) \
+    if (nr_vectors == (vectors) && h == (weight)) { \
+        mult_rows_idx_generic(result, A, row_displacements, idx, nr_rows, vectors, weight, mod_mask); \
+        return; \
+    }
+
+/**
+ * Determines the start of a row within A_master for
+ * `pst_backend.accumulate_windows`.
+ *
+ * @param[in] row_displacements  the start of each row, or `NULL` if row _r_
+ *                               starts at _r_
+ * @param[in] r                  the row
+ * @return the start of the row
+ */
+static ALWAYS_INLINE size_t row_start(const uint32_t *row_displacements, const uint16_t r) {
+    return row_displacements != NULL ? row_displacements[r] : r;
+}
+
+/**
+ * The generic version of `pst_backend.accumulate_windows`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void accumulate_windows_generic(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint16_t *idx, const uint16_t h, const size_t offset, const size_t width) {
+    size_t k;
+    uint16_t l;
+
+    memset(acc, 0, width * sizeof (*acc));
+    for (l = 0; l < h / 2; ++l) { /* Rows where the vector is 1 */
+        const uint16_t *window = A_master + row_start(row_displacements, idx[l]) + offset;
+        for (k = 0; k < width; ++k) {
+            acc[k] = (uint16_t) (acc[k] + window[k]);
+        }
+    }
+    for (l = h / 2; l < h; ++l) { /* Rows where the vector is -1 */
+        const uint16_t *window = A_master + row_start(row_displacements, idx[l]) + offset;
+        for (k = 0; k < width; ++k) {
+            acc[k] = (uint16_t) (acc[k] - window[k]);
+        }
+    }
+}
+
+/**
+ * The generic version of `pst_backend.mult_sampled_idx`, see there for the
+ * parameters. The columns of a row of M are read contiguously, so the inner
+ * loop vectorises.
+ */
+static ALWAYS_INLINE void mult_sampled_idx_generic(uint16_t *X, const size_t x_stride, const uint16_t *M, const uint16_t vectors_M, const uint16_t *idx, const uint16_t h, const size_t nr_cols) {
+    size_t c;
+    uint16_t k;
+
+    for (k = 0; k < h / 2; ++k) { /* Rows where the vector is 1 */
+        const uint16_t *row = M + (size_t) idx[k] * vectors_M;
+        for (c = 0; c < nr_cols; ++c) {
+            X[c * x_stride] = (uint16_t) (X[c * x_stride] + row[c]);
+        }
+    }
+    for (k = h / 2; k < h; ++k) { /* Rows where the vector is -1 */
+        const uint16_t *row = M + (size_t) idx[k] * vectors_M;
+        for (c = 0; c < nr_cols; ++c) {
+            X[c * x_stride] = (uint16_t) (X[c * x_stride] - row[c]);
+        }
+    }
+}
+
+/**
+ * The generic version of `pst_backend.mult_rows_dense`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void mult_rows_dense_generic(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *vectors, const size_t nr_rows, const uint16_t nr_vectors, const size_t len, const uint16_t mod_mask) {
+    size_t i, k;
+    uint16_t j;
+
+    for (i = 0; i < nr_rows; ++i) {
+        const uint16_t *row = A + row_displacements[i];
+        for (j = 0; j < nr_vectors; ++j) {
+            const uint16_t *vector = vectors + j * len;
+            uint16_t acc = 0;
+            for (k = 0; k < len; ++k) {
+                acc = (uint16_t) (acc + (uint32_t) row[k] * vector[k]);
+            }
+            *result++ = acc & mod_mask;
+        }
+    }
+}
+
+/**
+ * The generic version of `pst_backend.mult_rows_merged`, see there for the
+ * parameters. The sums are kept in the result row.
+ */
+static ALWAYS_INLINE void mult_rows_merged_generic(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const size_t nr_rows, const uint16_t nr_vectors, const uint16_t mod_mask) {
+    size_t i, e;
+    uint16_t j;
+
+    for (i = 0; i < nr_rows; ++i) {
+        const uint16_t *row = A + row_displacements[i];
+        memset(result, 0, nr_vectors * sizeof (*result));
+        for (e = 0; e < nr_entries; ++e) {
+            const uint32_t entry = merged[e];
+            const uint16_t negative = (uint16_t) (0U - PST_MERGED_NEGATIVE(entry));
+            uint16_t *sum = result + PST_MERGED_VECTOR(entry);
+            *sum = (uint16_t) (*sum + (uint16_t) ((row[PST_MERGED_INDEX(entry)] ^ negative) - negative));
+        }
+        for (j = 0; j < nr_vectors; ++j) {
+            result[j] &= mod_mask;
+        }
+        result += nr_vectors;
+    }
+}
+
+/**
+ * The generic version of `pst_backend.accumulate_windows_merged`, see there
+ * for the parameters.
+ */
+static ALWAYS_INLINE void accumulate_windows_merged_generic(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const uint16_t nr_vectors, const size_t offset, const size_t width) {
+    size_t e, k;
+
+    memset(acc, 0, 2 * nr_vectors * width * sizeof (*acc));
+    for (e = 0; e < nr_entries; ++e) {
+        const uint32_t entry = merged[e];
+        const uint16_t *window = A_master + row_start(row_displacements, PST_MERGED_INDEX(entry)) + offset;
+        uint16_t *sum = acc + PST_MERGED_SUM(entry) * width;
+        for (k = 0; k < width; ++k) {
+            sum[k] = (uint16_t) (sum[k] + window[k]);
+        }
+    }
+}
+
+/**
+ * The scalar part of `pst_backend.unlift_poly`: computes the coefficients
+ * before `end` as the suffix sums of the NTRU polynomial.
+ *
+ * @param[out] cyc_pol   result
+ * @param[in]  ntru_pol  polynomial in the NTRU ring
+ * @param[in]  end       the number of coefficients still to compute
+ * @param[in]  carry     the sum of the coefficients of ntru_pol after `end`
+ * @param[in]  mod_mask  reduction modulus bitmask for the coefficients
+ */
+static ALWAYS_INLINE void unlift_poly_scalar(uint16_t *cyc_pol, const uint16_t *ntru_pol, size_t end, uint16_t carry, const uint16_t mod_mask) {
+    while (end > 0) {
+        carry = (uint16_t) (carry + ntru_pol[end]);
+        cyc_pol[--end] = carry & mod_mask;
+    }
+}
+
+/**
+ * The generic version of `pst_backend.unlift_poly_sessions`, see there for
+ * the parameters.
+ */
+static ALWAYS_INLINE void unlift_poly_sessions_generic(uint16_t *cyc_pols, const size_t cyc_stride, const uint16_t *ntru_pols, const size_t ntru_stride, const size_t nr_sessions, const size_t len, const uint16_t mod_mask) {
+    size_t s;
+
+    for (s = 0; s < nr_sessions; ++s) {
+        unlift_poly_scalar(cyc_pols + s * cyc_stride, ntru_pols + s * ntru_stride, len, 0, mod_mask);
+    }
+}
+
+/**
+ * The generic version of `pst_backend.lift_poly`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void lift_poly_generic(uint16_t *restrict ntru_rev, const uint16_t *restrict cyc_pol, const size_t len, const uint16_t mod_mask) {
+    uint16_t *restrict ntru_rev_dup = ntru_rev + len + 1;
+    size_t i;
+
+    ntru_rev[0] = ntru_rev_dup[0] = (uint16_t) (-cyc_pol[0]) & mod_mask;
+    ntru_rev[1] = ntru_rev_dup[1] = cyc_pol[len - 1] & mod_mask;
+    for (i = 2; i <= len; ++i) {
+        const uint16_t coeff = (uint16_t) (cyc_pol[len - i] - cyc_pol[len + 1 - i]) & mod_mask;
+        ntru_rev[i] = coeff;
+        ntru_rev_dup[i] = coeff;
+    }
+}
+
+/**
+ * Lifts coefficients _first..end - 1_ of one of the sessions of
+ * `pst_backend.lift_poly_sessions`, see there for the parameters.
+ *
+ * @param[out] ntru_lane    the lane of the session in the interleaved results
+ * @param[in]  cyc_pol      the polynomial of the session in the cyclotomic ring
+ * @param[in]  nr_sessions  the number of sessions
+ * @param[in]  first        the first coefficient to lift
+ * @param[in]  end          the coefficient after the last one to lift
+ * @param[in]  len          number of coefficients of the cyclotomic polynomial
+ * @param[in]  mod_mask     reduction modulus bitmask for the coefficients
+ */
+static ALWAYS_INLINE void lift_poly_lane(uint16_t *ntru_lane, const uint16_t *cyc_pol, const size_t nr_sessions, const size_t first, const size_t end, const size_t len, const uint16_t mod_mask) {
+    size_t i;
+
+    for (i = first; i < end; ++i) {
+        ntru_lane[i * nr_sessions] = (uint16_t) (i == 0 ? -cyc_pol[0] : i == 1 ? cyc_pol[len - 1] : cyc_pol[len - i] - cyc_pol[len + 1 - i]) & mod_mask;
+    }
+}
+
+/**
+ * The generic version of `pst_backend.lift_poly_sessions`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void lift_poly_sessions_generic(uint16_t *ntru_revs, const uint16_t *cyc_pols, const size_t cyc_stride, const size_t nr_sessions, const size_t len, const uint16_t mod_mask) {
+    size_t s;
+
+    for (s = 0; s < nr_sessions; ++s) {
+        lift_poly_lane(ntru_revs + s, cyc_pols + s * cyc_stride, nr_sessions, 0, len + 1, len, mod_mask);
+    }
+}
+
+/**
+ * The generic version of `pst_backend.compress`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void compress_generic(uint16_t *x, const size_t len, const uint16_t a, const uint16_t b) {
+    const uint16_t shift = (uint16_t) (a - b);
+    const uint16_t rounding_mask = (uint16_t) (1 << (shift - 1));
+    const uint16_t mask_b = (uint16_t) (((uint16_t) 1 << b) - 1);
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        const uint16_t rounding = (uint16_t) ((x[i] & rounding_mask) >> (shift - 1));
+        x[i] = (uint16_t) ((uint16_t) ((x[i] >> shift) + rounding) & mask_b);
+    }
+}
+
+/**
+ * The generic version of `pst_backend.decompress`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void decompress_generic(uint16_t *x, const size_t len, const uint16_t a, const uint16_t b) {
+    const uint16_t shift = (uint16_t) (a - b);
+    const uint16_t mask_a = (uint16_t) (((uint16_t) 1 << a) - 1);
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        x[i] = (uint16_t) (x[i] << shift) & mask_a;
+    }
+}
+
+/**
+ * The generic version of `pst_backend.add_msg`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void add_msg_generic(uint16_t *result, const size_t len, const uint16_t *matrix, const unsigned char *m, const uint16_t bits_coeff, const uint8_t scaling_factor) {
+    const uint16_t mask_bits = (uint16_t) ((1 << bits_coeff) - 1);
+    const int shift = scaling_factor - bits_coeff;
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        const size_t idx_bit = bits_coeff * i;
+        const uint16_t m_chunk = (uint16_t) ((m[idx_bit / 8] >> (idx_bit % 8)) & mask_bits);
+        result[i] = (uint16_t) (matrix[i] + (m_chunk << shift));
+    }
+}
+
+/**
+ * The generic version of `pst_backend.diff_msg`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void diff_msg_generic(uint16_t *result, const size_t len, const uint16_t *matrix_a, const uint16_t *matrix_b) {
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        result[i] = (uint16_t) (matrix_a[i] - matrix_b[i]);
+    }
+}
+
+#if defined(__GNUC__)
+
+/* The kernels on the vector extensions of the compiler. The vectors hold 16
+ * coefficients (256 bits); the compiler splits the operations on them if the
+ * registers of the instruction set are smaller. The kernels that rearrange
+ * the coefficients within a vector use half vectors (128 bits), which fit
+ * the registers of all x86-64 cpus, as do the kernels that keep sums in
+ * vectors for the backends without wider registers; the AVX-512 backend
+ * uses wide vectors (512 bits) for these. The tails of the runs are handled
+ * by the scalar kernels. */
+
+/** The number of coefficients in a vector */
+#define VEC_LANES 16
+
+/** A vector of coefficients */
+typedef uint16_t vec16 __attribute__((vector_size(VEC_LANES * sizeof (uint16_t))));
+
+/** The number of coefficients in a half vector */
+#define HALF_VEC_LANES 8
+
+/** A half vector of coefficients, for the kernels that rearrange them */
+typedef uint16_t vec8 __attribute__((vector_size(HALF_VEC_LANES * sizeof (uint16_t))));
+
+/** The number of coefficients in a wide vector */
+#define WIDE_VEC_LANES 32
+
+/** A wide vector of coefficients, for the backends with 512-bit registers */
+typedef uint16_t vec32 __attribute__((vector_size(WIDE_VEC_LANES * sizeof (uint16_t))));
+
+/** A vector of coefficients at an address that need not be aligned to its size */
+typedef uint16_t vec16_unaligned __attribute__((vector_size(VEC_LANES * sizeof (uint16_t)), aligned(sizeof (uint16_t)), may_alias));
+
+/** A half vector of coefficients at an address that need not be aligned to its size */
+typedef uint16_t vec8_unaligned __attribute__((vector_size(HALF_VEC_LANES * sizeof (uint16_t)), aligned(sizeof (uint16_t)), may_alias));
+
+/** Loads a vector from the (not necessarily aligned) coefficients at _p_ */
+#define VEC_LOAD(p) (*(const vec16_unaligned *) (const void *) (p))
+
+/** Stores vector _v_ to the (not necessarily aligned) coefficients at _p_ */
+#define VEC_STORE(p, v) (*(vec16_unaligned *) (void *) (p) = (v))
+
+/** A wide vector of coefficients at an address that need not be aligned to its size */
+typedef uint16_t vec32_unaligned __attribute__((vector_size(WIDE_VEC_LANES * sizeof (uint16_t)), aligned(sizeof (uint16_t)), may_alias));
+
+/** Loads a wide vector from the (not necessarily aligned) coefficients at _p_ */
+#define WIDE_VEC_LOAD(p) (*(const vec32_unaligned *) (const void *) (p))
+
+/** Stores wide vector _v_ to the (not necessarily aligned) coefficients at _p_ */
+#define WIDE_VEC_STORE(p, v) (*(vec32_unaligned *) (void *) (p) = (v))
+
+/** Loads a half vector from the (not necessarily aligned) coefficients at _p_ */
+#define HALF_VEC_LOAD(p) (*(const vec8_unaligned *) (const void *) (p))
+
+/** Stores half vector _v_ to the (not necessarily aligned) coefficients at _p_ */
+#define HALF_VEC_STORE(p, v) (*(vec8_unaligned *) (void *) (p) = (v))
+
+/**
+ * Rearranges the coefficients of two vectors (`VEC_SHUFFLE`) or half vectors
+ * (`HALF_VEC_SHUFFLE`), the indices select from the concatenation of both.
+ */
+#if defined(__clang__) || __GNUC__ >= 12
+#define VEC_SHUFFLE(a, b, ...) __builtin_shufflevector(a, b, __VA_ARGS__)
+#define HALF_VEC_SHUFFLE(a, b, ...) __builtin_shufflevector(a, b, __VA_ARGS__)
+#else
+#define VEC_SHUFFLE(a, b, ...) __builtin_shuffle(a, b, (vec16) {__VA_ARGS__})
+#define HALF_VEC_SHUFFLE(a, b, ...) __builtin_shuffle(a, b, (vec8) {__VA_ARGS__})
+#endif
+
+/**
+ * Defines the vector versions of the product kernels that keep sums in
+ * vectors across the iterations of their loops (`accumulate_windows`,
+ * `mult_rows_dense`, `mult_rows_merged` and `accumulate_windows_merged`),
+ * for a width of the vectors. GCC keeps vectors that are
+ * wider than the registers of the instruction set in memory, so each backend
+ * uses the widest vectors that fit its registers.
+ *
+ * In `accumulate_windows` runs of two vectors are accumulated at a time, so
+ * that the start of each window is looked up once per run. In
+ * `mult_rows_dense` the products of the coefficients are summed a vector at
+ * a time, after which the lanes are summed. In `mult_rows_merged` lane _j_
+ * of the sum is the sum of vector _j_: each coefficient of the stream is
+ * broadcast and multiplied with the multiplier of its entry (1 or -1 in the
+ * lane of its vector, 0 in the others), so the sums of all vectors are kept
+ * in a single vector (if there are at most _lanes_ vectors).
+ *
+ * @param suffix the suffix of the names of the kernels
+ * @param vec    the type of the vectors
+ * @param lanes  the number of coefficients in a vector
+ * @param load   loads a vector from (not necessarily aligned) coefficients
+ * @param store  stores a vector to (not necessarily aligned) coefficients
+ */
+#define DEFINE_VECTOR_PRODUCTS(suffix, vec, lanes, load, store) \
+    static ALWAYS_INLINE void accumulate_windows_##suffix(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint16_t *idx, const uint16_t h, const size_t offset, const size_t width) { \
+        size_t k = 0; \
+        uint16_t l; \
+        for (; k + 2 * (lanes) <= width; k += 2 * (lanes)) { \
+            vec sum_lo = {0}, sum_hi = {0}; \
+            for (l = 0; l < h / 2; ++l) { /* Rows where the vector is 1 */ \
+                const uint16_t *window = A_master + row_start(row_displacements, idx[l]) + offset + k; \
+                sum_lo += load(window); \
+                sum_hi += load(window + (lanes)); \
+            } \
+            for (l = h / 2; l < h; ++l) { /* Rows where the vector is -1 */ \
+                const uint16_t *window = A_master + row_start(row_displacements, idx[l]) + offset + k; \
+                sum_lo -= load(window); \
+                sum_hi -= load(window + (lanes)); \
+            } \
+            store(acc + k, sum_lo); \
+            store(acc + k + (lanes), sum_hi); \
+        } \
+        if (k + (lanes) <= width) { \
+            vec sum = {0}; \
+            for (l = 0; l < h / 2; ++l) { /* Rows where the vector is 1 */ \
+                sum += load(A_master + row_start(row_displacements, idx[l]) + offset + k); \
+            } \
+            for (l = h / 2; l < h; ++l) { /* Rows where the vector is -1 */ \
+                sum -= load(A_master + row_start(row_displacements, idx[l]) + offset + k); \
+            } \
+            store(acc + k, sum); \
+            k += (lanes); \
+        } \
+        if (k < width) { \
+            accumulate_windows_generic(acc + k, A_master, row_displacements, idx, h, offset + k, width - k); \
+        } \
+    } \
+    static ALWAYS_INLINE void mult_rows_dense_##suffix(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *vectors, const size_t nr_rows, const uint16_t nr_vectors, const size_t len, const uint16_t mod_mask) { \
+        size_t i, k; \
+        uint16_t j, l; \
+        for (i = 0; i < nr_rows; ++i) { \
+            const uint16_t *row = A + row_displacements[i]; \
+            for (j = 0; j < nr_vectors; ++j) { \
+                const uint16_t *vector = vectors + j * len; \
+                vec sum = {0}; \
+                vec8 halves[(lanes) / HALF_VEC_LANES]; \
+                uint16_t acc; \
+                for (k = 0; k + (lanes) <= len; k += (lanes)) { \
+                    sum += load(row + k) * load(vector + k); \
+                } \
+                /* The sum of the lanes (in lane 0), per half vector */ \
+                memcpy(halves, &sum, sizeof (halves)); \
+                for (l = 1; l < (lanes) / HALF_VEC_LANES; ++l) { \
+                    halves[0] += halves[l]; \
+                } \
+                halves[0] += HALF_VEC_SHUFFLE(halves[0], halves[0], 4, 5, 6, 7, 0, 1, 2, 3); \
+                halves[0] += HALF_VEC_SHUFFLE(halves[0], halves[0], 2, 3, 0, 1, 6, 7, 4, 5); \
+                halves[0] += HALF_VEC_SHUFFLE(halves[0], halves[0], 1, 0, 3, 2, 5, 4, 7, 6); \
+                acc = halves[0][0]; \
+                for (; k < len; ++k) { \
+                    acc = (uint16_t) (acc + (uint32_t) row[k] * vector[k]); \
+                } \
+                *result++ = acc & mod_mask; \
+            } \
+        } \
+    } \
+    static ALWAYS_INLINE void mult_rows_merged_##suffix(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const size_t nr_rows, const uint16_t nr_vectors, const uint16_t mod_mask) { \
+        vec signs[2 * (lanes)] = {{0}}; \
+        uint16_t sums[(lanes)]; \
+        size_t i, e; \
+        uint16_t j; \
+        if (nr_vectors > (lanes)) { \
+            mult_rows_merged_generic(result, A, row_displacements, merged, nr_entries, nr_rows, nr_vectors, mod_mask); \
+            return; \
+        } \
+        /* The multipliers of the entries: lane j is 1 (or -1) for vector j */ \
+        for (j = 0; j < nr_vectors; ++j) { \
+            signs[2 * j][j] = 1; \
+            signs[2 * j + 1][j] = UINT16_MAX; \
+        } \
+        for (i = 0; i < nr_rows; ++i) { \
+            const uint16_t *row = A + row_displacements[i]; \
+            vec sum = {0}; \
+            for (e = 0; e < nr_entries; ++e) { \
+                const uint32_t entry = merged[e]; \
+                sum += row[PST_MERGED_INDEX(entry)] * signs[entry & (2 * (lanes) - 1)]; \
+            } \
+            store(sums, sum); \
+            for (j = 0; j < nr_vectors; ++j) { \
+                *result++ = sums[j] & mod_mask; \
+            } \
+        } \
+    } \
+    static ALWAYS_INLINE void accumulate_windows_merged_##suffix(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const uint16_t nr_vectors, const size_t offset, const size_t width) { \
+        size_t e, k; \
+        memset(acc, 0, 2 * nr_vectors * width * sizeof (*acc)); \
+        for (e = 0; e < nr_entries; ++e) { \
+            const uint32_t entry = merged[e]; \
+            const uint16_t *window = A_master + row_start(row_displacements, PST_MERGED_INDEX(entry)) + offset; \
+            uint16_t *sum = acc + PST_MERGED_SUM(entry) * width; \
+            for (k = 0; k + (lanes) <= width; k += (lanes)) { \
+                store(sum + k, load(sum + k) + load(window + k)); \
+            } \
+            for (; k < width; ++k) { \
+                sum[k] = (uint16_t) (sum[k] + window[k]); \
+            } \
+        } \
+    }
+
+DEFINE_VECTOR_PRODUCTS(vector, vec16, VEC_LANES, VEC_LOAD, VEC_STORE)
+DEFINE_VECTOR_PRODUCTS(half_vector, vec8, HALF_VEC_LANES, HALF_VEC_LOAD, HALF_VEC_STORE)
+DEFINE_VECTOR_PRODUCTS(wide_vector, vec32, WIDE_VEC_LANES, WIDE_VEC_LOAD, WIDE_VEC_STORE)
+
+/**
+ * The vector version of `pst_backend.unlift_poly`, see there for the
+ * parameters. A half vector of coefficients at a time (the shifts within a
+ * register are cheap, those across registers are not): a log-step suffix sum
+ * within the vector plus the (broadcast) sum of all following coefficients.
+ */
+static ALWAYS_INLINE void unlift_poly_vector(uint16_t *cyc_pol, const uint16_t *ntru_pol, const size_t len, const uint16_t mod_mask) {
+    const vec8 zero = {0};
+    vec8 carry = zero;
+    size_t end = len;
+
+    /* cyc_pol[i] is the sum of ntru_pol[i + 1..len], computed backwards */
+    while (end >= HALF_VEC_LANES) {
+        vec8 v = HALF_VEC_LOAD(ntru_pol + end - (HALF_VEC_LANES - 1));
+        v += HALF_VEC_SHUFFLE(v, zero, 1, 2, 3, 4, 5, 6, 7, 8);
+        v += HALF_VEC_SHUFFLE(v, zero, 2, 3, 4, 5, 6, 7, 8, 9);
+        v += HALF_VEC_SHUFFLE(v, zero, 4, 5, 6, 7, 8, 9, 10, 11);
+        v += carry;
+        HALF_VEC_STORE(cyc_pol + end - HALF_VEC_LANES, v & mod_mask);
+        carry = HALF_VEC_SHUFFLE(v, v, 0, 0, 0, 0, 0, 0, 0, 0);
+        end -= HALF_VEC_LANES;
+    }
+    unlift_poly_scalar(cyc_pol, ntru_pol, end, carry[0], mod_mask);
+}
+
+/**
+ * Transposes a block of 8 x 8 coefficients held in half vectors, in three
+ * rounds that interleave pairs of vectors by 1, 2 and 4 coefficients. Fully
+ * unrolled, so that the block stays in registers.
+ *
+ * @param[in,out] r the rows of the block, its columns on return
+ */
+static ALWAYS_INLINE void transpose_half_vectors(vec8 r[HALF_VEC_LANES]) {
+    const vec8 p0 = HALF_VEC_SHUFFLE(r[0], r[1], 0, 8, 1, 9, 2, 10, 3, 11);
+    const vec8 p1 = HALF_VEC_SHUFFLE(r[0], r[1], 4, 12, 5, 13, 6, 14, 7, 15);
+    const vec8 p2 = HALF_VEC_SHUFFLE(r[2], r[3], 0, 8, 1, 9, 2, 10, 3, 11);
+    const vec8 p3 = HALF_VEC_SHUFFLE(r[2], r[3], 4, 12, 5, 13, 6, 14, 7, 15);
+    const vec8 p4 = HALF_VEC_SHUFFLE(r[4], r[5], 0, 8, 1, 9, 2, 10, 3, 11);
+    const vec8 p5 = HALF_VEC_SHUFFLE(r[4], r[5], 4, 12, 5, 13, 6, 14, 7, 15);
+    const vec8 p6 = HALF_VEC_SHUFFLE(r[6], r[7], 0, 8, 1, 9, 2, 10, 3, 11);
+    const vec8 p7 = HALF_VEC_SHUFFLE(r[6], r[7], 4, 12, 5, 13, 6, 14, 7, 15);
+    const vec8 q0 = HALF_VEC_SHUFFLE(p0, p2, 0, 1, 8, 9, 2, 3, 10, 11);
+    const vec8 q1 = HALF_VEC_SHUFFLE(p0, p2, 4, 5, 12, 13, 6, 7, 14, 15);
+    const vec8 q2 = HALF_VEC_SHUFFLE(p1, p3, 0, 1, 8, 9, 2, 3, 10, 11);
+    const vec8 q3 = HALF_VEC_SHUFFLE(p1, p3, 4, 5, 12, 13, 6, 7, 14, 15);
+    const vec8 q4 = HALF_VEC_SHUFFLE(p4, p6, 0, 1, 8, 9, 2, 3, 10, 11);
+    const vec8 q5 = HALF_VEC_SHUFFLE(p4, p6, 4, 5, 12, 13, 6, 7, 14, 15);
+    const vec8 q6 = HALF_VEC_SHUFFLE(p5, p7, 0, 1, 8, 9, 2, 3, 10, 11);
+    const vec8 q7 = HALF_VEC_SHUFFLE(p5, p7, 4, 5, 12, 13, 6, 7, 14, 15);
+
+    r[0] = HALF_VEC_SHUFFLE(q0, q4, 0, 1, 2, 3, 8, 9, 10, 11);
+    r[1] = HALF_VEC_SHUFFLE(q0, q4, 4, 5, 6, 7, 12, 13, 14, 15);
+    r[2] = HALF_VEC_SHUFFLE(q1, q5, 0, 1, 2, 3, 8, 9, 10, 11);
+    r[3] = HALF_VEC_SHUFFLE(q1, q5, 4, 5, 6, 7, 12, 13, 14, 15);
+    r[4] = HALF_VEC_SHUFFLE(q2, q6, 0, 1, 2, 3, 8, 9, 10, 11);
+    r[5] = HALF_VEC_SHUFFLE(q2, q6, 4, 5, 6, 7, 12, 13, 14, 15);
+    r[6] = HALF_VEC_SHUFFLE(q3, q7, 0, 1, 2, 3, 8, 9, 10, 11);
+    r[7] = HALF_VEC_SHUFFLE(q3, q7, 4, 5, 6, 7, 12, 13, 14, 15);
+}
+
+/**
+ * The vector version of `pst_backend.unlift_poly_sessions`, see there for
+ * the parameters. A half vector of sessions at a time, one session per lane:
+ * blocks of 8 coefficients of each of the sessions are transposed, so that
+ * the suffix sums are plain vector additions, and transposed back. The
+ * remaining sessions are unlifted one by one.
+ */
+static ALWAYS_INLINE void unlift_poly_sessions_vector(uint16_t *cyc_pols, const size_t cyc_stride, const uint16_t *ntru_pols, const size_t ntru_stride, const size_t nr_sessions, const size_t len, const uint16_t mod_mask) {
+    size_t s, i;
+
+    for (s = 0; s + HALF_VEC_LANES <= nr_sessions; s += HALF_VEC_LANES) {
+        uint16_t *cyc = cyc_pols + s * cyc_stride;
+        const uint16_t *ntru = ntru_pols + s * ntru_stride;
+        vec8 carry = {0};
+        size_t end = len;
+
+        while (end >= HALF_VEC_LANES) {
+            const uint16_t *in = ntru + end - (HALF_VEC_LANES - 1);
+            uint16_t *out = cyc + end - HALF_VEC_LANES;
+            vec8 b[HALF_VEC_LANES] = {
+                HALF_VEC_LOAD(in), HALF_VEC_LOAD(in + ntru_stride),
+                HALF_VEC_LOAD(in + 2 * ntru_stride), HALF_VEC_LOAD(in + 3 * ntru_stride),
+                HALF_VEC_LOAD(in + 4 * ntru_stride), HALF_VEC_LOAD(in + 5 * ntru_stride),
+                HALF_VEC_LOAD(in + 6 * ntru_stride), HALF_VEC_LOAD(in + 7 * ntru_stride)
+            };
+            /* b[i] holds coefficient end - 7 + i of the sessions */
+            transpose_half_vectors(b);
+            carry += b[7];
+            b[7] = carry & mod_mask;
+            carry += b[6];
+            b[6] = carry & mod_mask;
+            carry += b[5];
+            b[5] = carry & mod_mask;
+            carry += b[4];
+            b[4] = carry & mod_mask;
+            carry += b[3];
+            b[3] = carry & mod_mask;
+            carry += b[2];
+            b[2] = carry & mod_mask;
+            carry += b[1];
+            b[1] = carry & mod_mask;
+            carry += b[0];
+            b[0] = carry & mod_mask;
+            transpose_half_vectors(b);
+            HALF_VEC_STORE(out, b[0]);
+            HALF_VEC_STORE(out + cyc_stride, b[1]);
+            HALF_VEC_STORE(out + 2 * cyc_stride, b[2]);
+            HALF_VEC_STORE(out + 3 * cyc_stride, b[3]);
+            HALF_VEC_STORE(out + 4 * cyc_stride, b[4]);
+            HALF_VEC_STORE(out + 5 * cyc_stride, b[5]);
+            HALF_VEC_STORE(out + 6 * cyc_stride, b[6]);
+            HALF_VEC_STORE(out + 7 * cyc_stride, b[7]);
+            end -= HALF_VEC_LANES;
+        }
+        for (i = 0; i < HALF_VEC_LANES; ++i) {
+            unlift_poly_scalar(cyc + i * cyc_stride, ntru + i * ntru_stride, end, carry[i], mod_mask);
+        }
+    }
+    for (; s < nr_sessions; ++s) {
+        unlift_poly_vector(cyc_pols + s * cyc_stride, ntru_pols + s * ntru_stride, len, mod_mask);
+    }
+}
+
+/**
+ * The vector version of `pst_backend.lift_poly`, see there for the
+ * parameters. A half vector of coefficients at a time: the differences of
+ * two overlapping runs of the cyclotomic polynomial, reversed within the
+ * vector.
+ */
+static ALWAYS_INLINE void lift_poly_vector(uint16_t *restrict ntru_rev, const uint16_t *restrict cyc_pol, const size_t len, const uint16_t mod_mask) {
+    uint16_t *restrict ntru_rev_dup = ntru_rev + len + 1;
+    size_t i;
+
+    ntru_rev[0] = ntru_rev_dup[0] = (uint16_t) (-cyc_pol[0]) & mod_mask;
+    ntru_rev[1] = ntru_rev_dup[1] = cyc_pol[len - 1] & mod_mask;
+    for (i = 2; i + HALF_VEC_LANES <= len + 1; i += HALF_VEC_LANES) {
+        /* Coefficients i..i + 7 from cyc_pol[len - i - 7..len + 1 - i] */
+        const uint16_t *run = cyc_pol + len - i - (HALF_VEC_LANES - 1);
+        vec8 coeffs = (HALF_VEC_LOAD(run) - HALF_VEC_LOAD(run + 1)) & mod_mask;
+        coeffs = HALF_VEC_SHUFFLE(coeffs, coeffs, 7, 6, 5, 4, 3, 2, 1, 0);
+        HALF_VEC_STORE(ntru_rev + i, coeffs);
+        HALF_VEC_STORE(ntru_rev_dup + i, coeffs);
+    }
+    for (; i <= len; ++i) {
+        const uint16_t coeff = (uint16_t) (cyc_pol[len - i] - cyc_pol[len + 1 - i]) & mod_mask;
+        ntru_rev[i] = coeff;
+        ntru_rev_dup[i] = coeff;
+    }
+}
+
+/**
+ * The vector version of `pst_backend.lift_poly_sessions`, see there for the
+ * parameters. A half vector of sessions at a time: the differences of two
+ * overlapping runs of 8 coefficients of each of the sessions are transposed,
+ * so that each vector holds one coefficient of the sessions, and stored in
+ * the reverse order. The remaining coefficients and sessions are lifted one
+ * by one.
+ */
+static ALWAYS_INLINE void lift_poly_sessions_vector(uint16_t *ntru_revs, const uint16_t *cyc_pols, const size_t cyc_stride, const size_t nr_sessions, const size_t len, const uint16_t mod_mask) {
+    size_t s, i, k;
+
+    for (s = 0; s + HALF_VEC_LANES <= nr_sessions; s += HALF_VEC_LANES) {
+        const uint16_t *cyc = cyc_pols + s * cyc_stride;
+
+        for (k = 0; k < HALF_VEC_LANES; ++k) {
+            lift_poly_lane(ntru_revs + s + k, cyc + k * cyc_stride, nr_sessions, 0, 2, len, mod_mask);
+        }
+        for (i = 2; i + HALF_VEC_LANES <= len + 1; i += HALF_VEC_LANES) {
+            /* Coefficients i..i + 7 from cyc_pol[len - i - 7..len + 1 - i] */
+            const uint16_t *run = cyc + len - i - (HALF_VEC_LANES - 1);
+            vec8 b[HALF_VEC_LANES];
+
+            for (k = 0; k < HALF_VEC_LANES; ++k) {
+                b[k] = (HALF_VEC_LOAD(run + k * cyc_stride) - HALF_VEC_LOAD(run + k * cyc_stride + 1)) & mod_mask;
+            }
+            /* b[k] holds coefficient i + 7 - k of the sessions */
+            transpose_half_vectors(b);
+            for (k = 0; k < HALF_VEC_LANES; ++k) {
+                HALF_VEC_STORE(ntru_revs + (i + k) * nr_sessions + s, b[HALF_VEC_LANES - 1 - k]);
+            }
+        }
+        for (k = 0; k < HALF_VEC_LANES; ++k) {
+            lift_poly_lane(ntru_revs + s + k, cyc + k * cyc_stride, nr_sessions, i, len + 1, len, mod_mask);
+        }
+    }
+    for (; s < nr_sessions; ++s) {
+        lift_poly_lane(ntru_revs + s, cyc_pols + s * cyc_stride, nr_sessions, 0, len + 1, len, mod_mask);
+    }
+}
+
+/**
+ * The vector version of `pst_backend.compress`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void compress_vector(uint16_t *x, const size_t len, const uint16_t a, const uint16_t b) {
+    const uint16_t shift = (uint16_t) (a - b);
+    const uint16_t rounding_mask = (uint16_t) (1 << (shift - 1));
+    const uint16_t mask_b = (uint16_t) (((uint16_t) 1 << b) - 1);
+    size_t i;
+
+    for (i = 0; i + VEC_LANES <= len; i += VEC_LANES) {
+        const vec16 v = VEC_LOAD(x + i);
+        VEC_STORE(x + i, ((v >> shift) + ((v & rounding_mask) >> (shift - 1))) & mask_b);
+    }
+    compress_generic(x + i, len - i, a, b);
+}
+
+/**
+ * The vector version of `pst_backend.decompress`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void decompress_vector(uint16_t *x, const size_t len, const uint16_t a, const uint16_t b) {
+    const uint16_t shift = (uint16_t) (a - b);
+    const uint16_t mask_a = (uint16_t) (((uint16_t) 1 << a) - 1);
+    size_t i;
+
+    for (i = 0; i + VEC_LANES <= len; i += VEC_LANES) {
+        VEC_STORE(x + i, (VEC_LOAD(x + i) << shift) & mask_a);
+    }
+    decompress_generic(x + i, len - i, a, b);
+}
+
+/**
+ * The vector version of `pst_backend.add_msg`, see there for the parameters.
+ * The bits of the message are gathered into a vector, after which they are
+ * scaled and added a vector at a time.
+ */
+static ALWAYS_INLINE void add_msg_vector(uint16_t *result, const size_t len, const uint16_t *matrix, const unsigned char *m, const uint16_t bits_coeff, const uint8_t scaling_factor) {
+    const uint16_t mask_bits = (uint16_t) ((1 << bits_coeff) - 1);
+    const int shift = scaling_factor - bits_coeff;
+    size_t i, j;
+
+    for (i = 0; i + VEC_LANES <= len; i += VEC_LANES) {
+        vec16 chunks;
+        for (j = 0; j < VEC_LANES; ++j) {
+            const size_t idx_bit = bits_coeff * (i + j);
+            chunks[j] = (uint16_t) (m[idx_bit / 8] >> (idx_bit % 8));
+        }
+        VEC_STORE(result + i, VEC_LOAD(matrix + i) + ((chunks & mask_bits) << shift));
+    }
+    /* A vector of coefficients takes a whole number of bytes of the message */
+    add_msg_generic(result + i, len - i, matrix + i, m + bits_coeff * i / 8, bits_coeff, scaling_factor);
+}
+
+/**
+ * The vector version of `pst_backend.diff_msg`, see there for the
+ * parameters.
+ */
+static ALWAYS_INLINE void diff_msg_vector(uint16_t *result, const size_t len, const uint16_t *matrix_a, const uint16_t *matrix_b) {
+    size_t i;
+
+    for (i = 0; i + VEC_LANES <= len; i += VEC_LANES) {
+        VEC_STORE(result + i, VEC_LOAD(matrix_a + i) - VEC_LOAD(matrix_b + i));
+    }
+    diff_msg_generic(result + i, len - i, matrix_a + i, matrix_b + i);
+}
+
+#else
+
+/* Without vector extensions, the vector versions are the scalar ones */
+#define HALF_VEC_LANES 8
+#define accumulate_windows_vector accumulate_windows_generic
+#define accumulate_windows_half_vector accumulate_windows_generic
+#define mult_rows_dense_vector mult_rows_dense_generic
+#define mult_rows_dense_half_vector mult_rows_dense_generic
+#define mult_rows_merged_vector mult_rows_merged_generic
+#define mult_rows_merged_half_vector mult_rows_merged_generic
+#define accumulate_windows_merged_vector accumulate_windows_merged_generic
+#define accumulate_windows_merged_half_vector accumulate_windows_merged_generic
+#define unlift_poly_vector(cyc_pol, ntru_pol, len, mod_mask) unlift_poly_scalar(cyc_pol, ntru_pol, len, 0, mod_mask)
+#define unlift_poly_sessions_vector unlift_poly_sessions_generic
+#define lift_poly_vector lift_poly_generic
+#define lift_poly_sessions_vector lift_poly_sessions_generic
+#define compress_vector compress_generic
+#define decompress_vector decompress_generic
+#define add_msg_vector add_msg_generic
+#define diff_msg_vector diff_msg_generic
+
+#endif
+
+/**
+ * Defines the product kernels of a backend (`mult_rows_idx`,
+ * `accumulate_windows`, `mult_sampled_idx`, `mult_rows_dense`,
+ * `mult_rows_merged` and `accumulate_windows_merged`), compiled with the
+ * given function attributes: the versions of `mult_rows_idx` specialised for
+ * the shapes (its products read scattered coefficients, which do not fit the
+ * vectors), the vector versions of the other kernels that keep sums in
+ * vectors of the given width (`mult_rows_merged` on half vectors if these
+ * hold all vectors), and the generic `mult_sampled_idx` (its short runs of
+ * columns are vectorised by the compiler).
+ *
+ * @param suffix        the suffix of the names of the kernels
+ * @param attributes    the function attributes (e.g. the target) of the kernels
+ * @param vector_width  the width of the vectors (`vector` or `half_vector`)
+ */
+#define DEFINE_BACKEND_PRODUCTS(suffix, attributes, vector_width) \
+    static attributes void mult_rows_idx_##suffix(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *idx, const size_t nr_rows, const uint16_t nr_vectors, const uint16_t h, const uint16_t mod_mask) { \
+        MULT_ROWS_IDX_SHAPES(MULT_ROWS_IDX_SPECIALISED) \
+        mult_rows_idx_generic(result, A, row_displacements, idx, nr_rows, nr_vectors, h, mod_mask); \
+    } \
+    static attributes void accumulate_windows_##suffix(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint16_t *idx, const uint16_t h, const size_t offset, const size_t width) { \
+        accumulate_windows_##vector_width(acc, A_master, row_displacements, idx, h, offset, width); \
+    } \
+    static attributes void mult_sampled_idx_##suffix(uint16_t *X, const size_t x_stride, const uint16_t *M, const uint16_t vectors_M, const uint16_t *idx, const uint16_t h, const size_t nr_cols) { \
+        mult_sampled_idx_generic(X, x_stride, M, vectors_M, idx, h, nr_cols); \
+    } \
+    static attributes void mult_rows_dense_##suffix(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *vectors, const size_t nr_rows, const uint16_t nr_vectors, const size_t len, const uint16_t mod_mask) { \
+        mult_rows_dense_##vector_width(result, A, row_displacements, vectors, nr_rows, nr_vectors, len, mod_mask); \
+    } \
+    static attributes void mult_rows_merged_##suffix(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const size_t nr_rows, const uint16_t nr_vectors, const uint16_t mod_mask) { \
+        if (nr_vectors <= HALF_VEC_LANES) { \
+            mult_rows_merged_half_vector(result, A, row_displacements, merged, nr_entries, nr_rows, nr_vectors, mod_mask); \
+        } else { \
+            mult_rows_merged_##vector_width(result, A, row_displacements, merged, nr_entries, nr_rows, nr_vectors, mod_mask); \
+        } \
+    } \
+    static attributes void accumulate_windows_merged_##suffix(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const uint16_t nr_vectors, const size_t offset, const size_t width) { \
+        accumulate_windows_merged_##vector_width(acc, A_master, row_displacements, merged, nr_entries, nr_vectors, offset, width); \
+    }
+
+/**
+ * Defines the element-wise kernels of a backend (`unlift_poly`,
+ * `unlift_poly_sessions`, `lift_poly`, `lift_poly_sessions`, `compress`,
+ * `decompress`, `add_msg` and `diff_msg`), as the vector kernels
+ * compiled with the given function attributes.
+ *
+ * @param suffix     the suffix of the names of the kernels
+ * @param attributes the function attributes (e.g. the target) of the kernels
+ */
+#define DEFINE_BACKEND_ELEMENTWISE(suffix, attributes) \
+    static attributes void unlift_poly_##suffix(uint16_t *cyc_pol, const uint16_t *ntru_pol, const size_t len, const uint16_t mod_mask) { \
+        unlift_poly_vector(cyc_pol, ntru_pol, len, mod_mask); \
+    } \
+    static attributes void unlift_poly_sessions_##suffix(uint16_t *cyc_pols, const size_t cyc_stride, const uint16_t *ntru_pols, const size_t ntru_stride, const size_t nr_sessions, const size_t len, const uint16_t mod_mask) { \
+        unlift_poly_sessions_vector(cyc_pols, cyc_stride, ntru_pols, ntru_stride, nr_sessions, len, mod_mask); \
+    } \
+    static attributes void lift_poly_##suffix(uint16_t *restrict ntru_rev, const uint16_t *restrict cyc_pol, const size_t len, const uint16_t mod_mask) { \
+        lift_poly_vector(ntru_rev, cyc_pol, len, mod_mask); \
+    } \
+    static attributes void lift_poly_sessions_##suffix(uint16_t *ntru_revs, const uint16_t *cyc_pols, const size_t cyc_stride, const size_t nr_sessions, const size_t len, const uint16_t mod_mask) { \
+        lift_poly_sessions_vector(ntru_revs, cyc_pols, cyc_stride, nr_sessions, len, mod_mask); \
+    } \
+    static attributes void compress_##suffix(uint16_t *x, const size_t len, const uint16_t a, const uint16_t b) { \
+        compress_vector(x, len, a, b); \
+    } \
+    static attributes void decompress_##suffix(uint16_t *x, const size_t len, const uint16_t a, const uint16_t b) { \
+        decompress_vector(x, len, a, b); \
+    } \
+    static attributes void add_msg_##suffix(uint16_t *result, const size_t len, const uint16_t *matrix, const unsigned char *m, const uint16_t bits_coeff, const uint8_t scaling_factor) { \
+        add_msg_vector(result, len, matrix, m, bits_coeff, scaling_factor); \
+    } \
+    static attributes void diff_msg_##suffix(uint16_t *result, const size_t len, const uint16_t *matrix_a, const uint16_t *matrix_b) { \
+        diff_msg_vector(result, len, matrix_a, matrix_b); \
+    }
+
+/* The portable backend: the plain scalar kernels, without specialisation,
+ * the reference for the other backends */
+
+/**
+ * The portable backend is always supported.
+ *
+ * @return __1__
+ */
+static int portable_supported(void) {
+    return 1;
+}
+
+/** Portable version of `pst_backend.mult_rows_idx`, not specialised for the shapes */
+static void mult_rows_idx_portable(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *idx, const size_t nr_rows, const uint16_t nr_vectors, const uint16_t h, const uint16_t mod_mask) {
+    mult_rows_idx_generic(result, A, row_displacements, idx, nr_rows, nr_vectors, h, mod_mask);
+}
+
+/** Portable version of `pst_backend.accumulate_windows` */
+static void accumulate_windows_portable(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint16_t *idx, const uint16_t h, const size_t offset, const size_t width) {
+    accumulate_windows_generic(acc, A_master, row_displacements, idx, h, offset, width);
+}
+
+/** Portable version of `pst_backend.mult_sampled_idx` */
+static void mult_sampled_idx_portable(uint16_t *X, const size_t x_stride, const uint16_t *M, const uint16_t vectors_M, const uint16_t *idx, const uint16_t h, const size_t nr_cols) {
+    mult_sampled_idx_generic(X, x_stride, M, vectors_M, idx, h, nr_cols);
+}
+
+/** Portable version of `pst_backend.mult_rows_dense` */
+static void mult_rows_dense_portable(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *vectors, const size_t nr_rows, const uint16_t nr_vectors, const size_t len, const uint16_t mod_mask) {
+    mult_rows_dense_generic(result, A, row_displacements, vectors, nr_rows, nr_vectors, len, mod_mask);
+}
+
+/** Portable version of `pst_backend.mult_rows_merged` */
+static void mult_rows_merged_portable(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const size_t nr_rows, const uint16_t nr_vectors, const uint16_t mod_mask) {
+    mult_rows_merged_generic(result, A, row_displacements, merged, nr_entries, nr_rows, nr_vectors, mod_mask);
+}
+
+/** Portable version of `pst_backend.accumulate_windows_merged` */
+static void accumulate_windows_merged_portable(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const uint16_t nr_vectors, const size_t offset, const size_t width) {
+    accumulate_windows_merged_generic(acc, A_master, row_displacements, merged, nr_entries, nr_vectors, offset, width);
+}
+
+/** Portable version of `pst_backend.unlift_poly` */
+static void unlift_poly_portable(uint16_t *cyc_pol, const uint16_t *ntru_pol, const size_t len, const uint16_t mod_mask) {
+    unlift_poly_scalar(cyc_pol, ntru_pol, len, 0, mod_mask);
+}
+
+/** Portable version of `pst_backend.unlift_poly_sessions` */
+static void unlift_poly_sessions_portable(uint16_t *cyc_pols, const size_t cyc_stride, const uint16_t *ntru_pols, const size_t ntru_stride, const size_t nr_sessions, const size_t len, const uint16_t mod_mask) {
+    unlift_poly_sessions_generic(cyc_pols, cyc_stride, ntru_pols, ntru_stride, nr_sessions, len, mod_mask);
+}
+
+/** Portable version of `pst_backend.lift_poly` */
+static void lift_poly_portable(uint16_t *restrict ntru_rev, const uint16_t *restrict cyc_pol, const size_t len, const uint16_t mod_mask) {
+    lift_poly_generic(ntru_rev, cyc_pol, len, mod_mask);
+}
+
+/** Portable version of `pst_backend.lift_poly_sessions` */
+static void lift_poly_sessions_portable(uint16_t *ntru_revs, const uint16_t *cyc_pols, const size_t cyc_stride, const size_t nr_sessions, const size_t len, const uint16_t mod_mask) {
+    lift_poly_sessions_generic(ntru_revs, cyc_pols, cyc_stride, nr_sessions, len, mod_mask);
+}
+
+/** Portable version of `pst_backend.compress` */
+static void compress_portable(uint16_t *x, const size_t len, const uint16_t a, const uint16_t b) {
+    compress_generic(x, len, a, b);
+}
+
+/** Portable version of `pst_backend.decompress` */
+static void decompress_portable(uint16_t *x, const size_t len, const uint16_t a, const uint16_t b) {
+    decompress_generic(x, len, a, b);
+}
+
+/** Portable version of `pst_backend.add_msg` */
+static void add_msg_portable(uint16_t *result, const size_t len, const uint16_t *matrix, const unsigned char *m, const uint16_t bits_coeff, const uint8_t scaling_factor) {
+    add_msg_generic(result, len, matrix, m, bits_coeff, scaling_factor);
+}
+
+/** Portable version of `pst_backend.diff_msg` */
+static void diff_msg_portable(uint16_t *result, const size_t len, const uint16_t *matrix_a, const uint16_t *matrix_b) {
+    diff_msg_generic(result, len, matrix_a, matrix_b);
+}
+
+/* The optimized backend: the vector kernels and the kernels specialised for
+ * the shapes of the parameter sets, for the instruction set the library is
+ * built for */
+
+DEFINE_BACKEND_PRODUCTS(optimized, , half_vector)
+DEFINE_BACKEND_ELEMENTWISE(optimized, )
+
+#ifdef PST_BACKEND_X86
+
+/* The AVX2 backend: the optimized kernels, compiled for AVX2 (a vector of
+ * coefficients per register) */
+
+DEFINE_BACKEND_PRODUCTS(avx2, __attribute__((target("avx2"))), vector)
+DEFINE_BACKEND_ELEMENTWISE(avx2, __attribute__((target("avx2"))))
+
+/* The AVX-512 backend: hand-written AVX-512BW versions of the kernels that
+ * accumulate contiguous runs (32 coefficients per register, masked loads and
+ * stores for the tails), the dense products on wide vectors, and the
+ * element-wise kernels compiled for AVX-512 */
+
+/** Function attribute for the kernels of the AVX-512 backend */
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+
+/**
+ * Determines the mask for the (at most 32) coefficients of a run that
+ * starts at _k_ in a run of _width_.
+ *
+ * @param[in] k      the start of the part of the run
+ * @param[in] width  the length of the run
+ * @return the mask, with a bit set for each coefficient within the run
+ */
+static TARGET_AVX512 ALWAYS_INLINE __mmask32 tail_mask(const size_t k, const size_t width) {
+    if (k >= width) {
+        return 0;
+    }
+    return width - k >= 32 ? (__mmask32) 0xffffffffU : (__mmask32) ((1U << (width - k)) - 1U);
+}
+
+/**
+ * AVX-512 version of `pst_backend.accumulate_windows`. Runs of 64
+ * coefficients are accumulated in two registers, so that the start of each
+ * window is looked up once per run.
+ */
+static TARGET_AVX512 void accumulate_windows_avx512(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint16_t *idx, const uint16_t h, const size_t offset, const size_t width) {
+    size_t k;
+    uint16_t l;
+
+    for (k = 0; k < width; k += 64) {
+        const __mmask32 mask_lo = tail_mask(k, width);
+        const __mmask32 mask_hi = tail_mask(k + 32, width);
+        __m512i sum_lo = _mm512_setzero_si512();
+        __m512i sum_hi = _mm512_setzero_si512();
+        for (l = 0; l < h / 2; ++l) { /* Rows where the vector is 1 */
+            const uint16_t *window = A_master + row_start(row_displacements, idx[l]) + offset + k;
+            sum_lo = _mm512_add_epi16(sum_lo, _mm512_maskz_loadu_epi16(mask_lo, window));
+            sum_hi = _mm512_add_epi16(sum_hi, _mm512_maskz_loadu_epi16(mask_hi, window + 32));
+        }
+        for (l = h / 2; l < h; ++l) { /* Rows where the vector is -1 */
+            const uint16_t *window = A_master + row_start(row_displacements, idx[l]) + offset + k;
+            sum_lo = _mm512_sub_epi16(sum_lo, _mm512_maskz_loadu_epi16(mask_lo, window));
+            sum_hi = _mm512_sub_epi16(sum_hi, _mm512_maskz_loadu_epi16(mask_hi, window + 32));
+        }
+        _mm512_mask_storeu_epi16(acc + k, mask_lo, sum_lo);
+        _mm512_mask_storeu_epi16(acc + k + 32, mask_hi, sum_hi);
+    }
+}
+
+/**
+ * AVX-512 version of `pst_backend.mult_sampled_idx`. The columns are summed
+ * in runs of 32 before they are added to the (strided) outputs.
+ */
+static TARGET_AVX512 void mult_sampled_idx_avx512(uint16_t *X, const size_t x_stride, const uint16_t *M, const uint16_t vectors_M, const uint16_t *idx, const uint16_t h, const size_t nr_cols) {
+    uint16_t sums[32];
+    size_t c, i;
+    uint16_t k;
+
+    for (c = 0; c < nr_cols; c += 32) {
+        const __mmask32 mask = tail_mask(c, nr_cols);
+        const size_t run = nr_cols - c < 32 ? nr_cols - c : 32;
+        __m512i sum = _mm512_setzero_si512();
+        for (k = 0; k < h / 2; ++k) { /* Rows where the vector is 1 */
+            sum = _mm512_add_epi16(sum, _mm512_maskz_loadu_epi16(mask, M + (size_t) idx[k] * vectors_M + c));
+        }
+        for (k = h / 2; k < h; ++k) { /* Rows where the vector is -1 */
+            sum = _mm512_sub_epi16(sum, _mm512_maskz_loadu_epi16(mask, M + (size_t) idx[k] * vectors_M + c));
+        }
+        if (x_stride == 1) {
+            _mm512_mask_storeu_epi16(X + c, mask, _mm512_add_epi16(sum, _mm512_maskz_loadu_epi16(mask, X + c)));
+        } else {
+            _mm512_storeu_si512((void *) sums, sum);
+            for (i = 0; i < run; ++i) {
+                X[(c + i) * x_stride] = (uint16_t) (X[(c + i) * x_stride] + sums[i]);
+            }
+        }
+    }
+}
+
+/**
+ * AVX-512 version of `pst_backend.mult_rows_dense`, the vector kernel on
+ * wide vectors.
+ */
+static TARGET_AVX512 void mult_rows_dense_avx512(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *vectors, const size_t nr_rows, const uint16_t nr_vectors, const size_t len, const uint16_t mod_mask) {
+    mult_rows_dense_wide_vector(result, A, row_displacements, vectors, nr_rows, nr_vectors, len, mod_mask);
+}
+
+/** AVX-512 version of `pst_backend.mult_rows_merged`: on (half) vectors, as for AVX2 */
+static TARGET_AVX512 void mult_rows_merged_avx512(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const size_t nr_rows, const uint16_t nr_vectors, const uint16_t mod_mask) {
+    if (nr_vectors <= HALF_VEC_LANES) {
+        mult_rows_merged_half_vector(result, A, row_displacements, merged, nr_entries, nr_rows, nr_vectors, mod_mask);
+    } else {
+        mult_rows_merged_vector(result, A, row_displacements, merged, nr_entries, nr_rows, nr_vectors, mod_mask);
+    }
+}
+
+/** AVX-512 version of `pst_backend.accumulate_windows_merged`: on wide vectors */
+static TARGET_AVX512 void accumulate_windows_merged_avx512(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const uint16_t nr_vectors, const size_t offset, const size_t width) {
+    accumulate_windows_merged_wide_vector(acc, A_master, row_displacements, merged, nr_entries, nr_vectors, offset, width);
+}
+
+DEFINE_BACKEND_ELEMENTWISE(avx512, TARGET_AVX512)
+
+/**
+ * Determines whether the cpu supports the AVX2 backend.
+ *
+ * @return __1__ if supported, __0__ otherwise
+ */
+static int avx2_supported(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+/**
+ * Determines whether the cpu supports the AVX-512 backend.
+ *
+ * @return __1__ if supported, __0__ otherwise
+ */
+static int avx512_supported(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+
+#endif
+
+/** The backends, from the least to the most preferred */
+static const pst_backend backends[] = {
+    {"portable", portable_supported, mult_rows_idx_portable, accumulate_windows_portable, mult_sampled_idx_portable, mult_rows_dense_portable, mult_rows_merged_portable, accumulate_windows_merged_portable, unlift_poly_portable, unlift_poly_sessions_portable, lift_poly_portable, lift_poly_sessions_portable, compress_portable, decompress_portable, add_msg_portable, diff_msg_portable},
+    {"optimized", portable_supported, mult_rows_idx_optimized, accumulate_windows_optimized, mult_sampled_idx_optimized, mult_rows_dense_optimized, mult_rows_merged_optimized, accumulate_windows_merged_optimized, unlift_poly_optimized, unlift_poly_sessions_optimized, lift_poly_optimized, lift_poly_sessions_optimized, compress_optimized, decompress_optimized, add_msg_optimized, diff_msg_optimized},
+#ifdef PST_BACKEND_X86
+    {"avx2", avx2_supported, mult_rows_idx_avx2, accumulate_windows_avx2, mult_sampled_idx_avx2, mult_rows_dense_avx2, mult_rows_merged_avx2, accumulate_windows_merged_avx2, unlift_poly_avx2, unlift_poly_sessions_avx2, lift_poly_avx2, lift_poly_sessions_avx2, compress_avx2, decompress_avx2, add_msg_avx2, diff_msg_avx2},
+    /* The products of mult_rows_idx read scattered coefficients of A; the
+     * AVX-512 gathers (of 32-bit elements) are slower than the scalar loads,
+     * so this backend uses the optimized version */
+    {"avx512", avx512_supported, mult_rows_idx_optimized, accumulate_windows_avx512, mult_sampled_idx_avx512, mult_rows_dense_avx512, mult_rows_merged_avx512, accumulate_windows_merged_avx512, unlift_poly_avx512, unlift_poly_sessions_avx512, lift_poly_avx512, lift_poly_sessions_avx512, compress_avx512, decompress_avx512, add_msg_avx512, diff_msg_avx512},
+#endif
+};
+
+/** The number of backends */
+#define NR_BACKENDS (sizeof (backends) / sizeof (backends[0]))
+
+/** The backend in use, `NULL` until selected (accessed atomically) */
+static const pst_backend *current_backend = NULL;
+
+/**
+ * Looks up a supported backend by name.
+ *
+ * @param[in] name the name of the backend
+ * @return the backend, `NULL` if there is no such backend or if the cpu does
+ *         not support it
+ */
+static const pst_backend *find_backend(const char *name) {
+    size_t i;
+
+    for (i = 0; i < NR_BACKENDS; ++i) {
+        if (strcmp(backends[i].name, name) == 0) {
+            return backends[i].supported() ? &backends[i] : NULL;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Selects the backend to use by default: the one named by the environment
+ * variable `ROUND2_BACKEND`, or else the most preferred one the cpu supports.
+ *
+ * @return the selected backend
+ */
+static const pst_backend *default_backend(void) {
+    const char *name = getenv("ROUND2_BACKEND");
+    size_t i;
+
+    if (name != NULL && *name != '\0') {
+        const pst_backend *backend = find_backend(name);
+        if (backend != NULL) {
+            return backend;
+        }
+        fprintf(stderr, "Backend %s (ROUND2_BACKEND) is not available, using the default one\n", name);
+    }
+    for (i = NR_BACKENDS; i > 0; --i) {
+        if (backends[i - 1].supported()) {
+            return &backends[i - 1];
+        }
+    }
+
+    return &backends[0];
+}
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+const pst_backend *pst_backend_get(void) {
+    const pst_backend *backend = __atomic_load_n(&current_backend, __ATOMIC_ACQUIRE);
+
+    if (backend == NULL) {
+        /* Concurrent first calls all select the same backend */
+        backend = default_backend();
+        __atomic_store_n(&current_backend, backend, __ATOMIC_RELEASE);
+    }
+
+    return backend;
+}
+
+int pst_backend_select(const char *name) {
+    const pst_backend *backend = find_backend(name);
+
+    if (backend == NULL) {
+        return 1;
+    }
+    __atomic_store_n(&current_backend, backend, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+size_t pst_nr_backends(void) {
+    return NR_BACKENDS;
+}
+
+const pst_backend *pst_backend_at(const size_t index) {
+    return index < NR_BACKENDS ? &backends[index] : NULL;
+}
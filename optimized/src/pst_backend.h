@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Declaration of the compute backends of the core functions.
+ *
+ * The innermost kernels of `pst_core.c` and `pst_encrypt.c` (the sparse,
+ * dense and merged products, the (un)lifting of ring polynomials, the
+ * (de)compression, and the addition and removal of the message) are called
+ * through a table of function pointers, the backend. The library contains several backends,
+ * from the plain scalar portable one, the reference for the others, to
+ * vectorised versions compiled for specific instruction set extensions, and
+ * selects one at the first use: the one named by the
+ * `ROUND2_BACKEND` environment variable if it is set (and supported by the
+ * cpu), otherwise the fastest one the cpu supports. All backends give
+ * bit-identical results.
+ *
+ * @endcond
+ */
+
+#ifndef PST_BACKEND_H
+#define PST_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * An entry of a merged stream of vectors in index form, as read by the
+     * `mult_rows_merged` and `accumulate_windows_merged` kernels: the index
+     * (in the upper 16 bits), the vector the index belongs to, and whether
+     * the vector is -1 (instead of 1) at the index (bit 0). Sorted, the
+     * entries of all vectors form a single ascending stream of indices.
+     *
+     * @param[in] index     the index
+     * @param[in] vector    the vector
+     * @param[in] negative  __1__ if the vector is -1 at the index, __0__ if 1
+     * @return the entry
+     */
+#define PST_MERGED_ENTRY(index, vector, negative) ((uint32_t) (index) << 16 | (uint32_t) (vector) << 1 | (uint32_t) (negative))
+
+    /** The index of an entry of a merged stream (see `PST_MERGED_ENTRY`) */
+#define PST_MERGED_INDEX(entry) ((uint16_t) ((entry) >> 16))
+
+    /** The vector of an entry of a merged stream (see `PST_MERGED_ENTRY`) */
+#define PST_MERGED_VECTOR(entry) ((uint16_t) (((entry) >> 1) & 0x7fff))
+
+    /** Whether an entry of a merged stream is negative (see `PST_MERGED_ENTRY`) */
+#define PST_MERGED_NEGATIVE(entry) ((uint16_t) ((entry) & 1))
+
+    /** The sum of an entry of a merged stream, _2 * vector + negative_ (see `PST_MERGED_ENTRY`) */
+#define PST_MERGED_SUM(entry) ((uint16_t) ((entry) & 0xffff))
+
+    /**
+     * A compute backend: the kernels of the core functions.
+     */
+    typedef struct {
+        /** The name of the backend, as used with `ROUND2_BACKEND` */
+        const char *name;
+
+        /**
+         * Determines whether the cpu supports the backend.
+         *
+         * @return __1__ if supported, __0__ otherwise
+         */
+        int (*supported)(void);
+
+        /**
+         * Multiplies the rows of a matrix with a number of sparse ternary
+         * vectors in index form. Row _i_ of the matrix starts at
+         * `A + row_displacements[i]`, the result is stored row by row, i.e.
+         * `result[i * nr_vectors + j]` holds the product of row _i_ with
+         * vector _j_.
+         *
+         * @param[out] result             the result of the multiplication
+         * @param[in]  A                  the matrix (A_master)
+         * @param[in]  row_displacements  the start of each row within A
+         * @param[in]  idx                the vectors in index form
+         * @param[in]  nr_rows            the number of rows to multiply
+         * @param[in]  nr_vectors         the number of vectors
+         * @param[in]  h                  the hamming weight of the vectors
+         * @param[in]  mod_mask           reduction modulus bitmask for the coefficients
+         */
+        void (*mult_rows_idx)(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *idx, const size_t nr_rows, const uint16_t nr_vectors, const uint16_t h, const uint16_t mod_mask);
+
+        /**
+         * Adds (and subtracts) windows of A_master, i.e. computes for
+         * _k_ < _width_: `acc[k] = sum_l A_master[row_displacements[idx[l]] + offset + k]`,
+         * with a positive sign for the first _h/2_ indices and a negative
+         * one for the others. Without row displacements (`NULL`) the rows
+         * are the shifts of a single polynomial, i.e. row _r_ starts at
+         * `A_master + r`, as in the ring case.
+         *
+         * @param[out] acc                the accumulated windows
+         * @param[in]  A_master           A_master
+         * @param[in]  row_displacements  the start of each row within
+         *                                A_master, or `NULL`
+         * @param[in]  idx                the vector in index form
+         * @param[in]  h                  the hamming weight of the vector
+         * @param[in]  offset             the offset of the window within the rows
+         * @param[in]  width              the width of the window
+         */
+        void (*accumulate_windows)(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint16_t *idx, const uint16_t h, const size_t offset, const size_t width);
+
+        /**
+         * Computes the sampled product of a matrix and a vector in index
+         * form for a run of columns, i.e. for _c_ < _nr_cols_:
+         * `X[c * x_stride] += sum_k M[idx[k] * vectors_M + c]`, with a
+         * positive sign for the first _h/2_ indices and a negative one for
+         * the others.
+         *
+         * @param[in,out] X          the outputs to accumulate into
+         * @param[in]     x_stride   the distance between consecutive outputs
+         * @param[in]     M          the first column of the run within the matrix
+         * @param[in]     vectors_M  the number of columns of the matrix
+         * @param[in]     idx        the vector in index form
+         * @param[in]     h          the hamming weight of the vector
+         * @param[in]     nr_cols    the number of columns in the run
+         */
+        void (*mult_sampled_idx)(uint16_t *X, const size_t x_stride, const uint16_t *M, const uint16_t vectors_M, const uint16_t *idx, const uint16_t h, const size_t nr_cols);
+
+        /**
+         * Multiplies the rows of a matrix with a number of ternary vectors in
+         * dense form, the coefficients of which are 0, 1 or -1 (0xffff), i.e.
+         * computes `result[i * nr_vectors + j] = sum_k A[row_displacements[i] + k] * vectors[j * len + k]`
+         * for _k_ < _len_. The rows are read contiguously, instead of
+         * gathering the coefficients as `mult_rows_idx` does.
+         *
+         * @param[out] result             the result of the multiplication
+         * @param[in]  A                  the matrix (A_master)
+         * @param[in]  row_displacements  the start of each row within A
+         * @param[in]  vectors            the vectors in dense form
+         * @param[in]  nr_rows            the number of rows to multiply
+         * @param[in]  nr_vectors         the number of vectors
+         * @param[in]  len                the length of the vectors
+         * @param[in]  mod_mask           reduction modulus bitmask for the coefficients
+         */
+        void (*mult_rows_dense)(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *vectors, const size_t nr_rows, const uint16_t nr_vectors, const size_t len, const uint16_t mod_mask);
+
+        /**
+         * Multiplies the rows of a matrix with a number of sparse ternary
+         * vectors given as a merged stream, as `mult_rows_idx` does: each
+         * row is read in a single ascending sweep, of which each coefficient
+         * is added to (or subtracted from) the sum of its vector.
+         *
+         * @param[out] result             the result of the multiplication
+         * @param[in]  A                  the matrix (A_master)
+         * @param[in]  row_displacements  the start of each row within A
+         * @param[in]  merged             the vectors as a merged stream (see `PST_MERGED_ENTRY`)
+         * @param[in]  nr_entries         the number of entries of the stream
+         * @param[in]  nr_rows            the number of rows to multiply
+         * @param[in]  nr_vectors         the number of vectors
+         * @param[in]  mod_mask           reduction modulus bitmask for the coefficients
+         */
+        void (*mult_rows_merged)(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const size_t nr_rows, const uint16_t nr_vectors, const uint16_t mod_mask);
+
+        /**
+         * Adds windows of A_master for a number of vectors given as a merged
+         * stream, as `accumulate_windows` does for a single one: the rows are
+         * visited once, in ascending order, and the window of each is added
+         * to the sum of its vector and sign, i.e. `acc[(2 * j) * width + k]`
+         * holds the sum of the windows of the rows where vector _j_ is 1 and
+         * `acc[(2 * j + 1) * width + k]` that of those where it is -1.
+         *
+         * @param[out] acc                the accumulated windows, per vector and sign
+         * @param[in]  A_master           A_master
+         * @param[in]  row_displacements  the start of each row within
+         *                                A_master, or `NULL`
+         * @param[in]  merged             the vectors as a merged stream (see `PST_MERGED_ENTRY`)
+         * @param[in]  nr_entries         the number of entries of the stream
+         * @param[in]  nr_vectors         the number of vectors
+         * @param[in]  offset             the offset of the window within the rows
+         * @param[in]  width              the width of the window
+         */
+        void (*accumulate_windows_merged)(uint16_t *acc, const uint16_t *A_master, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_entries, const uint16_t nr_vectors, const size_t offset, const size_t width);
+
+        /**
+         * Divides a polynomial in the NTRU ring by (X - 1), the result can
+         * be taken to be in the cyclotomic ring.
+         *
+         * @param[out] cyc_pol   result
+         * @param[in]  ntru_pol  polynomial in the NTRU ring
+         * @param[in]  len       number of coefficients of the cyclotomic polynomial
+         * @param[in]  mod_mask  reduction modulus bitmask for the coefficients
+         */
+        void (*unlift_poly)(uint16_t *cyc_pol, const uint16_t *ntru_pol, const size_t len, const uint16_t mod_mask);
+
+        /**
+         * Divides the polynomials of several independent sessions by
+         * (X - 1), as `unlift_poly` does for each of them. The suffix sums
+         * of the sessions are independent, so they are computed side by
+         * side, one session per lane.
+         *
+         * @param[out] cyc_pols     results, the one of session _s_ at _cyc_pols + s * cyc_stride_
+         * @param[in]  cyc_stride   the distance between the results of consecutive sessions
+         * @param[in]  ntru_pols    polynomials in the NTRU ring, the one of session _s_ at _ntru_pols + s * ntru_stride_
+         * @param[in]  ntru_stride  the distance between the polynomials of consecutive sessions
+         * @param[in]  nr_sessions  the number of sessions
+         * @param[in]  len          number of coefficients of the cyclotomic polynomials
+         * @param[in]  mod_mask     reduction modulus bitmask for the coefficients
+         */
+        void (*unlift_poly_sessions)(uint16_t *cyc_pols, const size_t cyc_stride, const uint16_t *ntru_pols, const size_t ntru_stride, const size_t nr_sessions, const size_t len, const uint16_t mod_mask);
+
+        /**
+         * Multiplies a polynomial in the cyclotomic ring times (X - 1) and
+         * arranges the result, a polynomial in the NTRU ring X^(len+1) - 1,
+         * the way the ring multiplications read it: the coefficients 1..len
+         * are reversed and the result is stored twice, i.e.
+         * `ntru_rev[i] = ntru_rev[len + 1 + i] = ntru[(len + 1 - i) % (len + 1)]`,
+         * to remove the need for a modular reduction of the indices.
+         *
+         * @param[out] ntru_rev  result, of length _2 * (len + 1)_
+         * @param[in]  cyc_pol   polynomial in the cyclotomic ring
+         * @param[in]  len       number of coefficients of the cyclotomic polynomial
+         * @param[in]  mod_mask  reduction modulus bitmask for the coefficients
+         */
+        void (*lift_poly)(uint16_t *ntru_rev, const uint16_t *cyc_pol, const size_t len, const uint16_t mod_mask);
+
+        /**
+         * Lifts the polynomials of several independent sessions, as
+         * `lift_poly` does for each of them but without the duplicate, and
+         * interleaves the results: coefficient _i_ of the result of session
+         * _s_ is stored at _ntru_revs[i * nr_sessions + s]_.
+         *
+         * @param[out] ntru_revs    interleaved results, of length _(len + 1) * nr_sessions_
+         * @param[in]  cyc_pols     polynomials in the cyclotomic ring, the one of session _s_ at _cyc_pols + s * cyc_stride_
+         * @param[in]  cyc_stride   the distance between the polynomials of consecutive sessions
+         * @param[in]  nr_sessions  the number of sessions
+         * @param[in]  len          number of coefficients of the cyclotomic polynomials
+         * @param[in]  mod_mask     reduction modulus bitmask for the coefficients
+         */
+        void (*lift_poly_sessions)(uint16_t *ntru_revs, const uint16_t *cyc_pols, const size_t cyc_stride, const size_t nr_sessions, const size_t len, const uint16_t mod_mask);
+
+        /**
+         * Compresses values from a bits to b bits, rounding them to the
+         * nearest value.
+         *
+         * @param[in,out] x    the values to compress
+         * @param[in]     len  the number of values
+         * @param[in]     a    bitlen before compression
+         * @param[in]     b    bitlen after compression
+         */
+        void (*compress)(uint16_t *x, const size_t len, const uint16_t a, const uint16_t b);
+
+        /**
+         * Decompresses values from b bits to a bits.
+         *
+         * @param[in,out] x    the values to decompress
+         * @param[in]     len  the number of values
+         * @param[in]     a    decompressed bitlen
+         * @param[in]     b    compressed bitlen
+         */
+        void (*decompress)(uint16_t *x, const size_t len, const uint16_t a, const uint16_t b);
+
+        /**
+         * Adds the message to a matrix, _bits_coeff_ bits of the message
+         * (from the least significant bit of its first byte on) per
+         * coefficient, scaled to the most significant of the _scaling_factor_
+         * bits of the coefficients.
+         *
+         * @param[out] result          result of the addition
+         * @param[in]  len             the number of coefficients
+         * @param[in]  matrix          matrix to which to add the message
+         * @param[in]  m               message to add
+         * @param[in]  bits_coeff      number of bits added in each coefficient
+         * @param[in]  scaling_factor  scaling factor applied
+         */
+        void (*add_msg)(uint16_t *result, const size_t len, const uint16_t *matrix, const unsigned char *m, const uint16_t bits_coeff, const uint8_t scaling_factor);
+
+        /**
+         * Computes the difference `matrix_a - matrix_b` of the first _len_
+         * coefficients.
+         *
+         * @param[out] result    difference
+         * @param[in]  len       the number of coefficients
+         * @param[in]  matrix_a  first operand
+         * @param[in]  matrix_b  second operand
+         */
+        void (*diff_msg)(uint16_t *result, const size_t len, const uint16_t *matrix_a, const uint16_t *matrix_b);
+    } pst_backend;
+
+    /**
+     * Returns the backend in use, selecting it on the first call (see the
+     * description of this file).
+     *
+     * @return the backend in use
+     */
+    const pst_backend *pst_backend_get(void);
+
+    /**
+     * Selects the backend to use from now on.
+     *
+     * @param[in] name the name of the backend
+     * @return __0__ in case of success, __1__ if there is no backend with the
+     *         given name or if the cpu does not support it
+     */
+    int pst_backend_select(const char *name);
+
+    /**
+     * Returns the number of backends in the library.
+     *
+     * @return the number of backends
+     */
+    size_t pst_nr_backends(void);
+
+    /**
+     * Returns one of the backends in the library, e.g. to list them or to
+     * compare them.
+     *
+     * @param[in] index the index of the backend
+     * @return the backend, `NULL` if there is no such backend
+     */
+    const pst_backend *pst_backend_at(const size_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PST_BACKEND_H */
@@ -41,45 +41,93 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "misc.h"
 #include "randombytes.h"
 #include "drng.h"
 #include "hash.h"
 #include "a_fixed.h"
+#include "round2_probes.h"
+#include "pst_backend.h"
+#include "pst_autotune.h"
+#include "pst_parallel.h"
 
-/*******************************************************************************
- * Private functions
- ******************************************************************************/
+/**
+ * The number of consecutive coefficients computed at once by `mult_windows()`.
+ * The partial sums of one window are kept in registers while the h windows of
+ * A_master are added to them.
+ */
+#define ACCUMULATION_WINDOW 64
 
 /**
- * Sort an array of 32 bit unsigned integers in constant time.
- *
- * @param arr    pointer to the array to sort
- * @param len    length of the array
- * @return __0__ in case of success
+ * The log2 of the granularity (in elements of A_master) with which the rows are
+ * ordered by their displacement in the fn=2 kernel for B.
  */
-static int radix_sort(uint32_t *arr, size_t len) {
-    uint32_t *bucket = checked_malloc(2 * len * sizeof (*bucket));
-    uint32_t ptr[2];
-    size_t i, j;
+#define FN2_BUCKET_BITS 5
 
-    for (i = 0; i < 32; ++i) {
-        ptr[0] = 0;
-        ptr[1] = 0;
-        for (j = 0; j < len; ++j) {
-            uint8_t digit = (arr[j] >> i) & 0x1;
-            bucket[digit * len + ptr[digit]] = arr[j];
-            ++ptr[digit];
-        }
-        memcpy(arr, bucket, ptr[0] * sizeof (*arr));
-        memcpy(arr + ptr[0], bucket + len, ptr[1] * sizeof (*arr));
-    }
+/**
+ * The minimum number of rows (or columns) of the products with __A__, and of
+ * elements of A_master, per part when they are computed in parallel.
+ */
+#define PARALLEL_MIN_ROWS 64
+#define PARALLEL_MIN_ELEMENTS 16384
 
-    free(bucket);
+/**
+ * The granularity (in elements) of the parts of A_master generated in
+ * parallel: an AES block of the DRNG.
+ */
+#define PARALLEL_ELEMENTS_GRANULARITY 8
 
-    return 0;
-}
+/**
+ * The number of sessions of which the products with a shared secret vector
+ * are computed side by side, one session per lane (see
+ * `compute_X_sessions_shared()`).
+ */
+#define SESSION_LANES 16
+
+/** The variants of the products with __A__: those of `compute_B` (non-ring, fn=2 and ring) and of `compute_U` */
+#define PRODUCT_ROWS 0
+#define PRODUCT_ROWS_FN2 1
+#define PRODUCT_ROWS_RING 2
+#define PRODUCT_COLUMNS 3
+
+/** The value of `kept_A_budget` until the budget has been determined */
+#define KEPT_A_BUDGET_UNSET SIZE_MAX
+
+/**
+ * The __A__ kept by a thread (see `keep_A()`), with the seed it was created
+ * from.
+ */
+typedef struct {
+    unsigned char *sigma; /**< the seed of A */
+    uint16_t *A; /**< A_master */
+    uint32_t *A_permutation; /**< the row displacements into A_master */
+    uint16_t d; /**< the dimension of A */
+    uint16_t q; /**< the modulus of A */
+    uint8_t ss_size; /**< the size of the seed */
+    uint8_t fn; /**< the variant used for the creation of A */
+    unsigned a_fixed_generation; /**< the generation of A_fixed (fn=1) */
+} kept_A_cache;
+
+/** The budget for a kept A, in bytes (accessed atomically) */
+static size_t kept_A_budget = KEPT_A_BUDGET_UNSET;
+
+/** The number of times A_fixed has been created */
+static unsigned a_fixed_generation = 0;
+
+/** The A kept by the thread, `NULL` if none */
+static THREAD_LOCAL kept_A_cache *thread_kept_A = NULL;
+
+/** Creation of the key used to release the A kept by exiting threads */
+static pthread_once_t release_kept_A_key_once = PTHREAD_ONCE_INIT;
+
+/** The key used to release the A kept by exiting threads */
+static pthread_key_t release_kept_A_key;
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
 
 /**
  * Create a sparse ternary vector of length len from a seed.
@@ -168,161 +216,343 @@ int transform_to_index(uint16_t *idx_matrix, const int16_t *spter_matrix, size_t
 }
 
 /**
- * Multiplies a polynomial in the cyclotomic ring times (X - 1), the result can
- * be taken to be in the NTRU ring X^(len+1) - 1.
+ * Multiplies a number of sparse ternary vectors in index form with the
+ * matrix of which the rows are windows of A_master, i.e. computes for
+ * _c_ < _nr_cols_ the product of column _c_ of the matrix and each vector,
+ * where row _r_ of the matrix starts at `A + row_displacements[r]` (or at
+ * `A + r` without row displacements). The columns are computed a window of
+ * consecutive columns at a time with the `accumulate_windows` kernel of the
+ * backend, i.e. the windows of A_master are read contiguously. The result of
+ * column _c_ and vector _j_ is stored in `result[c * nr_vectors + j]`, or, if
+ * _reversed_, in `result[(nr_cols - 1 - c) * nr_vectors + j]`.
  *
- * @param[out] ntru_pol  result
- * @param[in]  cyc_pol   polynomial in the cyclotomic ring
- * @param[in]  len       number of coefficients of the cyclotomic polynomial
- * @param[in]  mod_mask  reduction modulus bitmask for the coefficients
- * @return __0__ in case of success
+ * @param[out] result             the result of the multiplication
+ * @param[in]  A                  A_master
+ * @param[in]  row_displacements  the start of each row within A_master, or `NULL`
+ * @param[in]  idx                the vectors in index form
+ * @param[in]  nr_cols            the number of columns to compute
+ * @param[in]  nr_vectors         the number of vectors
+ * @param[in]  h                  the hamming weight of the vectors
+ * @param[in]  mod_mask           reduction modulus bitmask for the coefficients
+ * @param[in]  reversed           whether the columns are stored in reverse order
  */
-static int lift_poly_2(uint16_t *ntru_pol, const int16_t *cyc_pol, const size_t len, const uint16_t mod_mask) {
-    size_t i;
-
-    ntru_pol[0] = (uint16_t) ((-cyc_pol[0]) & mod_mask);
-
-    for (i = 1; i < len; ++i) {
-        ntru_pol[i] = (uint16_t) (cyc_pol[i - 1] - cyc_pol[i]) & mod_mask;
+static void mult_windows(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *idx, const size_t nr_cols, const uint16_t nr_vectors, const uint16_t h, const uint16_t mod_mask, const int reversed) {
+    const pst_backend *backend = pst_backend_get();
+    uint16_t acc[ACCUMULATION_WINDOW];
+    size_t offset, k;
+    uint16_t j;
+
+    for (offset = 0; offset < nr_cols; offset += ACCUMULATION_WINDOW) {
+        const size_t width = offset + ACCUMULATION_WINDOW < nr_cols ? ACCUMULATION_WINDOW : nr_cols - offset;
+        for (j = 0; j < nr_vectors; ++j) {
+            backend->accumulate_windows(acc, A, row_displacements, idx + j * h, h, offset, width);
+            for (k = 0; k < width; ++k) {
+                const size_t c = reversed ? nr_cols - 1 - (offset + k) : offset + k;
+                result[c * nr_vectors + j] = acc[k] & mod_mask;
+            }
+        }
     }
+}
 
-    ntru_pol[len] = (uint16_t) cyc_pol[len - 1] & mod_mask;
+/**
+ * Merges a number of sparse ternary vectors in index form into a single
+ * stream of indices in ascending order (see `PST_MERGED_ENTRY`), with a
+ * counting sort on the index.
+ *
+ * @param[out] merged      the merged stream, of _nr_vectors * h_ entries
+ * @param[in]  idx         the vectors in index form
+ * @param[in]  nr_vectors  the number of vectors
+ * @param[in]  h           the hamming weight of the vectors
+ * @param[in]  len         the length of the vectors
+ */
+static void merge_vectors(uint32_t *merged, const uint16_t *idx, const uint16_t nr_vectors, const uint16_t h, const size_t len) {
+    size_t *index_start = checked_calloc(len + 1, sizeof (*index_start));
+    size_t i;
+    uint16_t j, l;
 
-    return 0;
+    for (i = 0; i < (size_t) nr_vectors * h; ++i) {
+        ++index_start[idx[i] + 1];
+    }
+    for (i = 1; i <= len; ++i) {
+        index_start[i] += index_start[i - 1];
+    }
+    for (j = 0; j < nr_vectors; ++j) {
+        for (l = 0; l < h; ++l) {
+            const uint16_t index = idx[j * h + l];
+            merged[index_start[index]++] = PST_MERGED_ENTRY(index, j, l >= h / 2);
+        }
+    }
 
+    free(index_start);
 }
 
 /**
- * Divides a polynomial in the NTRU ring by (X - 1), the result can
- * be taken to be in the cyclotomic ring.
+ * Multiplies a number of sparse ternary vectors, given as a merged stream,
+ * with the matrix of which the rows are windows of A_master, as
+ * `mult_windows()` does, with the `accumulate_windows_merged` kernel of the
+ * backend: for each window of consecutive columns the rows are visited once,
+ * in ascending order, for all vectors.
  *
- * @param[out] cyc_pol   result
- * @param[in]  ntru_pol  polynomial in the NTRU ring
- * @param[in]  len       number of coefficients of the cyclotomic polynomial
- * @param[in]  mod_mask  reduction modulus bitmask for the coefficients
- * @return __0__ in case of success
+ * @param[out] result             the result of the multiplication
+ * @param[in]  A                  A_master
+ * @param[in]  row_displacements  the start of each row within A_master, or `NULL`
+ * @param[in]  merged             the vectors as a merged stream
+ * @param[in]  nr_cols            the number of columns to compute
+ * @param[in]  nr_vectors         the number of vectors
+ * @param[in]  h                  the hamming weight of the vectors
+ * @param[in]  mod_mask           reduction modulus bitmask for the coefficients
+ * @param[in]  reversed           whether the columns are stored in reverse order
  */
-static int unlift_poly(uint16_t *cyc_pol, const uint16_t *ntru_pol, size_t len, const uint16_t mod_mask) {
-    int i;
-
-    cyc_pol[len - 1] = ntru_pol[len] & mod_mask;
-
-    for (i = (int) len - 2; i >= 0; --i) {
-        cyc_pol[i] = (uint16_t) (ntru_pol[i + 1] + cyc_pol[i + 1]) & mod_mask;
+static void mult_windows_merged(uint16_t *result, const uint16_t *A, const uint32_t *row_displacements, const uint32_t *merged, const size_t nr_cols, const uint16_t nr_vectors, const uint16_t h, const uint16_t mod_mask, const int reversed) {
+    const pst_backend *backend = pst_backend_get();
+    uint16_t *acc = checked_malloc(2 * (size_t) nr_vectors * ACCUMULATION_WINDOW * sizeof (*acc));
+    size_t offset, k;
+    uint16_t j;
+
+    for (offset = 0; offset < nr_cols; offset += ACCUMULATION_WINDOW) {
+        const size_t width = offset + ACCUMULATION_WINDOW < nr_cols ? ACCUMULATION_WINDOW : nr_cols - offset;
+        backend->accumulate_windows_merged(acc, A, row_displacements, merged, (size_t) nr_vectors * h, nr_vectors, offset, width);
+        for (k = 0; k < width; ++k) {
+            const size_t c = reversed ? nr_cols - 1 - (offset + k) : offset + k;
+            for (j = 0; j < nr_vectors; ++j) {
+                result[c * nr_vectors + j] = (uint16_t) (acc[2 * (size_t) j * width + k] - acc[(2 * (size_t) j + 1) * width + k]) & mod_mask;
+            }
+        }
     }
 
-    return 0;
-
+    free(acc);
 }
 
 /**
- * Multiplies a polynomial in the cyclotomic ring times (X - 1), the result can
- * be taken to be in the NTRU ring X^(len+1) - 1.
+ * A product of __A__ with the secret vectors: of the rows, as computed by
+ * `compute_B` (with _n_bar_ vectors, the rows of the NTRU ring in the ring
+ * case), or of the columns, as computed by `compute_U` (with _m_bar_
+ * vectors).
+ */
+typedef struct {
+    uint16_t *result; /**< the result, row (or column) by row, of all rows (or columns) */
+    const uint16_t *A; /**< A_master */
+    const uint32_t *row_displacements; /**< the start of each row within A_master */
+    const uint16_t *idx; /**< the vectors in index form */
+    const parameters *params; /**< the algorithm parameters in use */
+    uint16_t nr_vectors; /**< the number of vectors */
+    uint8_t variant; /**< the variant of the product (`PRODUCT_ROWS`, ...) */
+    size_t start; /**< the first row (or column) to compute */
+    size_t end; /**< the end of the rows (or columns) to compute */
+} a_product;
+
+/**
+ * A product with __A__ computed in parts, in parallel.
+ */
+typedef struct {
+    const a_product *product; /**< the product */
+    pst_engine engine; /**< the engine to compute it with */
+    size_t nr_parts; /**< the number of parts */
+    size_t granularity; /**< the granularity of the parts, in rows (or columns) */
+} a_product_parts;
+
+/**
+ * Computes a product of the rows with the sparse or merged engine, for fn=2:
+ * the rows are processed in the order of their displacement (a counting sort
+ * on the bucket), so that consecutive rows are overlapping windows of
+ * A_master, after which they are put back into place.
  *
- * @param[out] poly      polynomial to lift
- * @param[in]  len       number of coefficients of the cyclotomic polynomial
- * @param[in]  mod_mask  reduction modulus bitmask for the coefficients
- * @return __0__ in case of success
+ * @param[in] product  the product
+ * @param[in] merged   the vectors as a merged stream for the merged engine,
+ *                     `NULL` for the sparse one
  */
-static int lift_poly(uint16_t *poly, const size_t len, const uint16_t mod_mask) {
+static void mult_rows_ordered(const a_product *product, const uint32_t *merged) {
+    const parameters *params = product->params;
+    const uint16_t mod_q_mask = (uint16_t) ((1U << params->q_bits) - 1);
+    const size_t nr_rows = product->end - product->start;
+    const uint32_t *row_displacements = product->row_displacements + product->start;
+    const size_t nr_buckets = ((size_t) params->q >> FN2_BUCKET_BITS) + 1;
+    size_t *bucket_start = checked_calloc(nr_buckets + 1, sizeof (*bucket_start));
+    uint32_t *order = checked_malloc(nr_rows * sizeof (*order));
+    uint32_t *order_displacements = checked_malloc(nr_rows * sizeof (*order_displacements));
+    uint16_t *result_ordered = checked_malloc(nr_rows * product->nr_vectors * sizeof (*result_ordered));
+    uint16_t *result = product->result + product->start * product->nr_vectors;
     size_t i;
-    uint16_t aux0, aux1;
 
-    aux0 = poly[0];
-    aux1 = poly[1];
-    poly[0] = (uint16_t) ((-poly[0]) & mod_mask);
+    for (i = 0; i < nr_rows; ++i) {
+        ++bucket_start[(row_displacements[i] >> FN2_BUCKET_BITS) + 1];
+    }
+    for (i = 1; i <= nr_buckets; ++i) {
+        bucket_start[i] += bucket_start[i - 1];
+    }
+    for (i = 0; i < nr_rows; ++i) {
+        const size_t pos = bucket_start[row_displacements[i] >> FN2_BUCKET_BITS]++;
+        order[pos] = (uint32_t) i;
+        order_displacements[pos] = row_displacements[i];
+    }
 
-    for (i = 1; i < len; ++i) {
-        poly[i] = (uint16_t) ((aux0 - aux1) & mod_mask); /*(mod_mask + 1 + cyc_pol[i - 1] - cyc_pol[i]) & mod_mask;*/
-        aux0 = aux1;
-        aux1 = poly[i + 1];
+    if (merged != NULL) {
+        pst_backend_get()->mult_rows_merged(result_ordered, product->A, order_displacements, merged, (size_t) product->nr_vectors * params->h, nr_rows, product->nr_vectors, mod_q_mask);
+    } else {
+        pst_backend_get()->mult_rows_idx(result_ordered, product->A, order_displacements, product->idx, nr_rows, product->nr_vectors, params->h, mod_q_mask);
+    }
+    for (i = 0; i < nr_rows; ++i) {
+        memcpy(result + order[i] * product->nr_vectors, result_ordered + i * product->nr_vectors, product->nr_vectors * sizeof (*result));
     }
 
-    poly[len] = aux0 & mod_mask;
+    free(bucket_start);
+    free(order);
+    free(order_displacements);
+    free(result_ordered);
+}
 
-    return 0;
+/**
+ * Computes a product of the rows with the dense engine: the vectors are
+ * converted to dense form, with which the rows of __A__ are multiplied by the
+ * `mult_rows_dense` kernel of the backend.
+ *
+ * @param[in] product the product
+ */
+static void mult_rows_dense(const a_product *product) {
+    const parameters *params = product->params;
+    const uint16_t mod_q_mask = (uint16_t) ((1U << params->q_bits) - 1);
+    uint16_t *vectors = checked_calloc((size_t) product->nr_vectors * params->d, sizeof (*vectors));
+    size_t j;
+    uint16_t l;
+
+    for (j = 0; j < product->nr_vectors; ++j) {
+        const uint16_t *idx = product->idx + j * params->h;
+        for (l = 0; l < params->h; ++l) {
+            vectors[j * params->d + idx[l]] = l < params->h / 2 ? 1 : UINT16_MAX;
+        }
+    }
+    pst_backend_get()->mult_rows_dense(product->result + product->start * product->nr_vectors, product->A, product->row_displacements + product->start, vectors, product->end - product->start, product->nr_vectors, params->d, mod_q_mask);
 
+    free(vectors);
 }
 
 /**
- * Compress and round a number from a to b bits where a and b are power of 2.
+ * Computes (the rows or columns from `start` to `end` of) a product with
+ * __A__ with the given engine.
  *
- * @param[out] x  the value to round and compress
- * @param[in]  a  bitlen before compression
- * @param[in]  b  bitlen after compression
- * @return __0__ in case of success
+ * @param[in] engine   the engine
+ * @param[in] context  the product (`a_product`)
  */
-static int compress(uint16_t *x, const uint16_t a, const uint16_t b) {
-    const uint16_t shift = (uint16_t) (a - b);
-    const uint16_t rounding_mask = (uint16_t) (1 << (shift - 1));
-    const uint16_t rounding = (uint16_t) ((*x & rounding_mask) >> (shift - 1));
-    const uint16_t mask_b = (uint16_t) (((uint16_t) 1 << b) - 1);
+static void mult_A_engine(const pst_engine engine, void *context) {
+    const a_product *product = context;
+    const parameters *params = product->params;
+    const uint16_t mod_q_mask = (uint16_t) ((1U << params->q_bits) - 1);
+    const size_t nr = product->end - product->start;
+    uint16_t *result = product->result + product->start * product->nr_vectors;
+    uint32_t *merged = NULL;
+
+    if (engine == PST_ENGINE_DENSE) {
+        mult_rows_dense(product);
+        return;
+    }
 
-    *x = (uint16_t) (*x >> shift);
-    *x = (uint16_t) (*x + rounding);
+    if (engine == PST_ENGINE_MERGED) {
+        merged = checked_malloc((size_t) product->nr_vectors * params->h * sizeof (*merged));
+        merge_vectors(merged, product->idx, product->nr_vectors, params->h, params->d);
+    }
 
-    *x &= mask_b;
+    if (product->variant == PRODUCT_COLUMNS) {
+        /* Column i of A is element i of all the rows, so a run of
+         * consecutive coefficients of U is the sum of h equally long runs of
+         * A_master */
+        if (merged != NULL) {
+            mult_windows_merged(result, product->A + product->start, product->row_displacements, merged, nr, product->nr_vectors, params->h, mod_q_mask, 0);
+        } else {
+            mult_windows(result, product->A + product->start, product->row_displacements, product->idx, nr, product->nr_vectors, params->h, mod_q_mask, 0);
+        }
+    } else if (product->variant == PRODUCT_ROWS_RING) {
+        /* The rows of the ring are consecutive shifts of the lifted
+         * polynomial, row_displacements[i] = row_displacements[d] + d - i, so
+         * the rows are the columns, in reverse order, of the windows from
+         * A + row_displacements[d]: rows start..end-1 are columns
+         * d-end+1..d-start */
+        const uint16_t *windows = product->A + product->row_displacements[params->d] + (params->d + 1 - product->end);
+        if (merged != NULL) {
+            mult_windows_merged(result, windows, NULL, merged, nr, product->nr_vectors, params->h, mod_q_mask, 1);
+        } else {
+            mult_windows(result, windows, NULL, product->idx, nr, product->nr_vectors, params->h, mod_q_mask, 1);
+        }
+    } else if (product->variant == PRODUCT_ROWS_FN2) {
+        mult_rows_ordered(product, merged);
+    } else if (merged != NULL) {
+        pst_backend_get()->mult_rows_merged(result, product->A, product->row_displacements + product->start, merged, (size_t) product->nr_vectors * params->h, nr, product->nr_vectors, mod_q_mask);
+    } else {
+        pst_backend_get()->mult_rows_idx(result, product->A, product->row_displacements + product->start, product->idx, nr, product->nr_vectors, params->h, mod_q_mask);
+    }
 
-    return 0;
+    free(merged);
 }
 
 /**
- * Decompress a number from b to a bits where a and b are power of 2.
+ * Computes a part of a product with __A__, for `pst_parallel_run()`.
  *
- * @param[out] x  the value to decompress
- * @param[in]  a  decompressed bitlen
- * @param[in]  b  compressed bitlen
- * @return __0__ in case of success
+ * @param[in] part     the part
+ * @param[in] context  the product in parts (`a_product_parts`)
  */
-static int decompress(uint16_t *x, const uint16_t a, const uint16_t b) {
-    const uint16_t shift = (uint16_t) (a - b);
-    const uint16_t mask_a = (uint16_t) (((uint16_t) 1 << a) - 1);
-
-    *x = (uint16_t) (*x << shift);
-    *x &= mask_a;
-
-    return 0;
+static void mult_A_part(const size_t part, void *context) {
+    const a_product_parts *parts = context;
+    const size_t nr = parts->product->end - parts->product->start;
+    a_product product = *parts->product;
+
+    product.start = parts->product->start + pst_parallel_start(part, parts->nr_parts, nr, parts->granularity);
+    product.end = parts->product->start + pst_parallel_start(part + 1, parts->nr_parts, nr, parts->granularity);
+    mult_A_engine(parts->engine, &product);
 }
 
 /**
- * Computes a coefficient of X
+ * Computes a product with __A__ with the engine chosen by the autotuner,
+ * in parallel on the thread pool of the calling thread, if any.
  *
- * @param[in] U
- * @param[in] S_idx
- * @param[in] i
- * @param[in] j
- * @param[in] l
- * @param[in] range_i
- * @param[in] row_displacements
- * @param[in] params
- * @param[in] bits
- * @return __X[i,j,l]__
+ * @param[in] product the product
  */
-static uint16_t compute_X_idx(const uint16_t *U, const uint16_t *S_idx, uint32_t i,
-        uint32_t j, uint32_t l, const uint32_t range_i, const uint32_t *row_displacements, const parameters *params, const uint16_t bits) {
-    uint32_t k;
-    size_t index;
-
-    uint16_t U_val;
-    uint16_t X_val = 0;
-    uint16_t mod_bits_mask = (uint16_t) ((1U << bits) - 1);
+static void mult_A(a_product *product) {
+    const parameters *params = product->params;
+    const unsigned engines = product->variant == PRODUCT_COLUMNS
+            ? PST_ENGINE_BIT(PST_ENGINE_SPARSE) | PST_ENGINE_BIT(PST_ENGINE_MERGED)
+            : PST_ENGINE_BIT(PST_ENGINE_SPARSE) | PST_ENGINE_BIT(PST_ENGINE_MERGED) | PST_ENGINE_BIT(PST_ENGINE_DENSE);
+    a_product_parts parts;
+
+    parts.product = product;
+    parts.engine = pst_autotune_engine(params->d, params->h, product->nr_vectors, product->variant, engines, mult_A_engine, product);
+    parts.nr_parts = pst_parallel_parts(product->end - product->start, PARALLEL_MIN_ROWS);
+    /* The windows of consecutive columns are computed together */
+    parts.granularity = product->variant == PRODUCT_COLUMNS || product->variant == PRODUCT_ROWS_RING ? ACCUMULATION_WINDOW : 1;
+    pst_parallel_run(parts.nr_parts, mult_A_part, &parts);
+}
 
-    for (k = 0; k < params->h / 2; ++k) {
-        index = (size_t) ((S_idx[i * params->h + k]));
-        U_val = U[j + index * range_i + row_displacements[l] ];
-        X_val = (uint16_t) (X_val + U_val);
-    }
+/**
+ * The generation of the random elements of A_master, in parts.
+ */
+typedef struct {
+    uint16_t *elements; /**< the elements */
+    size_t nr_elements; /**< the number of elements */
+    size_t nr_parts; /**< the number of parts */
+    const unsigned char *seed; /**< the seed of the DRNG */
+    uint8_t seed_size; /**< the size of the seed */
+    uint16_t mod_q; /**< reduction modulus bitmask for the elements */
+} elements_parts;
 
+/**
+ * Generates a part of the random elements of A_master, for
+ * `pst_parallel_run()`: the DRNG runs in counter mode, so a part is
+ * generated by seeking to its start in the stream of random bytes.
+ *
+ * @param[in] part     the part
+ * @param[in] context  the generation (`elements_parts`)
+ */
+static void create_elements_part(const size_t part, void *context) {
+    const elements_parts *parts = context;
+    const size_t start = pst_parallel_start(part, parts->nr_parts, parts->nr_elements, PARALLEL_ELEMENTS_GRANULARITY);
+    const size_t end = pst_parallel_start(part + 1, parts->nr_parts, parts->nr_elements, PARALLEL_ELEMENTS_GRANULARITY);
+    size_t i;
 
-    for (k = params->h / 2; k < params->h; ++k) {
-        index = (size_t) ((S_idx[i * params->h + k]));
-        U_val = U[j + index * range_i + row_displacements[l] ];
-        X_val = (uint16_t) (X_val - U_val);
+    init_drng(parts->seed, parts->seed_size);
+    drng_seek(start * sizeof (*parts->elements));
+    drng((unsigned char *) (parts->elements + start), (end - start) * sizeof (*parts->elements));
+    /* Mask elements in A_master to be in Z_q */
+    for (i = start; i < end; ++i) {
+        parts->elements[i] &= parts->mod_q;
     }
-
-    X_val &= mod_bits_mask;
-
-    return X_val;
 }
 
 /**
@@ -426,6 +656,11 @@ static int create_A_master(uint16_t *A_master, uint8_t fn, const unsigned char *
     if (fn == 1) {
         if (A_fixed == NULL) {
             fprintf(stderr, "A_fixed has not been initialised, use create_A_fixed() to initialise it.\n");
+            exit(EXIT_FAILURE);
+        }
+        if (A_fixed_d != params->d || A_fixed_q != params->q) {
+            fprintf(stderr, "Error: A_fixed was created for d=%hu, q=%hu, not for d=%hu, q=%hu.\n", A_fixed_d, A_fixed_q, params->d, params->q);
+            exit(EXIT_FAILURE);
         }
         /* A_master is a copy of A_fixed but now with all rows duplicated to prevent having to mod d the permutation later */
         for (i = 0; i < params->d; ++i) {
@@ -435,6 +670,8 @@ static int create_A_master(uint16_t *A_master, uint8_t fn, const unsigned char *
         }
     } else {
         uint32_t num_elements;
+        uint16_t *elements;
+        elements_parts parts;
         unsigned char *prefixed_sigma = checked_malloc(2U + params->ss_size);
         unsigned char *seed = checked_malloc(params->ss_size);
 
@@ -459,26 +696,24 @@ static int create_A_master(uint16_t *A_master, uint8_t fn, const unsigned char *
         prefixed_sigma[1] = 0;
         memcpy(prefixed_sigma + 2, sigma, params->ss_size);
         hash(seed, prefixed_sigma, 2U + params->ss_size, params->ss_size);        
-        init_drng(seed, params->ss_size);
 
-        /* Create a random A_master */
-        drng((unsigned char *) A_master, num_elements * sizeof (*A_master));
-        /* Mask elements in A_master to be in Z_q */
-        for (i = 0; i < num_elements; ++i) {
-            A_master[i] &= mod_q;
-        }
+        /* Create a random A_master (in the ring case the cyclotomic
+         * polynomial is lifted into A_master afterwards), in parallel on the
+         * thread pool of the calling thread, if any */
+        elements = fn == 3 ? checked_malloc(num_elements * sizeof (*elements)) : A_master;
+        parts.elements = elements;
+        parts.nr_elements = num_elements;
+        parts.nr_parts = pst_parallel_parts(num_elements, PARALLEL_MIN_ELEMENTS);
+        parts.seed = seed;
+        parts.seed_size = params->ss_size;
+        parts.mod_q = mod_q;
+        pst_parallel_run(parts.nr_parts, create_elements_part, &parts);
 
         if (fn == 2) {
             memcpy(A_master + num_elements, A_master, params->d * sizeof (*A_master));
         } else if (fn == 3) {
-            uint16_t *aux = checked_malloc((size_t) (params->d + 1) * sizeof (*aux));
-            lift_poly_2(aux, (int16_t*) A_master, params->d, (uint16_t) (params->q - 1));
-            A_master[0] = aux[0];
-            for (i = 1; i < (size_t) (params->d + 1); ++i) {
-                A_master[i] = aux[(size_t) (params->d + 1) - i];
-            }
-            memcpy(A_master + (params->d + 1), A_master, (size_t) (params->d + 1) * sizeof (*A_master));
-            free(aux);
+            pst_backend_get()->lift_poly(A_master, elements, params->d, (uint16_t) (params->q - 1));
+            free(elements);
         }
 
         free(seed);
@@ -488,10 +723,142 @@ static int create_A_master(uint16_t *A_master, uint8_t fn, const unsigned char *
     return 0;
 }
 
+/**
+ * The ring part of compute_X() and compute_X_prime(): the last mu + 1
+ * coefficients of the product, in the NTRU ring, of a polynomial and a
+ * secret vector in index form.
+ *
+ * @param[out] auxx      the mu + 1 coefficients
+ * @param[in]  M         the polynomial (_B_ or _U_)
+ * @param[in]  idx       the secret vector in index form (_R_ or _S_)
+ * @param[in]  params    the algorithm parameters in use
+ * @param[in]  mu        the number of values of X
+ * @param[in]  mod_mask  reduction modulus bitmask for the coefficients
+ */
+static void mult_ring_tail(uint16_t *auxx, const uint16_t *M, const uint16_t *idx, const parameters *params, const uint16_t mu, const uint16_t mod_mask) {
+    const uint16_t len = (uint16_t) (params->d + 1);
+    uint16_t *M_aux;
+
+    /*Moved to NTRU ring, rearranged and duplicated to remove need of module operation*/
+    /*This code only works for n_bar = 1*/
+    M_aux = checked_malloc((size_t) (2 * len) * sizeof (*M_aux));
+    pst_backend_get()->lift_poly(M_aux, M, (size_t) (len - 1), mod_mask);
+
+    /* The last mu + 1 elements of the NTRU polynomial, auxx[l] is the product
+     * of idx and the row starting at M_aux + mu + 1 - l, i.e. the rows are
+     * the columns, in reverse order, of the windows from M_aux + 1 */
+    mult_windows(auxx, M_aux + 1, NULL, idx, (size_t) (mu + 1), 1, params->h, mod_mask, 1);
+
+    free(M_aux);
+}
+
+/**
+ * Determines the budget for a kept __A__ set with the environment variable
+ * `ROUND2_KEPT_A_BUDGET`.
+ *
+ * @return the budget, `ROUND2_KEPT_A_BUDGET` if not set
+ */
+static size_t default_kept_A_budget(void) {
+    const char *value = getenv("ROUND2_KEPT_A_BUDGET");
+
+    if (value != NULL && *value != '\0') {
+        char *end;
+        const unsigned long budget = strtoul(value, &end, 10);
+        if (*end == '\0' && budget < KEPT_A_BUDGET_UNSET) {
+            return (size_t) budget;
+        }
+        fprintf(stderr, "Budget %s (ROUND2_KEPT_A_BUDGET) is not a number of bytes, using the default one\n", value);
+    }
+
+    return (size_t) ROUND2_KEPT_A_BUDGET;
+}
+
+/**
+ * Determines the number of elements of A_master as created by `create_A()`.
+ *
+ * @param[in] fn      the variant used for the creation of A
+ * @param[in] params  the algorithm parameters in use
+ * @return the number of elements of A_master
+ */
+static size_t A_master_length(const uint8_t fn, const parameters *params) {
+    switch (fn) {
+        case 0:
+            return (size_t) params->d * params->d;
+        case 1:
+            return 2 * (size_t) params->d * params->d;
+        case 2:
+            return (size_t) params->q + params->d;
+        default:
+            return 2 * ((size_t) params->d + 1);
+    }
+}
+
+/**
+ * Determines whether the A kept by a thread is the given one.
+ *
+ * @param[in] kept    the A kept by the thread, if any
+ * @param[in] fn      the variant used for the creation of A
+ * @param[in] sigma   the seed of A
+ * @param[in] params  the algorithm parameters in use
+ * @return __1__ if it is the same A, __0__ otherwise
+ */
+static int is_kept_A(const kept_A_cache *kept, const uint8_t fn, const unsigned char *sigma, const parameters *params) {
+    return kept != NULL
+            && kept->fn == fn
+            && kept->d == params->d
+            && kept->q == params->q
+            && kept->ss_size == params->ss_size
+            && (fn != 1 || kept->a_fixed_generation == a_fixed_generation)
+            && memcmp(kept->sigma, sigma, params->ss_size) == 0;
+}
+
+/**
+ * Releases an A kept by a thread.
+ *
+ * @param[in] kept  the A kept by the thread
+ */
+static void release_kept_A(void *kept) {
+    kept_A_cache *cache = kept;
+
+    free(cache->sigma);
+    free(cache->A);
+    free(cache->A_permutation);
+    free(cache);
+}
+
+/**
+ * Creates the key used to release the A kept by exiting threads.
+ */
+static void create_release_kept_A_key(void) {
+    pthread_key_create(&release_kept_A_key, release_kept_A);
+}
+
 /*******************************************************************************
  * Public functions
  ******************************************************************************/
 
+TARGET_CLONES int radix_sort(uint32_t *arr, size_t len) {
+    uint32_t *bucket = checked_malloc(2 * len * sizeof (*bucket));
+    uint32_t ptr[2];
+    size_t i, j;
+
+    for (i = 0; i < 32; ++i) {
+        ptr[0] = 0;
+        ptr[1] = 0;
+        for (j = 0; j < len; ++j) {
+            uint8_t digit = (arr[j] >> i) & 0x1;
+            bucket[digit * len + ptr[digit]] = arr[j];
+            ++ptr[digit];
+        }
+        memcpy(arr, bucket, ptr[0] * sizeof (*arr));
+        memcpy(arr + ptr[0], bucket + len, ptr[1] * sizeof (*arr));
+    }
+
+    free(bucket);
+
+    return 0;
+}
+
 int create_A_fixed(const unsigned char *seed, const uint8_t seed_size, const parameters *params) {
     const size_t len_a_fixed = (size_t) (params->d * params->d);
     const uint16_t mod_q = (uint16_t) ((1U << params->q_bits) - 1);
@@ -499,6 +866,10 @@ int create_A_fixed(const unsigned char *seed, const uint8_t seed_size, const par
 
     /* (Re)allocate space for A_fixed */
     A_fixed = realloc(A_fixed, len_a_fixed * sizeof (*A_fixed));
+    A_fixed_d = params->d;
+    A_fixed_q = params->q;
+    /* The A kept for the previous A_fixed are no longer valid */
+    ++a_fixed_generation;
 
     /* Create A_fixed randomly */
     init_drng(seed, seed_size);
@@ -516,6 +887,8 @@ int create_A(uint16_t *A_master, uint32_t *A_permutation, const uint8_t fn, cons
     unsigned char *prefixed_sigma = checked_malloc(2U + params->ss_size);
     unsigned char *seed = checked_malloc(params->ss_size);
 
+    ROUND2_PROBE(create_A_entry, params, fn);
+
     /* Create of A_master */
     create_A_master(A_master, fn, sigma, params);
 
@@ -549,6 +922,8 @@ int create_A(uint16_t *A_master, uint32_t *A_permutation, const uint8_t fn, cons
 
     free(seed);
 
+    ROUND2_PROBE(create_A_return, params, fn);
+
     return 0;
 }
 
@@ -557,6 +932,8 @@ int create_S(int16_t *S, uint16_t *S_idx, const parameters *params) {
     size_t len = (size_t) params->d;
     unsigned char *seed;
 
+    ROUND2_PROBE(create_S_entry, params, -1);
+
     seed = checked_malloc(params->ss_size);
 
     for (i = 0; i < params->n_bar; ++i) {
@@ -568,6 +945,8 @@ int create_S(int16_t *S, uint16_t *S_idx, const parameters *params) {
 
     free(seed);
 
+    ROUND2_PROBE(create_S_return, params, -1);
+
     return 0;
 }
 
@@ -577,6 +956,8 @@ int create_R(uint16_t *R_idx, const unsigned char *rho, const parameters *params
     unsigned char *seed;
     int16_t *R = checked_malloc((size_t) (params->d * params->m_bar) * sizeof (*R));
 
+    ROUND2_PROBE(create_R_entry, params, -1);
+
     seed = checked_malloc(params->ss_size);
     init_drng(rho, params->ss_size);
 
@@ -590,90 +971,148 @@ int create_R(uint16_t *R_idx, const unsigned char *rho, const parameters *params
     free(seed);
     free(R);
 
+    ROUND2_PROBE(create_R_return, params, -1);
+
     return 0;
 }
 
 int compute_B(uint16_t *B, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *S_idx, const parameters *params) {
-    int i, j, l;
-    size_t len_b = 0;
-    size_t idx = 0;
-    uint16_t A_val;
-    size_t index = 0;
     uint16_t mod_q_mask = (uint16_t) ((1U << params->q_bits) - 1);
-    uint16_t *B_aux;
-    uint16_t loops;
+
+    ROUND2_PROBE(compute_B_entry, params, -1);
 
     if (params->n != 1) { /*in the ring case, we need to lift first and reserve a position of memory more.*/
-        len_b = (size_t) ((params->d + 1) * params->n_bar);
-        loops = (uint16_t) (params->d + 1);
-    } else {
-        len_b = (size_t) ((params->d) * params->n_bar);
-        loops = params->d;
-    }
+        uint16_t *B_aux = checked_malloc((size_t) ((params->d + 1) * params->n_bar) * sizeof (*B_aux));
+        a_product product = {B_aux, A, row_displacements, S_idx, params, params->n_bar, PRODUCT_ROWS_RING, 0, (size_t) params->d + 1};
+        uint16_t j;
 
-    B_aux = checked_malloc((len_b) * sizeof (*B_aux));
-    memset(B_aux, 0, len_b * sizeof (*B_aux));
+        mult_A(&product);
 
-    for (i = 0; i < loops; ++i) {
+        /*Unlift for the ring case.*/
         for (j = 0; j < params->n_bar; ++j) {
-            for (l = 0; l < params->h / 2; ++l) { /* Positions where S = 1 */
-                index = (size_t) ((S_idx[j * params->h + l]));
-                A_val = A[index + row_displacements[i]];
-                B_aux[idx] = (uint16_t) (B_aux[idx] + A_val);
-            }
-            for (l = params->h / 2; l < params->h; ++l) { /* Positions where S = -1 */
-                index = (size_t) ((S_idx[j * params->h + l]));
-                A_val = A[index + row_displacements[i]];
-                B_aux[idx] = (uint16_t) (B_aux[idx] - A_val);
-            }
-            B_aux[idx] &= mod_q_mask;
-            ++idx;
+            pst_backend_get()->unlift_poly(B, B_aux, params->n, mod_q_mask);
         }
-    }
 
-    /*Unlift for the ring case.*/
-    if (params->n != 1) {
-        for (j = 0; j < params->n_bar; ++j) {
-            unlift_poly(B, B_aux, params->n, mod_q_mask);
-        }
+        free(B_aux);
     } else {
-        memcpy(B, B_aux, (size_t) (params->d * params->n_bar) * sizeof (uint16_t));
+        a_product product = {B, A, row_displacements, S_idx, params, params->n_bar, PRODUCT_ROWS, 0, params->d};
+        mult_A(&product);
     }
 
+    ROUND2_PROBE(compute_B_return, params, -1);
+
+    return 0;
+}
+
+int compute_B_sessions(uint16_t *B, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *S_idx, const size_t nr_sessions, const parameters *params) {
+    const uint16_t mod_q_mask = (uint16_t) ((1U << params->q_bits) - 1);
+    const size_t len = (size_t) params->d + 1;
+    uint16_t *B_aux = checked_malloc(nr_sessions * len * sizeof (*B_aux));
+    size_t s;
+
+    ROUND2_PROBE(compute_B_sessions_entry, params, 3);
+
+    /* The products of the sessions, one by one, in the NTRU ring */
+    for (s = 0; s < nr_sessions; ++s) {
+        a_product product = {B_aux + s * len, A + s * 2 * len, row_displacements, S_idx + s * params->h, params, 1, PRODUCT_ROWS_RING, 0, len};
+        mult_A(&product);
+    }
+
+    /* Unlifted side by side, one session per lane */
+    pst_backend_get()->unlift_poly_sessions(B, params->n, B_aux, len, nr_sessions, params->n, mod_q_mask);
+
     free(B_aux);
 
+    ROUND2_PROBE(compute_B_sessions_return, params, 3);
+
     return 0;
 }
 
 int compute_U(uint16_t *U, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *R_idx, const parameters *params) {
-    int j, l;
-    uint32_t i;
-    size_t len_u = (size_t) (params->d * params->m_bar);
+    a_product product = {U, A, row_displacements, R_idx, params, params->m_bar, PRODUCT_COLUMNS, 0, params->d};
 
-    size_t idx = 0;
-    uint16_t A_val;
-    size_t index = 0;
-    uint16_t mod_q = (uint16_t) ((1U << params->q_bits) - 1);
+    ROUND2_PROBE(compute_U_entry, params, -1);
 
-    memset(U, 0, len_u * sizeof (*U));
+    mult_A(&product);
 
-    for (i = 0; i < params->d; ++i) {
-        for (j = 0; j < params->m_bar; ++j) {
-            for (l = 0; l < params->h / 2; ++l) {
-                index = (size_t) ((R_idx[j * params->h + l]));
-                A_val = A[i + row_displacements[index]];
-                U[idx] = (uint16_t) (U[idx] + A_val);
-            }
-            for (l = params->h / 2; l < params->h; ++l) {
-                index = (size_t) ((R_idx[j * params->h + l]));
-                A_val = A[i + row_displacements[index]];
-                U[idx] = (uint16_t) (U[idx] - A_val);
-            }
-            U[idx] &= mod_q;
-            ++idx;
-        }
+    ROUND2_PROBE(compute_U_return, params, -1);
+
+    return 0;
+}
+
+void set_kept_A_budget(const size_t budget) {
+    __atomic_store_n(&kept_A_budget, budget < KEPT_A_BUDGET_UNSET ? budget : budget - 1, __ATOMIC_RELEASE);
+}
+
+size_t get_kept_A_budget(void) {
+    size_t budget = __atomic_load_n(&kept_A_budget, __ATOMIC_ACQUIRE);
+
+    if (budget == KEPT_A_BUDGET_UNSET) {
+        budget = default_kept_A_budget();
+        __atomic_store_n(&kept_A_budget, budget, __ATOMIC_RELEASE);
+    }
+
+    return budget;
+}
+
+int use_kept_A(const uint8_t fn, const parameters *params) {
+    const size_t size = A_master_length(fn, params) * sizeof (uint16_t) + ((size_t) params->d + 1) * sizeof (uint32_t);
+
+    return size <= get_kept_A_budget();
+}
+
+int keep_A(uint16_t *A, uint32_t *A_permutation, const uint8_t fn, const unsigned char *sigma, const parameters *params) {
+    kept_A_cache *kept = thread_kept_A;
+
+    if (!use_kept_A(fn, params)) {
+        return 0;
+    }
+
+    if (kept == NULL) {
+        kept = checked_calloc(1, sizeof (*kept));
+        thread_kept_A = kept;
+        /* Released when the thread exits */
+        pthread_once(&release_kept_A_key_once, create_release_kept_A_key);
+        pthread_setspecific(release_kept_A_key, kept);
     }
 
+    /* Replace the A kept before */
+    free(kept->sigma);
+    free(kept->A);
+    free(kept->A_permutation);
+    kept->sigma = checked_malloc(params->ss_size);
+    memcpy(kept->sigma, sigma, params->ss_size);
+    kept->A = A;
+    kept->A_permutation = A_permutation;
+    kept->d = params->d;
+    kept->q = params->q;
+    kept->ss_size = params->ss_size;
+    kept->fn = fn;
+    kept->a_fixed_generation = a_fixed_generation;
+
+    return 1;
+}
+
+const uint16_t *get_kept_A(const uint32_t **A_permutation, const uint8_t fn, const unsigned char *sigma, const parameters *params) {
+    const kept_A_cache *kept = thread_kept_A;
+
+    if (!use_kept_A(fn, params) || !is_kept_A(kept, fn, sigma, params)) {
+        return NULL;
+    }
+    *A_permutation = kept->A_permutation;
+
+    return kept->A;
+}
+
+int compute_B_fn2(uint16_t *B, const uint16_t *A_master, const uint32_t *row_displacements, const uint16_t *S_idx, const parameters *params) {
+    a_product product = {B, A_master, row_displacements, S_idx, params, params->n_bar, PRODUCT_ROWS_FN2, 0, params->d};
+
+    ROUND2_PROBE(compute_B_fn2_entry, params, 2);
+
+    mult_A(&product);
+
+    ROUND2_PROBE(compute_B_fn2_return, params, 2);
+
     return 0;
 }
 
@@ -685,216 +1124,187 @@ int compute_U(uint16_t *U, const uint16_t *A, const uint32_t *row_displacements,
 int compute_X(uint16_t *X, const uint16_t *B, const uint16_t *R_idx, const parameters *params, const uint16_t mod_bits, const uint16_t vectors_B, const uint16_t vectors_R) {
     uint32_t i = 0;
     uint32_t j = 0;
-    uint32_t l = 0;
-    uint32_t *row_displacements;
     uint16_t mod_mask = (uint16_t) ((1U << mod_bits) - 1);
 
-    uint16_t *B_aux;
     uint16_t *auxx;
 
-    size_t idx = 0;
     uint16_t mu = (uint16_t) (params->ss_size * 8 / params->B);
-    uint16_t len = 0;
-    uint16_t loop = 0;
 
-    if (params->d != params->n) { /* Non-ring */
-        len = params->d;
-        loop = mu;
+    ROUND2_PROBE(compute_X_entry, params, -1);
 
-        /*Fake permutation for unity*/
-        row_displacements = checked_malloc(len * sizeof (*row_displacements));
-        for (i = 0; i < params->d; ++i) {
-            row_displacements[i] = i;
+    if (params->d != params->n) { /* Non-ring */
+        /* X[t] is the product of column vectors_B - 1 - (mu - 1 - t) / vectors_R
+         * of B and vector vectors_R - 1 - (mu - 1 - t) % vectors_R of R, so
+         * each vector of R is multiplied with a run of the last columns of B */
+        memset(X, 0, mu * sizeof (*X));
+        for (j = 0; j < vectors_R; ++j) {
+            const uint32_t minor = vectors_R - 1U - j;
+            if (minor < mu) {
+                const uint32_t nr_cols = (mu - minor + vectors_R - 1U) / vectors_R;
+                pst_backend_get()->mult_sampled_idx(X + mu - 1U - minor - (nr_cols - 1U) * vectors_R, vectors_R, B + vectors_B - nr_cols, vectors_B, R_idx + j * params->h, params->h, nr_cols);
+            }
         }
-
-        /*Copy to auxiliary vector*/
-        B_aux = checked_malloc((size_t) (len * vectors_B) * sizeof (*B));
-        memcpy(B_aux, B, (size_t) (len * vectors_B) * sizeof (uint16_t));
-
-    } else { /* Ring */
-        loop = (uint16_t) (mu + 1);
-        len = (uint16_t) (params->d + 1);
-
-        B_aux = checked_malloc((size_t) (2 * len * vectors_B) * sizeof (*B));
-        memcpy(B_aux, B, (size_t) ((len - 1) * vectors_B) * sizeof (uint16_t));
-
-        /*Moved to NTRU ring*/
-        lift_poly(B_aux, (size_t) (len - 1), mod_mask);
-
-        /*Compute NTRU permutation adapted to compute the last mu elements of cyclotomic polynomial
-          Otherwise, it should be row_displacements[i] = len - i;
-         */
-        row_displacements = checked_malloc(len * sizeof (*row_displacements));
-        row_displacements[0] = (mu + 1U) % len;
-        for (i = 1; i < loop; ++i) {
-            row_displacements[i] = mu + 1U - i;
+        for (i = 0; i < mu; ++i) {
+            X[i] &= mod_mask;
         }
 
-        /*Rearrange elements*/
-        auxx = checked_malloc((len) * sizeof (*auxx));
-        memcpy(auxx, B_aux, (len) * sizeof (uint16_t));
-        for (i = 1; i < len; ++i) {
-            B_aux[i] = auxx[len - i];
-        }
-        free(auxx);
+        ROUND2_PROBE(compute_X_return, params, -1);
 
-        /*Duplicate vector to remove need of module operation*/
-        /*This code only works for n_bar = 1*/
-        memcpy(B_aux + len, B_aux, len * sizeof (uint16_t));
+        return 0;
     }
 
+    /* Ring */
+
     /*Auxiliary variable to store the results.*/
-    auxx = checked_malloc((loop) * sizeof (*auxx));
-    memset(auxx, 0, (loop) * sizeof (*X));
-
-    /*Main code to compute X and X'*/
-    l = 0;
-    i = (uint32_t) (vectors_B - 1);
-    j = vectors_R;
-    for (idx = 0; idx < loop; ++idx) {
-        if (l == params->n) {
-            l = 0;
-            --j;
-            if (j == 0) {
-                j = vectors_R;
-                --i;
-            }
-        }
-        auxx[idx] = compute_X_idx(B_aux, R_idx, j - 1, i, l, (uint32_t) vectors_B, row_displacements, params, mod_bits);
-        l++;
-    }
+    auxx = checked_malloc((size_t) (mu + 1) * sizeof (*auxx));
 
-    /* In case of the ring, convert to cyclotomic polynomial*/
-    if (params->d == params->n) {
-        unlift_poly(X, auxx, mu, mod_mask);
-    } else {
-        for (i = 0; i < mu; ++i) {
-            X[i] = auxx[mu - 1U - i];
-        }
-    }
+    mult_ring_tail(auxx, B, R_idx, params, mu, mod_mask);
+
+    /* Convert to cyclotomic polynomial*/
+    pst_backend_get()->unlift_poly(X, auxx, mu, mod_mask);
 
-    free(row_displacements);
-    free(B_aux);
     free(auxx);
 
+    ROUND2_PROBE(compute_X_return, params, -1);
+
     return 0;
 }
 
 int compute_X_prime(uint16_t *X, const uint16_t *U, const uint16_t *S_idx, const parameters *params, const uint16_t mod_bits, const uint16_t vectors_U, const uint16_t vectors_S) {
     uint32_t i = 0;
     uint32_t j = 0;
-    uint32_t l = 0;
-    uint32_t *row_displacements;
     uint16_t mod_mask = (uint16_t) ((1U << mod_bits) - 1);
 
-    uint16_t *U_aux;
     uint16_t *auxx;
 
-    size_t idx = 0;
     uint16_t mu = (uint16_t) (params->ss_size * 8 / params->B);
-    uint16_t len = 0;
-    uint16_t loop = 0;
 
-    if (params->d != params->n) { /* Non-ring */
-        len = params->d;
-        loop = mu;
+    ROUND2_PROBE(compute_X_prime_entry, params, -1);
 
-        /*Fake permutation for unity*/
-        row_displacements = checked_malloc(len * sizeof (*row_displacements));
-        for (i = 0; i < params->d; ++i) {
-            row_displacements[i] = i;
+    if (params->d != params->n) { /* Non-ring */
+        /* X[t] is the product of column vectors_U - 1 - (mu - 1 - t) % vectors_U
+         * of U and vector vectors_S - 1 - (mu - 1 - t) / vectors_U of S, so
+         * each vector of S is multiplied with a run of the last columns of U */
+        memset(X, 0, mu * sizeof (*X));
+        for (j = 0; j < vectors_S; ++j) {
+            const uint32_t major = (vectors_S - 1U - j) * vectors_U;
+            if (major < mu) {
+                const uint32_t nr_cols = mu - major < vectors_U ? mu - major : vectors_U;
+                pst_backend_get()->mult_sampled_idx(X + mu - major - nr_cols, 1, U + vectors_U - nr_cols, vectors_U, S_idx + j * params->h, params->h, nr_cols);
+            }
+        }
+        for (i = 0; i < mu; ++i) {
+            X[i] &= mod_mask;
         }
 
-        /*Copy to auxiliary vector*/
-        U_aux = checked_malloc((size_t) (len * vectors_U) * sizeof (*U));
-        memcpy(U_aux, U, (size_t) (len * vectors_U) * sizeof (uint16_t));
+        ROUND2_PROBE(compute_X_prime_return, params, -1);
 
-    } else { /* Ring */
-        loop = (uint16_t) (mu + 1);
-        len = (uint16_t) (params->d + 1);
+        return 0;
+    }
 
-        U_aux = checked_malloc((size_t) (2 * len * vectors_U) * sizeof (*U));
-        memcpy(U_aux, U, (size_t) ((len - 1) * vectors_U) * sizeof (uint16_t));
+    /* Ring */
 
-        /*Moved to NTRU ring*/
-        lift_poly(U_aux, (size_t) (len - 1), mod_mask);
+    /*Auxiliary variable to store the results.*/
+    auxx = checked_malloc((size_t) (mu + 1) * sizeof (*auxx));
 
-        /*Compute NTRU permutation adapted to compute the last mu elements of cyclotomic polynomial
-          Otherwise, it should be row_displacements[i] = len - i;
-         */
-        row_displacements = checked_malloc(len * sizeof (*row_displacements));
-        row_displacements[0] = (uint32_t) (mu + 1U) % len;
-        for (i = 1; i < loop; ++i) {
-            row_displacements[i] = mu + 1U - i;
-        }
+    mult_ring_tail(auxx, U, S_idx, params, mu, mod_mask);
 
-        /*Rearrange elements*/
-        auxx = checked_malloc((len) * sizeof (*auxx));
-        memcpy(auxx, U_aux, (len) * sizeof (uint16_t));
-        for (i = 1; i < len; ++i) {
-            U_aux[i] = auxx[len - i];
-        }
-        free(auxx);
+    /* Convert to cyclotomic polynomial*/
+    pst_backend_get()->unlift_poly(X, auxx, mu, mod_mask);
+
+    free(auxx);
 
-        /*Duplicate vector to remove need of module operation*/
-        /*This code only works for n_bar = 1*/
-        memcpy(U_aux + len, U_aux, len * sizeof (uint16_t));
+    ROUND2_PROBE(compute_X_prime_return, params, -1);
 
+    return 0;
+}
+
+int compute_X_sessions(uint16_t *X, const uint16_t *M, const uint16_t *idx, const size_t nr_sessions, const parameters *params, const uint16_t mod_bits) {
+    const uint16_t mod_mask = (uint16_t) ((1U << mod_bits) - 1);
+    const uint16_t mu = (uint16_t) (params->ss_size * 8 / params->B);
+    uint16_t *auxx = checked_malloc(nr_sessions * (size_t) (mu + 1) * sizeof (*auxx));
+    size_t s;
+
+    ROUND2_PROBE(compute_X_sessions_entry, params, 3);
+
+    /* The products of the sessions, one by one */
+    for (s = 0; s < nr_sessions; ++s) {
+        mult_ring_tail(auxx + s * (size_t) (mu + 1), M + s * params->n, idx + s * params->h, params, mu, mod_mask);
     }
 
-    /*Auxiliary variable to store the results.*/
-    auxx = checked_malloc((loop) * sizeof (*auxx));
-    memset(auxx, 0, (loop) * sizeof (*X));
-
-    /*Main code to compute X and X'*/
-    l = 0;
-    i = vectors_U;
-    j = (uint32_t) (vectors_S - 1);
-    for (idx = 0; idx < loop; ++idx) {
-        if (l == params->n) {
-            l = 0;
-            --i;
-            if (i == 0) {
-                i = vectors_U;
-                --j;
-            }
+    /* Convert to cyclotomic polynomials, one session per lane */
+    pst_backend_get()->unlift_poly_sessions(X, mu, auxx, (size_t) (mu + 1), nr_sessions, mu, mod_mask);
+
+    free(auxx);
+
+    ROUND2_PROBE(compute_X_sessions_return, params, 3);
+
+    return 0;
+}
+
+int compute_X_sessions_shared(uint16_t *X, const uint16_t *M, const uint16_t *idx, const size_t nr_sessions, const parameters *params, const uint16_t mod_bits) {
+    const pst_backend *backend = pst_backend_get();
+    const uint16_t mod_mask = (uint16_t) ((1U << mod_bits) - 1);
+    const uint16_t mu = (uint16_t) (params->ss_size * 8 / params->B);
+    const size_t len = (size_t) params->d + 1;
+    const size_t nr_cols = (size_t) (mu + 1);
+    uint16_t *auxx = checked_malloc(nr_sessions * nr_cols * sizeof (*auxx));
+    uint16_t *M_lanes = checked_malloc((len + nr_cols) * SESSION_LANES * sizeof (*M_lanes));
+    uint16_t *auxx_lanes = checked_malloc(nr_cols * SESSION_LANES * sizeof (*auxx_lanes));
+    uint32_t *row_displacements = checked_malloc(len * sizeof (*row_displacements));
+    size_t first, offset, s, i;
+
+    ROUND2_PROBE(compute_X_sessions_shared_entry, params, 3);
+
+    for (first = 0; first < nr_sessions; first += SESSION_LANES) {
+        const size_t lanes = nr_sessions - first < SESSION_LANES ? nr_sessions - first : SESSION_LANES;
+        const size_t width = nr_cols * lanes;
+
+        /* Move the polynomials of the sessions to the NTRU ring (as
+         * mult_ring_tail() does), interleaved: coefficient i of the session
+         * in lane s is at M_lanes[i * lanes + s]. Only the start of the
+         * duplicate is read by the windows */
+        backend->lift_poly_sessions(M_lanes, M + first * params->n, params->n, lanes, len - 1, mod_mask);
+        memcpy(M_lanes + len * lanes, M_lanes, (nr_cols - 1) * lanes * sizeof (*M_lanes));
+
+        /* The windows of all lanes are contiguous, so the (single) stream of
+         * indices of the shared vector is added for all sessions at once */
+        for (i = 0; i < len; ++i) {
+            row_displacements[i] = (uint32_t) (i * lanes);
+        }
+        for (offset = 0; offset < width; offset += ACCUMULATION_WINDOW) {
+            backend->accumulate_windows(auxx_lanes + offset, M_lanes + lanes, row_displacements, idx, params->h, offset, width - offset < ACCUMULATION_WINDOW ? width - offset : ACCUMULATION_WINDOW);
         }
-        auxx[idx] = compute_X_idx(U_aux, S_idx, j, i - 1, l, (uint32_t) vectors_U, row_displacements, params, mod_bits);
-        l++;
-    }
 
-    /* In case of the ring, convert to cyclotomic polynomial*/
-    if (params->d == params->n) {
-        unlift_poly(X, auxx, mu, mod_mask);
-    } else {
-        for (i = 0; i < mu; ++i) {
-            X[i] = auxx[mu - 1U - i];
+        /* De-interleave, in the reverse order of mult_ring_tail() */
+        for (s = 0; s < lanes; ++s) {
+            for (i = 0; i < nr_cols; ++i) {
+                auxx[(first + s) * nr_cols + i] = auxx_lanes[(nr_cols - 1 - i) * lanes + s] & mod_mask;
+            }
         }
     }
 
-    free(row_displacements);
-    free(U_aux);
+    /* Convert to cyclotomic polynomials, one session per lane */
+    backend->unlift_poly_sessions(X, mu, auxx, nr_cols, nr_sessions, mu, mod_mask);
+
     free(auxx);
+    free(M_lanes);
+    free(auxx_lanes);
+    free(row_displacements);
+
+    ROUND2_PROBE(compute_X_sessions_shared_return, params, 3);
 
     return 0;
 }
 
 int compress_matrix(uint16_t *matrix, const size_t len, const size_t els, const uint16_t a, const uint16_t b) {
-    size_t i;
-
-    for (i = 0; i < len * els; ++i) {
-        compress(matrix + i, a, b);
-    }
+    pst_backend_get()->compress(matrix, len * els, a, b);
 
     return 0;
 }
 
 int decompress_matrix(uint16_t *matrix, const size_t len, const size_t els, const uint16_t a, const uint16_t b) {
-    size_t i;
-
-    for (i = 0; i < len * els; ++i) {
-        decompress(matrix + i, a, b);
-    }
+    pst_backend_get()->decompress(matrix, len * els, a, b);
 
     return 0;
 }
@@ -44,10 +44,44 @@
 
 #include "parameters.h"
 
+/**
+ * Indicates that the core functions work with the secret vectors in index
+ * form and with __A__ through the row displacements into A_master, as opposed
+ * to the dense matrices of the reference implementation.
+ */
+#define PST_CORE_INDEX_FORM
+
+/**
+ * Indicates that the core functions can spread a single operation over a
+ * thread pool of the caller (see `pst_parallel.h`).
+ */
+#define PST_CORE_PARALLEL
+
+#ifndef ROUND2_KEPT_A_BUDGET
+/**
+ * The default maximum amount of memory (in bytes) that a thread may use to
+ * keep __A__ (A_master and its row displacements) for the next encryptions
+ * (see `keep_A()`). At run time the budget can be changed with the
+ * environment variable `ROUND2_KEPT_A_BUDGET` or with `set_kept_A_budget()`.
+ * A budget of 0 disables keeping A.
+ */
+#define ROUND2_KEPT_A_BUDGET 2097152
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+    /**
+     * Sorts an array of 32-bit values in constant time (as used for the
+     * creation of the sparse ternary vectors).
+     *
+     * @param[in,out] arr the array to sort
+     * @param[in]     len the length of the array
+     * @return __0__ in case of success
+     */
+    int radix_sort(uint32_t *arr, size_t len);
+
     /**
      * Creates __A__ from the given parameters and seed.
      *
@@ -113,7 +147,9 @@ extern "C" {
     int decompress_matrix(uint16_t *matrix, const size_t len, const size_t els, const uint16_t a, const uint16_t b);
 
     /**
-     * Computes __B__ as __A__*__S__ using the index form of S
+     * Computes __B__ as __A__*__S__ using the index form of S, with the engine
+     * (sparse or dense) chosen by the autotuner, or the one set with
+     * `ROUND2_ENGINE` (see `pst_autotune.h`).
      *
      * @param[out] B                  _B_
      * @param[in]  A                  A_master
@@ -125,7 +161,11 @@ extern "C" {
     int compute_B(uint16_t *B, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *S_idx, const parameters *params);
 
     /**
-     * Computes __U__ as __A_T__*__R__ using the index form of S
+     * Computes __U__ as __A_T__*__R__ using the index form of R. A window of
+     * consecutive coefficients of a column of U is computed as the (signed)
+     * sum of _h_ equally long contiguous runs of A_master. The runs are summed per vector (the sparse
+     * engine) or, with `ROUND2_ENGINE=merged`, for all vectors in one
+     * ascending sweep over the rows (the merged engine, see `pst_autotune.h`).
      *
      * @param[out] U                  _U_
      * @param[in]  A                  A_master
@@ -135,6 +175,98 @@ extern "C" {
      * @return __0__ in case of success
      */
     int compute_U(uint16_t *U, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *R_idx, const parameters *params);
+
+    /**
+     * Sets the maximum amount of memory (in bytes) that a thread may use to
+     * keep __A__, overriding `ROUND2_KEPT_A_BUDGET`.
+     *
+     * @param[in]  budget             the budget, 0 to disable keeping A
+     */
+    void set_kept_A_budget(const size_t budget);
+
+    /**
+     * Gets the maximum amount of memory (in bytes) that a thread may use to
+     * keep __A__: the one set with `set_kept_A_budget()`, or else the one of
+     * the environment variable `ROUND2_KEPT_A_BUDGET`, or else the default
+     * `ROUND2_KEPT_A_BUDGET`.
+     *
+     * @return the budget
+     */
+    size_t get_kept_A_budget(void);
+
+    /**
+     * Determines whether __A__ can be kept, i.e. whether A_master and its
+     * row displacements fit within the budget (see `get_kept_A_budget()`).
+     *
+     * @param[in]  fn                 the variant used for the creation of A
+     * @param[in]  params             the algorithm parameters in use
+     * @return __1__ if A can be kept, __0__ otherwise
+     */
+    int use_kept_A(const uint8_t fn, const parameters *params);
+
+    /**
+     * Keeps __A__ (as created by `create_A()`) in the calling thread, for the
+     * next encryptions with the same A (i.e. to the same public key), see
+     * `get_kept_A()`. A thread keeps (at most) one A, the last one passed,
+     * within the budget (see `use_kept_A()`), and releases it when it exits.
+     * With fn=1 the kept A belongs to the current A_fixed.
+     *
+     * @param[in]  A                  A_master, allocated with `malloc()`, owned by the thread if kept
+     * @param[in]  A_permutation      the row displacements, allocated with `malloc()`, owned by the thread if kept
+     * @param[in]  fn                 the variant used for the creation of A
+     * @param[in]  sigma              the seed of A
+     * @param[in]  params             the algorithm parameters in use
+     * @return __1__ if A has been kept, __0__ if it is over the budget (and still owned by the caller)
+     */
+    int keep_A(uint16_t *A, uint32_t *A_permutation, const uint8_t fn, const unsigned char *sigma, const parameters *params);
+
+    /**
+     * Gets the __A__ kept by the calling thread (see `keep_A()`). It remains
+     * valid until the thread keeps another A.
+     *
+     * @param[out] A_permutation      the row displacements of the kept A
+     * @param[in]  fn                 the variant used for the creation of A
+     * @param[in]  sigma              the seed of A
+     * @param[in]  params             the algorithm parameters in use
+     * @return A_master, `NULL` if the thread does not keep this A
+     */
+    const uint16_t *get_kept_A(const uint32_t **A_permutation, const uint8_t fn, const unsigned char *sigma, const parameters *params);
+
+    /**
+     * Computes __B__ as __A__*__S__ for A created with fn=2, i.e. when every row
+     * of A is a window of the (q+d)-element A_master. With the sparse engine
+     * the rows are processed in the order of their displacement so that
+     * consecutive rows overlap and A_master stays in cache (also with the
+     * merged engine), the dense engine reads the rows contiguously (see
+     * `pst_autotune.h`).
+     *
+     * @param[out] B                  _B_
+     * @param[in]  A_master           A_master (of length _q + d_)
+     * @param[in]  row_displacements  the start of each row within A_master
+     * @param[in]  S_idx              _S_ in index form
+     * @param[in]  params             the algorithm parameters in use
+     * @return __0__ in case of success
+     */
+    int compute_B_fn2(uint16_t *B, const uint16_t *A_master, const uint32_t *row_displacements, const uint16_t *S_idx, const parameters *params);
+
+    /**
+     * Computes __B__ as __A__*__S__, as compute_B() does, for several
+     * independent sessions of a ring parameter set (with _n_bar = 1_). Only
+     * the unlifting is interleaved: the products are computed session by
+     * session, as by compute_B(), after which the products are unlifted
+     * side by side, one session per lane (see
+     * `pst_backend.unlift_poly_sessions`).
+     *
+     * @param[out] B                  _B_ of the sessions, _d_ coefficients each
+     * @param[in]  A                  A_master of the sessions, _2 * (d + 1)_ coefficients each
+     * @param[in]  row_displacements  permutation used to get A (the same for all sessions)
+     * @param[in]  S_idx              _S_ of the sessions in index form, _h_ indices each
+     * @param[in]  nr_sessions        the number of sessions
+     * @param[in]  params             the algorithm parameters in use
+     * @return __0__ in case of success
+     */
+    int compute_B_sessions(uint16_t *B, const uint16_t *A, const uint32_t *row_displacements, const uint16_t *S_idx, const size_t nr_sessions, const parameters *params);
+
     /**
      * Transforms a sparse ternary matrix into index form
      *
@@ -174,6 +306,42 @@ extern "C" {
      */
     int compute_X_prime(uint16_t *X,  const uint16_t *U, const uint16_t *S_idx, const parameters *params, const uint16_t mod_bits, const uint16_t vectors_B, const uint16_t vectors_R);
 
+    /**
+     * Computes mu values of X (or X'), as compute_X() (compute_X_prime())
+     * does, for several independent sessions of a ring parameter set (with
+     * _n_bar = m_bar = 1_). Only the unlifting is interleaved: the products
+     * are computed session by session, after which they are unlifted side by
+     * side, one session per lane.
+     *
+     * @param[out] X                  _X_ of the sessions, mu values each
+     * @param[in]  M                  _B_ (or _U_) of the sessions, _d_ coefficients each
+     * @param[in]  idx                _R_ (or _S_) of the sessions in index form, _h_ indices each
+     * @param[in]  nr_sessions        the number of sessions
+     * @param[in]  params             the algorithm parameters in use
+     * @param[in]  mod_bits           number of bits of the coefficients
+     * @return __0__ in case of success
+     */
+    int compute_X_sessions(uint16_t *X, const uint16_t *M, const uint16_t *idx, const size_t nr_sessions, const parameters *params, const uint16_t mod_bits);
+
+    /**
+     * Computes mu values of X', as compute_X_sessions() does, for several
+     * independent sessions of a ring parameter set that share the secret
+     * vector, e.g. the decryptions with the key of a server. The polynomials
+     * of up to 16 sessions are interleaved, one session per lane, so that the
+     * windows of all lanes are contiguous and the products are computed side
+     * by side with a single stream of indices. The results are unlifted side
+     * by side too.
+     *
+     * @param[out] X                  _X_ of the sessions, mu values each
+     * @param[in]  M                  _U_ of the sessions, _d_ coefficients each
+     * @param[in]  idx                _S_ in index form (_h_ indices), shared by the sessions
+     * @param[in]  nr_sessions        the number of sessions
+     * @param[in]  params             the algorithm parameters in use
+     * @param[in]  mod_bits           number of bits of the coefficients
+     * @return __0__ in case of success
+     */
+    int compute_X_sessions_shared(uint16_t *X, const uint16_t *M, const uint16_t *idx, const size_t nr_sessions, const parameters *params, const uint16_t mod_bits);
+
 #ifdef __cplusplus
 }
 #endif
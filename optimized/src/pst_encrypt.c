@@ -44,63 +44,18 @@
 
 #include "misc.h"
 #include "pst_core.h"
+#include "pst_backend.h"
 #include "pack.h"
 #include "randombytes.h"
 #include "drng.h"
 #include "hash.h"
+#include "round2_stats.h"
+#include "round2_probes.h"
 
 /*******************************************************************************
  * Private functions
  ******************************************************************************/
 
-/**
- * Add the value of the message to a matrix as described in the algorithm
- *
- * @param[out] result         result of the addition
- * @param[in]  len            length of the result
- * @param[in]  matrix         matrix to which add the message
- * @param[in]  m              message to add
- * @param[in]  bits_coeff     number of bits added in each coefficient
- * @param[in]  scaling_factor scaling factor applied
- * @return __0__ in case of success
- */
-static int add_msg(uint16_t *result, const size_t len, const uint16_t *matrix, const unsigned char *m, const uint16_t bits_coeff, const uint8_t scaling_factor) {
-    int i;
-    uint16_t mask_bits = (uint16_t) ((1 << bits_coeff) - 1);
-    int shift = scaling_factor - bits_coeff;
-
-    for (i = 0; i < (int) len; ++i) {
-        int idx_bit = bits_coeff * i;
-        int shift_bits = idx_bit % 8;
-        int idx_bytes = idx_bit / 8;
-        uint16_t m_chunk = (uint16_t) ((m[idx_bytes] >> shift_bits) &
-                mask_bits);
-
-        result[i] = (uint16_t) (matrix[i] + (m_chunk << shift));
-    }
-
-    return 0;
-}
-
-/**
- * Compute the difference of the first len values matrix_a - matrix_b
- *
- * @param[out] result         difference
- * @param[in]  len            length of the result
- * @param[in]  matrix_a       first operand
- * @param[in]  matrix_b       second operand
- * @return __0__ in case of success
- */
-static int diff_msg(uint16_t *result, const size_t len, const uint16_t *matrix_a, const uint16_t *matrix_b) {
-    size_t i;
-
-    for (i = 0; i < len; ++i) {
-        result[i] = (uint16_t) (matrix_a[i] - matrix_b[i]);
-    }
-
-    return 0;
-}
-
 /**
  * Convert a message from Z^len_(2^bits_per_elemen) to a bitstring
  *
@@ -128,6 +83,33 @@ static int msg_to_bitstring(unsigned char *m, const uint16_t *msg_int, const siz
     return ++idx_bytes;
 }
 
+/**
+ * Recovers the message from v and the mu sampled values of X' (S^T * U), i.e.
+ * computes the bitstring of compress(v - X').
+ *
+ * @param[out] m        message in bitstring format
+ * @param[in]  v        v (decompressed to p_bits)
+ * @param[in]  X        the mu sampled values of X'
+ * @param[in]  params   the algorithm parameters in use
+ * @return __0__ in case of success
+ */
+static int recover_msg(unsigned char *m, const uint16_t *v, const uint16_t *X, const parameters *params) {
+    const size_t mu = (size_t) (params->ss_size * 8 / params->B);
+    uint16_t *msg_tmp = checked_malloc(mu * sizeof (*msg_tmp));
+
+    /* v - Sample_mu(S^T * U) */
+    pst_backend_get()->diff_msg(msg_tmp, mu, v, X);
+    /* Compress msg_tmp p_bits -> B */
+    compress_matrix(msg_tmp, mu, 1, params->p_bits, params->B);
+
+    /* Convert the message to bitstring format */
+    msg_to_bitstring(m, msg_tmp, mu, params->B);
+
+    free(msg_tmp);
+
+    return 0;
+}
+
 /**
  * Compute the size of A from the value of fn.
  *
@@ -158,6 +140,227 @@ static size_t compute_len_a(uint8_t fn, const parameters *params) {
     return len_a;
 }
 
+/**
+ * Computes the first part of the encryption that only depends on the seeds:
+ * R from rho and the compressed U = A^T * R, with A created from sigma.
+ *
+ * @param[out] U      the compressed U
+ * @param[out] R_idx  R in index form
+ * @param[in]  fn     the variant used for the generation of A (from the public key)
+ * @param[in]  sigma  seed of A
+ * @param[in]  rho    seed of R
+ * @param[in]  params the algorithm parameters in use
+ */
+static void compute_U_from_seeds(uint16_t *U, uint16_t *R_idx, uint8_t fn, const unsigned char *sigma, const unsigned char *rho, const parameters *params) {
+    const uint16_t *A;
+    const uint32_t *A_permutation;
+    uint16_t *A_created = NULL;
+    uint32_t *A_permutation_created = NULL;
+
+    fn = (params->d == params->n) ? 3 : fn;
+
+    /* An A kept by the thread (from an earlier encryption to the same public key) need not be created again */
+    A = get_kept_A(&A_permutation, fn, sigma, params);
+    if (A == NULL) {
+        A_created = checked_malloc(compute_len_a(fn, params) * sizeof (*A_created));
+        A_permutation_created = checked_malloc((size_t) (params->d + 1) * sizeof (*A_permutation_created));
+
+        /* Create A from sigma */
+        ROUND2_STATS_START(create_A_start);
+        create_A(A_created, A_permutation_created, fn, sigma, params);
+        ROUND2_STATS_STOP(ROUND2_STATS_CREATE_A, create_A_start, 0);
+
+        A = A_created;
+        A_permutation = A_permutation_created;
+        if (keep_A(A_created, A_permutation_created, fn, sigma, params)) {
+            /* Now owned by the thread */
+            A_created = NULL;
+            A_permutation_created = NULL;
+        }
+    }
+    /* Create R_idx from rho */
+    ROUND2_STATS_START(create_R_start);
+    create_R(R_idx, rho, params);
+    ROUND2_STATS_STOP(ROUND2_STATS_CREATE_R, create_R_start, 0);
+
+    /* U = A^T * R */
+    ROUND2_STATS_START(compute_U_start);
+    if (params->d == params->n) {
+        compute_B(U, A, A_permutation, R_idx, params);
+    } else {
+        compute_U(U, A, A_permutation, R_idx, params);
+    }
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_U, compute_U_start, 0);
+
+    /* Compress U q_bits -> p_bits */
+    compress_matrix(U, (size_t) (params->k * params->m_bar), params->n, params->q_bits, params->p_bits);
+
+#ifdef DEBUG
+    printf("encrypt_rho: fn=%hhu\n", fn);
+    print_sage_u_vector_matrix("encrypt_rho: A", A, params->k, params->k, params->n);
+    print_sage_u_vector_matrix("encrypt_rho: U", U, params->k, params->m_bar, params->n);
+#endif
+
+    free(A_created);
+    free(A_permutation_created);
+}
+
+/**
+ * Computes v, the second part of the ciphertext and the part that needs B:
+ * the message is added to X = B^T * R.
+ *
+ * @param[out] v      v (mu elements)
+ * @param[in]  m      plaintext
+ * @param[in]  R_idx  R in index form
+ * @param[in]  B      B from the public key
+ * @param[in]  params the algorithm parameters in use
+ */
+static void compute_v(uint16_t *v, const unsigned char *m, const uint16_t *R_idx, const uint16_t *B, const parameters *params) {
+    /* B is divisor of 8! */
+    const size_t mu = (size_t) (params->ss_size * 8 / params->B);
+    uint16_t *X = checked_malloc((size_t) (params->n_bar * params->m_bar * params->n) * sizeof (*X));
+
+    ROUND2_STATS_START(compute_X_start);
+    compute_X(X, B, R_idx, params, params->p_bits, params->n_bar, params->m_bar);
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_X, compute_X_start, 0);
+
+    /* v is a matrix of scalars, so we use 1 as the number of coefficients */
+    compress_matrix(X, mu, 1, params->p_bits, params->t_bits);
+
+    /* Add message */
+    pst_backend_get()->add_msg(v, mu, X, m, params->B, params->t_bits);
+
+#if defined(ROUND2_INTERMEDIATE) || defined(DEBUG)
+#ifdef DEBUG
+    print_sage_u_vector_matrix("encrypt_rho: B", B, params->k, params->n_bar, params->n);
+    print_sage_u_vector_matrix("encrypt_rho: X", X, params->n_bar, params->m_bar, params->n);
+#endif
+    print_sage_u_vector("encrypt_rho: v", v, mu);
+#endif
+
+    free(X);
+}
+
+/**
+ * Computes the second part of the encryption, v, and packs it together with
+ * U into the ciphertext.
+ *
+ * @param[out] c      ciphertext
+ * @param[in]  m      plaintext
+ * @param[in]  U      the compressed U
+ * @param[in]  R_idx  R in index form
+ * @param[in]  B      B from the public key
+ * @param[in]  params the algorithm parameters in use
+ */
+static void finish_ciphertext(unsigned char *c, const unsigned char *m, const uint16_t *U, const uint16_t *R_idx, const uint16_t *B, const parameters *params) {
+    const size_t mu = (size_t) (params->ss_size * 8 / params->B);
+    uint16_t *v = checked_malloc(mu * sizeof (*v));
+
+    compute_v(v, m, R_idx, B, params);
+
+    /* Pack ciphertext */
+    pack_ct(c, U, (size_t) (params->m_bar * params->d), params->p_bits, v, mu, params->t_bits);
+
+    free(v);
+}
+
+/**
+ * The state of the verification of a re-encrypted ciphertext c' against the
+ * received one, while c' is being packed: the constant time comparison of
+ * the two, and the hashes of c' with either prefix.
+ */
+typedef struct {
+    const unsigned char *c; /**< The received ciphertext */
+    size_t pos; /**< The number of bytes compared so far */
+    unsigned char diff; /**< The bitwise OR of the differences so far */
+    hash_ctx *h_equal; /**< The hash of c' with the prefix for equal ciphertexts */
+    hash_ctx *h_differ; /**< The hash of c' with the prefix for differing ciphertexts */
+} verify_state;
+
+/**
+ * Compares the next packed bytes of the re-encrypted ciphertext with the
+ * received ciphertext, without branching on their contents, and absorbs them
+ * into both hashes.
+ *
+ * @param[in]  arg    the verification state
+ * @param[in]  packed the next packed bytes
+ * @param[in]  len    the number of bytes
+ */
+static void verify_packed(void *arg, const unsigned char *packed, size_t len) {
+    verify_state *state = arg;
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        state->diff = (unsigned char) (state->diff | (state->c[state->pos + i] ^ packed[i]));
+    }
+    state->pos += len;
+    hash_update(state->h_equal, packed, len);
+    hash_update(state->h_differ, packed, len);
+}
+
+/**
+ * The state of an incremental encryption. As soon as fn and sigma have been
+ * received, A is created and U computed; B is only needed at the end, for X.
+ */
+struct encrypt_ctx {
+    parameters params; /**< The algorithm parameters in use */
+    unsigned char *rho; /**< Seed of R */
+    unsigned char *pk; /**< The public key received so far */
+    size_t pk_len; /**< The number of bytes of the public key received so far */
+    uint16_t *R_idx; /**< R in index form (once U has been computed) */
+    uint16_t *U; /**< The compressed U (`NULL` until it has been computed) */
+};
+
+/**
+ * The state of an incremental decryption. In the non-ring case, X' = S^T * U
+ * is accumulated while the ciphertext comes in: every time rows of U have
+ * been received completely, each of them is multiplied with the matching
+ * column of the (ternary) S_T and added to X'. Each row of U is therefore
+ * processed exactly once, however the ciphertext is split, and the work per
+ * row does not depend on S.
+ */
+struct decrypt_ctx {
+    parameters params; /**< The algorithm parameters in use */
+    int16_t *S_T; /**< S_T */
+    uint16_t *S_idx; /**< S_T in index form */
+    unsigned char *c; /**< The ciphertext received so far */
+    size_t c_len; /**< The number of bytes of the ciphertext received so far */
+    size_t rows_done; /**< The number of rows of U processed (non-ring only) */
+    uint16_t *col_first; /**< Per vector of S: the first column of U needed for X' (non-ring only) */
+    uint16_t *nr_cols; /**< Per vector of S: the number of columns of U needed for X' (non-ring only) */
+    uint16_t *x_offset; /**< Per vector of S: the position in X' of the first of these columns (non-ring only) */
+    uint16_t *X; /**< The mu sampled values of X' accumulated so far (non-ring only) */
+    uint16_t *row; /**< Buffer for a row of U (non-ring only) */
+};
+
+/**
+ * Adds the product of the newly completed rows of U (unpacked from the
+ * received part of the ciphertext) and the vectors of S to X'. A row _r_ is
+ * multiplied with the entries _S_T[j][r]_ (-1, 0 or 1) of all vectors, so
+ * that neither the control flow nor the memory accesses depend on S.
+ *
+ * @param[in] ctx   the state of the decryption
+ * @param[in] rows  the number of rows of U that have been received completely
+ */
+static void accumulate_X_prime(decrypt_ctx *ctx, const size_t rows) {
+    const parameters *params = &ctx->params;
+    size_t r;
+    uint16_t j, l;
+
+    for (r = ctx->rows_done; r < rows; ++r) {
+        unpack_part(ctx->row, ctx->c, r * params->m_bar, params->m_bar, params->p_bits);
+        for (j = 0; j < params->n_bar; ++j) {
+            const uint16_t s = (uint16_t) ctx->S_T[(size_t) j * params->d + r];
+            const uint16_t *src = ctx->row + ctx->col_first[j];
+            uint16_t *dst = ctx->X + ctx->x_offset[j];
+            for (l = 0; l < ctx->nr_cols[j]; ++l) {
+                dst[l] = (uint16_t) (dst[l] + s * src[l]);
+            }
+        }
+    }
+    ctx->rows_done = rows;
+}
+
 /*******************************************************************************
  * Public functions
  ******************************************************************************/
@@ -174,6 +377,8 @@ int generate_keypair(unsigned char *pk, unsigned char *sk, const parameters *par
     size_t len_s;
     size_t len_b;
 
+    ROUND2_PROBE(generate_keypair_entry, params, fn);
+
     fn = (params->d == params->n) ? 3 : fn;
     /* Calculate sizes */
     /* Size of A depends on fn */
@@ -194,12 +399,22 @@ int generate_keypair(unsigned char *pk, unsigned char *sk, const parameters *par
     randombytes(sigma, params->ss_size);
 
     /* Create A from sigma */
+    ROUND2_STATS_START(create_A_start);
     create_A(A, A_permutation, fn, sigma, params);
+    ROUND2_STATS_STOP(ROUND2_STATS_CREATE_A, create_A_start, 0);
 
     /* Randomly generate S_T */
+    ROUND2_STATS_START(create_S_start);
     create_S(S_T, S_idx, params);
+    ROUND2_STATS_STOP(ROUND2_STATS_CREATE_S, create_S_start, 0);
 
-    compute_B(B, A, A_permutation, S_idx, params);
+    ROUND2_STATS_START(compute_B_start);
+    if (fn == 2) {
+        compute_B_fn2(B, A, A_permutation, S_idx, params);
+    } else {
+        compute_B(B, A, A_permutation, S_idx, params);
+    }
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_B, compute_B_start, 0);
 
     /* Compress B q_bits -> p_bits */
     compress_matrix(B, (size_t) (params->k * params->n_bar), params->n, params->q_bits, params->p_bits);
@@ -225,6 +440,8 @@ int generate_keypair(unsigned char *pk, unsigned char *sk, const parameters *par
     free(S_T);
     free(B);
 
+    ROUND2_PROBE(generate_keypair_return, params, fn);
+
     return 0;
 }
 
@@ -240,103 +457,116 @@ int encrypt(unsigned char *c, const unsigned char *m, const unsigned char *pk, c
 }
 
 int encrypt_rho(unsigned char *c, const unsigned char *m, const unsigned char *rho, const unsigned char *pk, const parameters *params) {
-    /* Seeds */
     unsigned char *sigma;
-
-    /* Matrices */
-    uint16_t *A;
-    uint32_t *A_permutation;
     uint16_t *R_idx;
     uint16_t *U;
     uint16_t *B;
-    uint16_t *X;
-    uint16_t *v;
-
-    /* Length of matrices */
-    size_t len_a;
-    size_t len_r_idx;
-    size_t len_u;
-    size_t len_b;
-    size_t len_x;
-    size_t len_v;
-    size_t mu;
-
-    /* fn */
     uint8_t fn;
 
-    /* B is divisor of 8! */
-    mu = (size_t) (params->ss_size * 8 / params->B);
-
-    len_r_idx = (size_t) (params->h * params->m_bar);
-    len_u = (size_t) (params->m_bar * params->d);
-    len_b = (size_t) (params->d * params->n_bar);
-    len_x = (size_t) (params->n_bar * params->m_bar * params->n);
-    len_v = mu;
+    ROUND2_PROBE(encrypt_rho_entry, params, pk[0]);
 
     sigma = checked_malloc(params->ss_size);
-    B = checked_malloc(len_b * sizeof (*B));
-    R_idx = checked_malloc(len_r_idx * sizeof (*R_idx));
-    U = checked_malloc(len_u * sizeof (*U));
-    X = checked_malloc(len_x * sizeof (*X));
-    v = checked_malloc(len_v * sizeof (*v));
+    B = checked_malloc((size_t) (params->d * params->n_bar) * sizeof (*B));
+    R_idx = checked_malloc((size_t) (params->h * params->m_bar) * sizeof (*R_idx));
+    U = checked_malloc((size_t) (params->m_bar * params->d) * sizeof (*U));
 
     /* Unpack received public key into fn, sigma and B */
-    unpack_pk(&fn, sigma, B, pk, params->ss_size, len_b, params->p_bits);
-    fn = (params->d == params->n) ? 3 : fn;
+    unpack_pk(&fn, sigma, B, pk, params->ss_size, (size_t) (params->d * params->n_bar), params->p_bits);
 
-    len_a = compute_len_a(fn, params);
-    A = checked_malloc(len_a * sizeof (*A));
-    A_permutation = checked_malloc((size_t) (params->d + 1) * sizeof (*A_permutation));
+#if defined(ROUND2_INTERMEDIATE) || defined(DEBUG)
+    print_hex("encrypt_rho: rho", rho, params->ss_size, 1);
+#ifdef DEBUG
+    print_hex("encrypt_rho: sigma", sigma, params->ss_size, 1);
+#endif
+#endif
 
-    /* Create A from sigma */
-    create_A(A, A_permutation, fn, sigma, params);
-    /* Create R_idx from rho */
-    create_R(R_idx, rho, params);
+    compute_U_from_seeds(U, R_idx, fn, sigma, rho, params);
+    finish_ciphertext(c, m, U, R_idx, B, params);
 
-    /* U = A^T * R */
-    if (params->d == params->n) {
-        compute_B(U, A, A_permutation, R_idx, params);
-    } else {
-        compute_U(U, A, A_permutation, R_idx, params);
-    }
+    free(sigma);
+    free(R_idx);
+    free(U);
+    free(B);
 
-    /* Compress U q_bits -> p_bits */
-    compress_matrix(U, (size_t) (params->k * params->m_bar), params->n, params->q_bits, params->p_bits);
+    ROUND2_PROBE(encrypt_rho_return, params, pk[0]);
 
-    compute_X(X, B, R_idx, params, params->p_bits, params->n_bar, params->m_bar);
+    return 0;
+}
 
-    /* v is a matrix of scalars, so we use 1 as the number of coefficients */
-    compress_matrix(X, mu, 1, params->p_bits, params->t_bits);
+int encrypt_rho_multi(unsigned char *c, const size_t c_size, const unsigned char *m, const unsigned char *rho, const unsigned char *pk, const size_t nr_sessions, const parameters *params) {
+    const size_t mu = (size_t) (params->ss_size * 8 / params->B);
+    const size_t len_a = compute_len_a(3, params);
+    unsigned char *sigma;
+    uint32_t *A_permutation;
+    uint16_t *A;
+    uint16_t *B;
+    uint16_t *R_idx;
+    uint16_t *U;
+    uint16_t *X;
+    uint16_t *v;
+    uint8_t fn;
+    size_t s;
+
+    if (params->d != params->n) {
+        /* The sessions of the non-ring parameter sets are encrypted one by one */
+        for (s = 0; s < nr_sessions; ++s) {
+            encrypt_rho(c + s * c_size, m + s * params->ss_size, rho + s * params->ss_size, pk + s * params->pk_size, params);
+        }
+        return 0;
+    }
 
-    /* Add message */
-    add_msg(v, len_v, X, m, params->B, params->t_bits);
+    ROUND2_PROBE(encrypt_rho_multi_entry, params, 3);
 
-#if defined(ROUND2_INTERMEDIATE) || defined(DEBUG)
-    print_hex("encrypt_rho: rho", rho, params->ss_size, 1);
-#ifdef DEBUG
-    print_hex("encrypt_rho: sigma", sigma, params->ss_size, 1);
-    print_hex("encrypt_rho: eu_seed", eu_seed, params->ss_size, 1);
-    print_hex("encrypt_rho: ex_seed", ex_seed, params->ss_size, 1);
-    print_sage_u_vector_matrix("encrypt_rho: A", A, params->k, params->k, params->n);
-    print_sage_u_vector_matrix("encrypt_rho: B", B, params->k, params->n_bar, params->n);
-    print_sage_u_vector_matrix("encrypt_rho: U", U, params->k, params->m_bar, params->n);
-    print_sage_u_vector_matrix("encrypt_rho: X", X, params->n_bar, params->m_bar, params->n);
-#endif
-    print_sage_u_vector("encrypt_rho: v", v, mu);
-#endif
+    sigma = checked_malloc(params->ss_size);
+    A_permutation = checked_malloc((size_t) (params->d + 1) * sizeof (*A_permutation));
+    A = checked_malloc(nr_sessions * len_a * sizeof (*A));
+    B = checked_malloc(nr_sessions * params->d * sizeof (*B));
+    R_idx = checked_malloc(nr_sessions * params->h * sizeof (*R_idx));
+    U = checked_malloc(nr_sessions * params->d * sizeof (*U));
+    X = checked_malloc(nr_sessions * mu * sizeof (*X));
+    v = checked_malloc(mu * sizeof (*v));
+
+    /* Unpack the public keys into fn (ignored for the ring), sigma and B,
+     * create A from sigma and R_idx from rho */
+    for (s = 0; s < nr_sessions; ++s) {
+        unpack_pk(&fn, sigma, B + s * params->d, pk + s * params->pk_size, params->ss_size, params->d, params->p_bits);
+        ROUND2_STATS_START(create_A_start);
+        create_A(A + s * len_a, A_permutation, 3, sigma, params);
+        ROUND2_STATS_STOP(ROUND2_STATS_CREATE_A, create_A_start, 0);
+        ROUND2_STATS_START(create_R_start);
+        create_R(R_idx + s * params->h, rho + s * params->ss_size, params);
+        ROUND2_STATS_STOP(ROUND2_STATS_CREATE_R, create_R_start, 0);
+    }
 
-    /* Pack ciphertext */
-    pack_ct(c, U, len_u, params->p_bits, v, mu, params->t_bits);
+    /* U = A^T * R, compressed q_bits -> p_bits */
+    ROUND2_STATS_START(compute_U_start);
+    compute_B_sessions(U, A, A_permutation, R_idx, nr_sessions, params);
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_U, compute_U_start, 0);
+    compress_matrix(U, nr_sessions, params->d, params->q_bits, params->p_bits);
+
+    /* X = B^T * R, compressed p_bits -> t_bits */
+    ROUND2_STATS_START(compute_X_start);
+    compute_X_sessions(X, B, R_idx, nr_sessions, params, params->p_bits);
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_X, compute_X_start, 0);
+    compress_matrix(X, nr_sessions * mu, 1, params->p_bits, params->t_bits);
+
+    /* Add the messages and pack the ciphertexts */
+    for (s = 0; s < nr_sessions; ++s) {
+        pst_backend_get()->add_msg(v, mu, X + s * mu, m + s * params->ss_size, params->B, params->t_bits);
+        pack_ct(c + s * c_size, U + s * params->d, params->d, params->p_bits, v, mu, params->t_bits);
+    }
 
     free(sigma);
-    free(A);
     free(A_permutation);
+    free(A);
+    free(B);
     free(R_idx);
     free(U);
-    free(B);
     free(X);
     free(v);
 
+    ROUND2_PROBE(encrypt_rho_multi_return, params, 3);
+
     return 0;
 }
 
@@ -347,7 +577,6 @@ int decrypt(unsigned char *m, const unsigned char *c, const unsigned char *sk, c
     uint16_t *U;
     uint16_t *v;
     uint16_t *tmp;
-    uint16_t *msg_tmp;
     /* Length of matrices */
     size_t len_s;
     size_t len_s_idx;
@@ -356,6 +585,8 @@ int decrypt(unsigned char *m, const unsigned char *c, const unsigned char *sk, c
     size_t len_tmp;
     size_t mu;
 
+    ROUND2_PROBE(decrypt_entry, params, -1);
+
     len_s = (size_t) (params->d * params->n_bar);
     len_s_idx = (size_t) (params->h * params->n_bar);
     len_u = (size_t) (params->d * params->m_bar);
@@ -368,7 +599,6 @@ int decrypt(unsigned char *m, const unsigned char *c, const unsigned char *sk, c
     U = checked_malloc(len_u * sizeof (*U));
     v = checked_malloc(len_v * sizeof (*v));
     tmp = checked_malloc(len_tmp * sizeof (*tmp));
-    msg_tmp = checked_malloc(mu * sizeof (*msg_tmp));
 
     unpack_sk(S_T, sk, len_s);
     unpack_ct(U, v, c, len_u, params->p_bits, len_v, params->t_bits);
@@ -377,7 +607,9 @@ int decrypt(unsigned char *m, const unsigned char *c, const unsigned char *sk, c
 
     /* Decompress v t_bits -> p_bits */
     decompress_matrix(v, len_v, 1, params->p_bits, params->t_bits);
+    ROUND2_STATS_START(compute_X_start);
     compute_X_prime(tmp, U, S_idx, params, params->p_bits, params->m_bar, params->n_bar);
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_X, compute_X_start, 0);
 
 #if defined(ROUND2_INTERMEDIATE) || defined(DEBUG)
     print_sage_u_vector("decrypt: v", v, mu);
@@ -388,20 +620,285 @@ int decrypt(unsigned char *m, const unsigned char *c, const unsigned char *sk, c
 #endif
 #endif
 
-    /* v - Sample_mu(S^T * U) */
-    diff_msg(msg_tmp, mu, v, tmp);
-    /* Compress msg_tmp p_bits -> B */
-    compress_matrix(msg_tmp, mu, 1, params->p_bits, params->B);
-
-    /* Convert the message to bitstring format */
-    msg_to_bitstring(m, msg_tmp, mu, params->B);
+    recover_msg(m, v, tmp, params);
 
     free(S_T);
     free(S_idx);
     free(U);
     free(v);
     free(tmp);
-    free(msg_tmp);
+
+    ROUND2_PROBE(decrypt_return, params, -1);
 
     return 0;
 }
+
+int decrypt_multi(unsigned char *m, const unsigned char *c, const size_t c_size, const unsigned char *sk, const size_t sk_size, const size_t nr_sessions, const parameters *params) {
+    const size_t mu = (size_t) (params->ss_size * 8 / params->B);
+    int16_t *S_T;
+    uint16_t *S_idx;
+    uint16_t *U;
+    uint16_t *v;
+    uint16_t *X;
+    size_t s;
+
+    if (params->d != params->n) {
+        /* The sessions of the non-ring parameter sets are decrypted one by one */
+        for (s = 0; s < nr_sessions; ++s) {
+            decrypt(m + s * params->ss_size, c + s * c_size, sk + s * sk_size, params);
+        }
+        return 0;
+    }
+
+    ROUND2_PROBE(decrypt_multi_entry, params, 3);
+
+    S_T = checked_malloc(params->d * sizeof (*S_T));
+    S_idx = checked_malloc(nr_sessions * params->h * sizeof (*S_idx));
+    U = checked_malloc(nr_sessions * params->d * sizeof (*U));
+    v = checked_malloc(nr_sessions * mu * sizeof (*v));
+    X = checked_malloc(nr_sessions * mu * sizeof (*X));
+
+    for (s = 0; s < nr_sessions; ++s) {
+        /* A shared secret key is converted to index form only once */
+        if (sk_size != 0 || s == 0) {
+            unpack_sk(S_T, sk + s * sk_size, params->d);
+            transform_to_index(S_idx + s * params->h, S_T, 1, params);
+        }
+        unpack_ct(U + s * params->d, v + s * mu, c + s * c_size, params->d, params->p_bits, mu, params->t_bits);
+    }
+
+    /* Decompress v t_bits -> p_bits */
+    decompress_matrix(v, nr_sessions * mu, 1, params->p_bits, params->t_bits);
+    ROUND2_STATS_START(compute_X_start);
+    if (sk_size == 0) {
+        compute_X_sessions_shared(X, U, S_idx, nr_sessions, params, params->p_bits);
+    } else {
+        compute_X_sessions(X, U, S_idx, nr_sessions, params, params->p_bits);
+    }
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_X, compute_X_start, 0);
+
+    for (s = 0; s < nr_sessions; ++s) {
+        recover_msg(m + s * params->ss_size, v + s * mu, X + s * mu, params);
+    }
+
+    free(S_T);
+    free(S_idx);
+    free(U);
+    free(v);
+    free(X);
+
+    ROUND2_PROBE(decrypt_multi_return, params, 3);
+
+    return 0;
+}
+
+int encrypt_rho_verify(unsigned char *K, const unsigned char *c, const unsigned char *m, const unsigned char *rho, const unsigned char *suffix, const unsigned char *prefix_equal, const unsigned char *prefix_differ, const unsigned char *pk, const parameters *params) {
+    const size_t len_u = (size_t) (params->m_bar * params->d);
+    const size_t mu = (size_t) (params->ss_size * 8 / params->B);
+    unsigned char *sigma = checked_malloc(params->ss_size);
+    unsigned char *K_differ = checked_malloc(params->ss_size);
+    uint16_t *B = checked_malloc((size_t) (params->d * params->n_bar) * sizeof (*B));
+    uint16_t *R_idx = checked_malloc((size_t) (params->h * params->m_bar) * sizeof (*R_idx));
+    uint16_t *U = checked_malloc(len_u * sizeof (*U));
+    uint16_t *v = checked_malloc(mu * sizeof (*v));
+    verify_state state;
+    unsigned char differ_mask;
+    uint8_t fn;
+    size_t i;
+
+    /* Re-encrypt m, up to the packing */
+    unpack_pk(&fn, sigma, B, pk, params->ss_size, (size_t) (params->d * params->n_bar), params->p_bits);
+    compute_U_from_seeds(U, R_idx, fn, sigma, rho, params);
+    compute_v(v, m, R_idx, B, params);
+
+    /* Pack c' = (U',v',suffix) once, comparing it with c and absorbing it
+     * into H(prefix_equal, c') and H(prefix_differ, c') at the same time */
+    state.c = c;
+    state.pos = 0;
+    state.diff = 0;
+    state.h_equal = hash_init();
+    state.h_differ = hash_init();
+    hash_update(state.h_equal, prefix_equal, params->ss_size);
+    hash_update(state.h_differ, prefix_differ, params->ss_size);
+    pack_ct_chunked(U, len_u, params->p_bits, v, mu, params->t_bits, verify_packed, &state);
+    verify_packed(&state, suffix, params->ss_size);
+    hash_final(K, state.h_equal, params->ss_size);
+    hash_final(K_differ, state.h_differ, params->ss_size);
+
+    /* Select the key: 0xFF if c and c' differ */
+    differ_mask = (unsigned char) (-(int) (((unsigned) state.diff + 0xFFU) >> 8));
+    for (i = 0; i < params->ss_size; ++i) {
+        K[i] = (unsigned char) ((K[i] & ~differ_mask) | (K_differ[i] & differ_mask));
+    }
+
+    memset(K_differ, 0, params->ss_size);
+    free(sigma);
+    free(K_differ);
+    free(B);
+    free(R_idx);
+    free(U);
+    free(v);
+
+    return 0;
+}
+
+encrypt_ctx *encrypt_init(const unsigned char *rho, const parameters *params) {
+    encrypt_ctx *ctx = checked_calloc(1, sizeof (*ctx));
+
+    ctx->params = *params;
+    ctx->rho = checked_malloc(params->ss_size);
+    memcpy(ctx->rho, rho, params->ss_size);
+    ctx->pk = checked_malloc(params->pk_size);
+
+    return ctx;
+}
+
+int encrypt_feed(encrypt_ctx *ctx, const unsigned char *pk, const size_t pk_len) {
+    const parameters *params = &ctx->params;
+
+    if (pk_len > params->pk_size - ctx->pk_len) {
+        return 1;
+    }
+    memcpy(ctx->pk + ctx->pk_len, pk, pk_len);
+    ctx->pk_len += pk_len;
+
+    /* Start as soon as fn and sigma are in */
+    if (ctx->U == NULL && ctx->pk_len >= (size_t) params->ss_size + 1) {
+        ctx->R_idx = checked_malloc((size_t) (params->h * params->m_bar) * sizeof (*ctx->R_idx));
+        ctx->U = checked_malloc((size_t) (params->m_bar * params->d) * sizeof (*ctx->U));
+        compute_U_from_seeds(ctx->U, ctx->R_idx, ctx->pk[0], ctx->pk + 1, ctx->rho, params);
+    }
+
+    return 0;
+}
+
+int encrypt_finish(unsigned char *c, const unsigned char *m, encrypt_ctx *ctx) {
+    const parameters *params = &ctx->params;
+    const int result = ctx->pk_len != params->pk_size;
+
+    if (!result) {
+        const size_t len_b = (size_t) (params->d * params->n_bar);
+        uint16_t *B = checked_malloc(len_b * sizeof (*B));
+        unpack_part(B, ctx->pk + params->ss_size + 1, 0, len_b, params->p_bits);
+        finish_ciphertext(c, m, ctx->U, ctx->R_idx, B, params);
+        free(B);
+    }
+
+    memset(ctx->rho, 0, params->ss_size);
+    if (ctx->R_idx != NULL) {
+        memset(ctx->R_idx, 0, (size_t) (params->h * params->m_bar) * sizeof (*ctx->R_idx));
+    }
+    free(ctx->rho);
+    free(ctx->pk);
+    free(ctx->R_idx);
+    free(ctx->U);
+    free(ctx);
+
+    return result;
+}
+
+decrypt_ctx *decrypt_init(const unsigned char *sk, const parameters *params) {
+    decrypt_ctx *ctx = checked_calloc(1, sizeof (*ctx));
+    const size_t len_s = (size_t) (params->d * params->n_bar);
+    const uint16_t mu = (uint16_t) (params->ss_size * 8 / params->B);
+    uint16_t j;
+
+    ctx->params = *params;
+    ctx->S_T = checked_malloc(len_s * sizeof (*ctx->S_T));
+    ctx->S_idx = checked_malloc((size_t) (params->h * params->n_bar) * sizeof (*ctx->S_idx));
+    ctx->c = checked_malloc(params->ct_size);
+    unpack_sk(ctx->S_T, sk, len_s);
+    transform_to_index(ctx->S_idx, ctx->S_T, params->n_bar, params);
+
+    if (params->d != params->n) {
+        ctx->col_first = checked_malloc(params->n_bar * sizeof (*ctx->col_first));
+        ctx->nr_cols = checked_malloc(params->n_bar * sizeof (*ctx->nr_cols));
+        ctx->x_offset = checked_malloc(params->n_bar * sizeof (*ctx->x_offset));
+        ctx->X = checked_calloc(mu, sizeof (*ctx->X));
+        ctx->row = checked_malloc(params->m_bar * sizeof (*ctx->row));
+
+        /* The columns of U needed for each vector of S, as in compute_X_prime() */
+        for (j = 0; j < params->n_bar; ++j) {
+            const uint32_t major = (uint32_t) (params->n_bar - 1U - j) * params->m_bar;
+            const uint32_t nr_cols = major < mu ? (mu - major < params->m_bar ? mu - major : params->m_bar) : 0;
+            ctx->nr_cols[j] = (uint16_t) nr_cols;
+            ctx->col_first[j] = (uint16_t) (params->m_bar - nr_cols);
+            ctx->x_offset[j] = (uint16_t) (nr_cols ? mu - major - nr_cols : 0);
+        }
+    }
+
+    return ctx;
+}
+
+int decrypt_feed(decrypt_ctx *ctx, const unsigned char *c, const size_t c_len) {
+    const parameters *params = &ctx->params;
+
+    if (c_len > params->ct_size - ctx->c_len) {
+        return 1;
+    }
+    memcpy(ctx->c + ctx->c_len, c, c_len);
+    ctx->c_len += c_len;
+
+    if (params->d != params->n) {
+        const size_t len_u = (size_t) (params->d * params->m_bar);
+        size_t coeffs = ctx->c_len * 8 / params->p_bits;
+        ROUND2_STATS_START(compute_X_start);
+        if (coeffs > len_u) {
+            coeffs = len_u;
+        }
+        accumulate_X_prime(ctx, coeffs / params->m_bar);
+        ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_X, compute_X_start, 0);
+    }
+
+    return 0;
+}
+
+int decrypt_finish(unsigned char *m, decrypt_ctx *ctx) {
+    const parameters *params = &ctx->params;
+    const size_t len_u = (size_t) (params->d * params->m_bar);
+    const size_t mu = (size_t) (params->ss_size * 8 / params->B);
+    const int result = ctx->c_len != params->ct_size;
+
+    if (!result) {
+        uint16_t *v = checked_malloc(mu * sizeof (*v));
+
+        unpack_part(v, ctx->c + BITS_TO_BYTES(len_u * params->p_bits), 0, mu, params->t_bits);
+        /* Decompress v t_bits -> p_bits */
+        decompress_matrix(v, mu, 1, params->p_bits, params->t_bits);
+
+        if (params->d != params->n) {
+            const uint16_t mod_mask = (uint16_t) ((1U << params->p_bits) - 1);
+            size_t i;
+            for (i = 0; i < mu; ++i) {
+                ctx->X[i] &= mod_mask;
+            }
+            recover_msg(m, v, ctx->X, params);
+        } else { /* Ring: compute X' from the complete U */
+            uint16_t *U = checked_malloc(len_u * sizeof (*U));
+            uint16_t *tmp = checked_malloc((size_t) (params->n_bar * params->m_bar * params->n) * sizeof (*tmp));
+            unpack_part(U, ctx->c, 0, len_u, params->p_bits);
+            ROUND2_STATS_START(compute_X_start);
+            compute_X_prime(tmp, U, ctx->S_idx, params, params->p_bits, params->m_bar, params->n_bar);
+            ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_X, compute_X_start, 0);
+            recover_msg(m, v, tmp, params);
+            free(U);
+            free(tmp);
+        }
+
+        free(v);
+    }
+
+    memset(ctx->S_T, 0, (size_t) (params->d * params->n_bar) * sizeof (*ctx->S_T));
+    memset(ctx->S_idx, 0, (size_t) (params->h * params->n_bar) * sizeof (*ctx->S_idx));
+    free(ctx->S_T);
+    free(ctx->S_idx);
+    free(ctx->c);
+    free(ctx->col_first);
+    free(ctx->nr_cols);
+    free(ctx->x_offset);
+    free(ctx->X);
+    free(ctx->row);
+    free(ctx);
+
+    return result;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the intra-operation parallelism of the core functions.
+ *
+ * @endcond
+ */
+
+#include "pst_parallel.h"
+
+#include "misc.h"
+
+/**
+ * A thread pool of the caller.
+ */
+typedef struct {
+    pst_thread_pool_run run; /**< Runs a computation on the pool, `NULL` without pool */
+    void *pool; /**< The pool, passed to `run` */
+    size_t nr_threads; /**< The number of threads of the pool */
+} thread_pool;
+
+/** The thread pool of the calling thread */
+static THREAD_LOCAL thread_pool parallel_pool;
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+void pst_parallel_set_pool(pst_thread_pool_run run, void *pool, const size_t nr_threads) {
+    parallel_pool.run = run;
+    parallel_pool.pool = pool;
+    parallel_pool.nr_threads = run != NULL && nr_threads > 0 ? nr_threads : 1;
+}
+
+size_t pst_parallel_parts(const size_t nr_items, const size_t min_items) {
+    const size_t max_parts = min_items > 0 ? nr_items / min_items : nr_items;
+
+    if (parallel_pool.run == NULL || max_parts <= 1) {
+        return 1;
+    }
+
+    return parallel_pool.nr_threads < max_parts ? parallel_pool.nr_threads : max_parts;
+}
+
+size_t pst_parallel_start(const size_t part, const size_t nr_parts, const size_t nr_items, const size_t granularity) {
+    const size_t nr_blocks = (nr_items + granularity - 1) / granularity;
+    const size_t start = nr_blocks * part / nr_parts * granularity;
+
+    return start < nr_items ? start : nr_items;
+}
+
+void pst_parallel_run(const size_t nr_parts, pst_parallel_task task, void *context) {
+    size_t part;
+
+    if (parallel_pool.run != NULL && nr_parts > 1) {
+        parallel_pool.run(parallel_pool.pool, nr_parts, task, context);
+    } else {
+        for (part = 0; part < nr_parts; ++part) {
+            task(part, context);
+        }
+    }
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Declaration of the intra-operation parallelism of the core functions.
+ *
+ * A single operation (key generation, encapsulation, ...) can be spread over
+ * a thread pool of the caller, to reduce its latency: the generation of
+ * A_master (in counter mode), the rows of the products of `compute_B` and
+ * the columns of that of `compute_U` are split into parts that are computed
+ * concurrently. The parts do not depend on the number of threads in any way
+ * that changes the result, so the results are bit-identical to those of the
+ * serial computation.
+ *
+ * The pool is set per thread: the operations of the thread that set it use
+ * it, those of other threads (including the threads of the pool) run
+ * serially.
+ *
+ * @endcond
+ */
+
+#ifndef PST_PARALLEL_H
+#define PST_PARALLEL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * A part of a computation, run by a thread of the pool.
+     *
+     * @param[in]     part     the part to compute
+     * @param[in,out] context  the computation
+     */
+    typedef void (*pst_parallel_task)(const size_t part, void *context);
+
+    /**
+     * Runs a computation on a thread pool of the caller: calls
+     * `task(part, context)` for each _part_ < _nr_parts_, concurrently (in any
+     * order and on any of its threads, including the calling one), and
+     * returns when all have finished.
+     *
+     * @param[in,out] pool      the thread pool
+     * @param[in]     nr_parts  the number of parts
+     * @param[in]     task      computes a part
+     * @param[in,out] context   the computation, passed to _task_
+     */
+    typedef void (*pst_thread_pool_run)(void *pool, const size_t nr_parts, pst_parallel_task task, void *context);
+
+    /**
+     * Sets the thread pool over which the operations of the calling thread
+     * are spread, or, with a _run_ of `NULL`, makes them run serially again
+     * (the default).
+     *
+     * @param[in] run         runs a computation on the pool, or `NULL`
+     * @param[in] pool        the thread pool, passed to _run_
+     * @param[in] nr_threads  the number of threads the pool runs the parts on
+     */
+    void pst_parallel_set_pool(pst_thread_pool_run run, void *pool, const size_t nr_threads);
+
+    /**
+     * Determines the number of parts into which to split a computation on
+     * the thread pool of the calling thread: one per thread, but at least
+     * _min_items_ items per part.
+     *
+     * @param[in] nr_items   the number of items of the computation
+     * @param[in] min_items  the minimum number of items of a part
+     * @return the number of parts, __1__ without thread pool
+     */
+    size_t pst_parallel_parts(const size_t nr_items, const size_t min_items);
+
+    /**
+     * Determines the first item of a part of a computation, the parts being
+     * (nearly) equally large multiples of _granularity_ items (except the
+     * last one). The part ends where the next one starts.
+     *
+     * @param[in] part         the part (_nr_parts_ for the end of the last one)
+     * @param[in] nr_parts     the number of parts
+     * @param[in] nr_items     the number of items of the computation
+     * @param[in] granularity  the granularity of the parts
+     * @return the first item of the part
+     */
+    size_t pst_parallel_start(const size_t part, const size_t nr_parts, const size_t nr_items, const size_t granularity);
+
+    /**
+     * Runs the parts of a computation on the thread pool of the calling
+     * thread, or one after the other without thread pool.
+     *
+     * @param[in]     nr_parts  the number of parts
+     * @param[in]     task      computes a part
+     * @param[in,out] context   the computation, passed to _task_
+     */
+    void pst_parallel_run(const size_t nr_parts, pst_parallel_task task, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PST_PARALLEL_H */
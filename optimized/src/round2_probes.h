@@ -0,0 +1 @@
+../../reference/src/round2_probes.h
\ No newline at end of file
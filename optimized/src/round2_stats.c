@@ -0,0 +1 @@
+../../reference/src/round2_stats.c
\ No newline at end of file
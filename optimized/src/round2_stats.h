@@ -0,0 +1 @@
+../../reference/src/round2_stats.h
\ No newline at end of file
@@ -52,6 +52,12 @@ extern "C" {
     /** The fixed A matrix for use inside with the non-ring algorithm when fn=1. */
     static uint16_t *A_fixed = NULL;
 
+    /** The dimension of the parameter set the fixed A matrix was created for. */
+    static uint16_t A_fixed_d = 0;
+
+    /** The modulus of the parameter set the fixed A matrix was created for. */
+    static uint16_t A_fixed_q = 0;
+
 #ifdef __cplusplus
 }
 #endif
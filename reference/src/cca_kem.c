@@ -50,6 +50,8 @@
 #include "misc.h"
 #include "randombytes.h"
 #include "drng.h"
+#include "kem_latency.h"
+#include "round2_probes.h"
 
 /*******************************************************************************
  * Private functions & macros
@@ -66,6 +68,91 @@
             params.sk_size + params.ss_size + params.pk_size, CRYPTO_SECRETKEYBYTES, \
             params.ct_size + params.ss_size, CRYPTO_CIPHERTEXTBYTES)
 
+/**
+ * Finishes the decapsulation of a ciphertext once m' has been decrypted from
+ * it: re-encrypts m' and derives the shared secret depending on whether the
+ * result matches the ciphertext.
+ *
+ * @param[out] K       shared secret
+ * @param[in]  c       key encapsulation message (of size `ct_size` + `ss_size`)
+ * @param[in]  m_prime the message decrypted from `c`
+ * @param[in]  sk      secret key with which the message is to be de-capsulated
+ * @param[in]  params  the algorithm parameters to use
+ * @return __0__ in case of success
+ */
+static int decapsulate(unsigned char *K, const unsigned char *c, const unsigned char *m_prime, const unsigned char *sk, const parameters *params) {
+    hash_ctx *h;
+    unsigned char *l_prime;
+    unsigned char *g_prime;
+    unsigned char *rho_prime;
+    const unsigned char *z = sk + params->sk_size; /* z is located after the sk */
+    const unsigned char *pk = z + params->ss_size; /* pk is located after z  */
+
+    /* Allocate space */
+    l_prime = checked_malloc(params->ss_size);
+    g_prime = checked_malloc(params->ss_size);
+    rho_prime = checked_malloc(params->ss_size);
+
+    /* Consecutive hashing */
+    h = hash_init();
+    hash_update(h, m_prime, params->ss_size);
+    hash_update(h, pk, params->pk_size);
+    hash_final(l_prime, h, params->ss_size);
+    hash(g_prime, l_prime, params->ss_size, params->ss_size);
+    hash(rho_prime, g_prime, params->ss_size, params->ss_size);
+
+#if defined(ROUND2_INTERMEDIATE) || defined(DEBUG)
+    print_hex("cca_decrypt: m_prime", m_prime, params->ss_size, 1);
+    print_hex("cca_decrypt: l_prime", l_prime, params->ss_size, 1);
+    print_hex("cca_decrypt: g_prime", g_prime, params->ss_size, 1);
+    print_hex("cca_decrypt: rho_prime", rho_prime, params->ss_size, 1);
+#endif
+
+    /* Re-encrypt m: c' = (U',v',g'), K = H(l', c') if c' equals c, else K = H(z, c') */
+    encrypt_rho_verify(K, c, m_prime, rho_prime, g_prime, l_prime, z, pk, params);
+
+    free(l_prime);
+    free(g_prime);
+    free(rho_prime);
+
+    return 0;
+}
+
+/**
+ * Decapsulates the ciphertexts of several independent sessions.
+ *
+ * @param[out] K           shared secrets, consecutive
+ * @param[in]  c           key encapsulation messages, consecutive
+ * @param[in]  sk          secret keys, the one of session _s_ at _sk + s * sk_stride_
+ * @param[in]  sk_stride   the distance between consecutive secret keys, 0 if the sessions share one
+ * @param[in]  nr_sessions the number of sessions
+ * @param[in]  params      the algorithm parameters to use
+ */
+static void decapsulate_multi(unsigned char *K, const unsigned char *c, const unsigned char *sk, const size_t sk_stride, const size_t nr_sessions, const parameters *params) {
+    const size_t c_size = (size_t) (params->ct_size + params->ss_size);
+    unsigned char *m_prime = checked_malloc(nr_sessions * params->ss_size);
+    size_t s;
+
+    /* Decrypt the m' */
+    decrypt_multi(m_prime, c, c_size, sk, sk_stride, nr_sessions, params);
+    for (s = 0; s < nr_sessions; ++s) {
+        decapsulate(K + s * params->ss_size, c + s * c_size, m_prime + s * params->ss_size, sk + s * sk_stride, params);
+    }
+
+    free(m_prime);
+}
+
+/**
+ * The state of an incremental CCA KEM decapsulation.
+ */
+struct cca_kem_dec_ctx {
+    parameters params; /**< The algorithm parameters in use */
+    decrypt_ctx *decrypt; /**< The incremental decryption of m' */
+    unsigned char *sk; /**< The secret key */
+    unsigned char *c; /**< The ciphertext received so far */
+    size_t c_len; /**< The number of bytes of the ciphertext received so far */
+};
+
 /*******************************************************************************
  * Public functions
  ******************************************************************************/
@@ -97,7 +184,26 @@ int crypto_cca_kem_dec(unsigned char *ss, const unsigned char *ct, const unsigne
     return crypto_cca_kem_dec_p(ss, ct, sk, &params);
 }
 
+int crypto_cca_kem_enc_multi(unsigned char *ct, unsigned char *ss, const unsigned char *pk, const size_t nr_sessions) {
+    parameters params;
+    if (set_parameters_from_api(&params)) {
+        exit(EXIT_FAILURE);
+    }
+    check_api_parameters();
+    return crypto_cca_kem_enc_multi_p(ct, ss, pk, nr_sessions, &params);
+}
+
+int crypto_cca_kem_dec_multi(unsigned char *ss, const unsigned char *ct, const unsigned char *sk, const size_t nr_sessions) {
+    parameters params;
+    if (set_parameters_from_api(&params)) {
+        exit(EXIT_FAILURE);
+    }
+    check_api_parameters();
+    return crypto_cca_kem_dec_multi_p(ss, ct, sk, nr_sessions, &params);
+}
+
 int crypto_cca_kem_keypair_p(unsigned char *pk, unsigned char *sk, const parameters *params, const uint8_t fn) {
+    const uint64_t start = kem_latency_start(KEM_LATENCY_KEYPAIR);
     unsigned char *z = malloc(params->ss_size);
 
     /* Generate the base key pair */
@@ -110,16 +216,21 @@ int crypto_cca_kem_keypair_p(unsigned char *pk, unsigned char *sk, const paramet
 
     free(z);
 
+    kem_latency_stop(KEM_LATENCY_KEYPAIR, start);
+
     return 0;
 }
 
 int crypto_cca_kem_enc_p(unsigned char *c, unsigned char *K, const unsigned char *pk, const parameters *params) {
+    const uint64_t start = kem_latency_start(KEM_LATENCY_ENCAPSULATE);
     unsigned char *hash_input;
     unsigned char *m;
     unsigned char *l;
     unsigned char *g;
     unsigned char *rho;
 
+    ROUND2_PROBE(cca_kem_enc_entry, params, pk[0]);
+
     /* Allocate space */
     hash_input = checked_malloc((size_t) (params->ss_size + params->pk_size));
     m = checked_malloc(params->ss_size);
@@ -162,68 +273,132 @@ int crypto_cca_kem_enc_p(unsigned char *c, unsigned char *K, const unsigned char
     free(l);
     free(g);
 
+    ROUND2_PROBE(cca_kem_enc_return, params, pk[0]);
+
+    kem_latency_stop(KEM_LATENCY_ENCAPSULATE, start);
+
     return 0;
 }
 
 int crypto_cca_kem_dec_p(unsigned char *K, const unsigned char *c, const unsigned char *sk, const parameters *params) {
-    unsigned char *hash_input;
-    unsigned char *m_prime;
-    unsigned char *l_prime;
-    unsigned char *g_prime;
-    unsigned char *rho_prime;
-    unsigned char *c_prime;
-    const unsigned char *z = sk + params->sk_size; /* z is located after the sk */
-    const unsigned char *pk = z + params->ss_size; /* pk is located after z  */
+    const uint64_t start = kem_latency_start(KEM_LATENCY_DECAPSULATE);
+    unsigned char *m_prime = checked_malloc(params->ss_size);
 
-    /* Allocate space */
-    hash_input = checked_malloc((size_t) (params->ss_size + params->ct_size));
-    m_prime = checked_malloc(params->ss_size);
-    l_prime = checked_malloc(params->ss_size);
-    g_prime = checked_malloc(params->ss_size);
-    rho_prime = checked_malloc(params->ss_size);
-    c_prime = checked_malloc((size_t) (params->ct_size + params->ss_size));
+    /* The variant of A is the first byte of the public key appended to sk */
+    ROUND2_PROBE(cca_kem_dec_entry, params, sk[params->sk_size + params->ss_size]);
 
     /* Decrypt m' */
     decrypt(m_prime, c, sk, params);
+    decapsulate(K, c, m_prime, sk, params);
 
-    /* Consecutive hashing */
-    memcpy(hash_input, m_prime, params->ss_size);
-    memcpy(hash_input + params->ss_size, pk, params->pk_size);
-    hash(l_prime, hash_input, (size_t) (params->ss_size + params->pk_size), params->ss_size);
-    hash(g_prime, l_prime, params->ss_size, params->ss_size);
-    hash(rho_prime, g_prime, params->ss_size, params->ss_size);
+    free(m_prime);
 
-#if defined(ROUND2_INTERMEDIATE) || defined(DEBUG)
-    print_hex("cca_decrypt: m_prime", m_prime, params->ss_size, 1);
-    print_hex("cca_decrypt: l_prime", l_prime, params->ss_size, 1);
-    print_hex("cca_decrypt: g_prime", g_prime, params->ss_size, 1);
-    print_hex("cca_decrypt: rho_prime", rho_prime, params->ss_size, 1);
-#endif
+    ROUND2_PROBE(cca_kem_dec_return, params, sk[params->sk_size + params->ss_size]);
+
+    kem_latency_stop(KEM_LATENCY_DECAPSULATE, start);
+
+    return 0;
+}
+
+int crypto_cca_kem_enc_multi_p(unsigned char *c, unsigned char *K, const unsigned char *pk, const size_t nr_sessions, const parameters *params) {
+    const size_t c_size = (size_t) (params->ct_size + params->ss_size);
+    unsigned char *m = checked_malloc(nr_sessions * params->ss_size);
+    unsigned char *l = checked_malloc(nr_sessions * params->ss_size);
+    unsigned char *rho = checked_malloc(nr_sessions * params->ss_size);
+    hash_ctx *h;
+    size_t s;
+
+    for (s = 0; s < nr_sessions; ++s) {
+        unsigned char *g = c + s * c_size + params->ct_size; /* g is appended to c = (U,v,g) */
+
+        /* Generate random m */
+        randombytes(m + s * params->ss_size, params->ss_size);
+
+        /* Consecutive hashing */
+        h = hash_init();
+        hash_update(h, m + s * params->ss_size, params->ss_size);
+        hash_update(h, pk + s * params->pk_size, params->pk_size);
+        hash_final(l + s * params->ss_size, h, params->ss_size);
+        hash(g, l + s * params->ss_size, params->ss_size, params->ss_size);
+        hash(rho + s * params->ss_size, g, params->ss_size, params->ss_size);
+    }
+
+    /* Encrypt the m: c = (U,v) */
+    encrypt_rho_multi(c, c_size, m, rho, pk, nr_sessions, params);
+
+    /* K = H(l, c) */
+    for (s = 0; s < nr_sessions; ++s) {
+        h = hash_init();
+        hash_update(h, l + s * params->ss_size, params->ss_size);
+        hash_update(h, c + s * c_size, c_size);
+        hash_final(K + s * params->ss_size, h, params->ss_size);
+    }
+
+    free(rho);
+    free(l);
+    free(m);
+
+    return 0;
+}
+
+int crypto_cca_kem_dec_multi_p(unsigned char *K, const unsigned char *c, const unsigned char *sk, const size_t nr_sessions, const parameters *params) {
+    decapsulate_multi(K, c, sk, (size_t) (params->sk_size + params->ss_size + params->pk_size), nr_sessions, params);
+
+    return 0;
+}
+
+int crypto_cca_kem_dec_multi_single_key_p(unsigned char *K, const unsigned char *c, const unsigned char *sk, const size_t nr_sessions, const parameters *params) {
+    decapsulate_multi(K, c, sk, 0, nr_sessions, params);
+
+    return 0;
+}
+
+cca_kem_dec_ctx *crypto_cca_kem_dec_init_p(const unsigned char *sk, const parameters *params) {
+    const size_t sk_len = (size_t) (params->sk_size + params->ss_size + params->pk_size);
+    cca_kem_dec_ctx *ctx = checked_calloc(1, sizeof (*ctx));
+
+    ctx->params = *params;
+    ctx->decrypt = decrypt_init(sk, params);
+    ctx->sk = checked_malloc(sk_len);
+    memcpy(ctx->sk, sk, sk_len);
+    ctx->c = checked_malloc((size_t) (params->ct_size + params->ss_size));
 
-    /* Encrypt m: c' = (U',v') */
-    encrypt_rho(c_prime, m_prime, rho_prime, pk, params);
-    /* Append g': c' = (U',v',g') */
-    memcpy(c_prime + params->ct_size, g_prime, params->ss_size);
-
-    hash_input = realloc(hash_input, (size_t) (params->ss_size + params->ct_size + params->ss_size));
-    if (memcmp(c, c_prime, (size_t) (params->ct_size + params->ss_size)) == 0) {
-        /* K = H(l', c') */
-        memcpy(hash_input, l_prime, params->ss_size);
-        memcpy(hash_input + params->ss_size, c_prime, (size_t) (params->ct_size + params->ss_size));
-        hash(K, hash_input, (size_t) (params->ss_size + params->ct_size + params->ss_size), params->ss_size);
+    return ctx;
+}
+
+int crypto_cca_kem_dec_feed(cca_kem_dec_ctx *ctx, const unsigned char *c, const size_t c_len) {
+    const size_t ct_size = ctx->params.ct_size;
+
+    if (c_len > ct_size + ctx->params.ss_size - ctx->c_len) {
+        return 1;
+    }
+    /* Only (U,v) goes into the decryption, g is only needed at the end */
+    if (ctx->c_len < ct_size) {
+        decrypt_feed(ctx->decrypt, c, c_len < ct_size - ctx->c_len ? c_len : ct_size - ctx->c_len);
+    }
+    memcpy(ctx->c + ctx->c_len, c, c_len);
+    ctx->c_len += c_len;
+
+    return 0;
+}
+
+int crypto_cca_kem_dec_finish(unsigned char *K, cca_kem_dec_ctx *ctx) {
+    const parameters *params = &ctx->params;
+    unsigned char *m_prime = checked_malloc(params->ss_size);
+    int result = decrypt_finish(m_prime, ctx->decrypt);
+
+    if (!result && ctx->c_len == (size_t) (params->ct_size + params->ss_size)) {
+        decapsulate(K, ctx->c, m_prime, ctx->sk, params);
     } else {
-        /* K = H(z, c') */
-        memcpy(hash_input, z, params->ss_size);
-        memcpy(hash_input + params->ss_size, c_prime, (size_t) (params->ct_size + params->ss_size));
-        hash(K, hash_input, (size_t) (params->ss_size + params->ct_size + params->ss_size), params->ss_size);
+        result = 1;
     }
 
-    free(hash_input);
+    memset(ctx->sk, 0, (size_t) (params->sk_size + params->ss_size + params->pk_size));
+    memset(m_prime, 0, params->ss_size);
+    free(ctx->sk);
+    free(ctx->c);
+    free(ctx);
     free(m_prime);
-    free(l_prime);
-    free(g_prime);
-    free(rho_prime);
-    free(c_prime);
 
-    return 0;
+    return result;
 }
@@ -37,6 +37,8 @@
 #ifndef CCA_KEM_H
 #define CCA_KEM_H
 
+#include <stddef.h>
+
 #include "parameters.h"
 
 #ifdef __cplusplus
@@ -109,6 +111,121 @@ extern "C" {
      */
     int crypto_cca_kem_dec_p(unsigned char *K, const unsigned char *c, const unsigned char *sk, const parameters *params);
 
+    /**
+     * CCA KEM encapsulate for several independent sessions at once, e.g.
+     * the handshakes queued at a TLS terminator. Uses the fixed parameter
+     * configuration from `api.h`. The results are the same as those of
+     * `crypto_cca_kem_enc()` for each session. Only the unlifting of the ring
+     * parameter sets is interleaved over the sessions (see
+     * `encrypt_rho_multi()`).
+     *
+     * @param[out] ct          key encapsulation messages, consecutive
+     * @param[out] ss          shared secrets, consecutive
+     * @param[in]  pk          public keys, consecutive (one per session)
+     * @param[in]  nr_sessions the number of sessions
+     * @return __0__ in case of success
+     */
+    int crypto_cca_kem_enc_multi(unsigned char *ct, unsigned char *ss, const unsigned char *pk, const size_t nr_sessions);
+
+    /**
+     * CCA KEM de-capsulate for several independent sessions at once. Uses
+     * the fixed parameter configuration from `api.h`.
+     *
+     * @param[out] ss          shared secrets, consecutive
+     * @param[in]  ct          key encapsulation messages, consecutive
+     * @param[in]  sk          secret keys, consecutive (one per session)
+     * @param[in]  nr_sessions the number of sessions
+     * @return __0__ in case of success
+     */
+    int crypto_cca_kem_dec_multi(unsigned char *ss, const unsigned char *ct, const unsigned char *sk, const size_t nr_sessions);
+
+    /**
+     * CCA KEM encapsulate for several independent sessions at once. Uses
+     * the parameters as specified.
+     *
+     * @param[out] c           key encapsulation messages, consecutive (of size `ct_size` + `ss_size` each)
+     * @param[out] K           shared secrets, consecutive (of size `ss_size` each)
+     * @param[in]  pk          public keys, consecutive (of size `pk_size` each)
+     * @param[in]  nr_sessions the number of sessions
+     * @param[in]  params      the algorithm parameters to use
+     * @return __0__ in case of success
+     */
+    int crypto_cca_kem_enc_multi_p(unsigned char *c, unsigned char *K, const unsigned char *pk, const size_t nr_sessions, const parameters *params);
+
+    /**
+     * CCA KEM de-capsulate for several independent sessions at once. Uses
+     * the parameters as specified.
+     *
+     * @param[out] K           shared secrets, consecutive (of size `ss_size` each)
+     * @param[in]  c           key encapsulation messages, consecutive (of size `ct_size` + `ss_size` each)
+     * @param[in]  sk          secret keys, consecutive (of size `sk_size` + `ss_size` + `pk_size` each)
+     * @param[in]  nr_sessions the number of sessions
+     * @param[in]  params      the algorithm parameters to use
+     * @return __0__ in case of success
+     */
+    int crypto_cca_kem_dec_multi_p(unsigned char *K, const unsigned char *c, const unsigned char *sk, const size_t nr_sessions, const parameters *params);
+
+    /**
+     * CCA KEM de-capsulate for several independent sessions with a single
+     * secret key, e.g. the handshakes of a server. Uses the parameters as
+     * specified. The results are the same as those of
+     * `crypto_cca_kem_dec_p()` for each session. Of the ring parameter sets,
+     * the optimized implementation computes the products with the secret
+     * key side by side, one session per lane (see `decrypt_multi()`); the
+     * re-encryptions are done session by session.
+     *
+     * @param[out] K           shared secrets, consecutive (of size `ss_size` each)
+     * @param[in]  c           key encapsulation messages, consecutive (of size `ct_size` + `ss_size` each)
+     * @param[in]  sk          the secret key of all sessions (of size `sk_size` + `ss_size` + `pk_size`)
+     * @param[in]  nr_sessions the number of sessions
+     * @param[in]  params      the algorithm parameters to use
+     * @return __0__ in case of success
+     */
+    int crypto_cca_kem_dec_multi_single_key_p(unsigned char *K, const unsigned char *c, const unsigned char *sk, const size_t nr_sessions, const parameters *params);
+
+    /**
+     * The state of an incremental CCA KEM de-capsulation (opaque).
+     */
+    typedef struct cca_kem_dec_ctx cca_kem_dec_ctx;
+
+    /**
+     * Starts an incremental CCA KEM de-capsulation, for a key encapsulation
+     * message that is received in parts. The parts are passed to
+     * `crypto_cca_kem_dec_feed()`, after the last part `crypto_cca_kem_dec_finish()`
+     * produces the shared secret. The work that can be done on the parts
+     * received so far is done while the remaining parts are still coming in
+     * (see `decrypt_feed()`). Note that only the decryption is done this way:
+     * `crypto_cca_kem_dec_finish()` still re-encrypts the decrypted message
+     * completely (to check the key encapsulation message) after the last part
+     * has been received, so the time from the last part to the shared secret
+     * is reduced much less than in the CPA case.
+     *
+     * @param[in]  sk     secret key with which the message is to be de-capsulated (<b>important:</b> the size of `sk` is `sk_size` + `ss_size` + `pk_size`!)
+     * @param[in]  params the algorithm parameters to use
+     * @return the state of the de-capsulation
+     */
+    cca_kem_dec_ctx *crypto_cca_kem_dec_init_p(const unsigned char *sk, const parameters *params);
+
+    /**
+     * Passes the next part of the key encapsulation message to an incremental
+     * CCA KEM de-capsulation.
+     *
+     * @param[in]  ctx    the state of the de-capsulation
+     * @param[in]  c      the next part of the key encapsulation message (<b>important:</b> the total size is `ct_size` + `ss_size`!)
+     * @param[in]  c_len  the length of the part
+     * @return __0__ in case of success, __1__ if the part does not fit in the message
+     */
+    int crypto_cca_kem_dec_feed(cca_kem_dec_ctx *ctx, const unsigned char *c, const size_t c_len);
+
+    /**
+     * Finishes an incremental CCA KEM de-capsulation and releases its state.
+     *
+     * @param[out] K      shared secret
+     * @param[in]  ctx    the state of the de-capsulation
+     * @return __0__ in case of success, __1__ if the key encapsulation message was incomplete
+     */
+    int crypto_cca_kem_dec_finish(unsigned char *K, cca_kem_dec_ctx *ctx);
+
 #ifdef __cplusplus
 }
 #endif
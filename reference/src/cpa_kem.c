@@ -50,6 +50,7 @@
 #include "misc.h"
 #include "randombytes.h"
 #include "drng.h"
+#include "kem_latency.h"
 
 /*******************************************************************************
  * Private functions & macros
@@ -66,6 +67,68 @@
             params.sk_size, CRYPTO_SECRETKEYBYTES, \
             params.ct_size, CRYPTO_CIPHERTEXTBYTES)
 
+/**
+ * Derives the shared secret K = H(m, c).
+ *
+ * @param[out] K      shared secret
+ * @param[in]  m      the encapsulated message
+ * @param[in]  c      key encapsulation message
+ * @param[in]  params the algorithm parameters to use
+ */
+static void derive_key(unsigned char *K, const unsigned char *m, const unsigned char *c, const parameters *params) {
+    unsigned char *hash_input = checked_malloc((size_t) (params->ss_size + params->ct_size));
+
+    memcpy(hash_input, m, params->ss_size);
+    memcpy(hash_input + params->ss_size, c, params->ct_size);
+    hash(K, hash_input, (size_t) (params->ss_size + params->ct_size), params->ss_size);
+
+    free(hash_input);
+}
+
+/**
+ * Decapsulates the ciphertexts of several independent sessions.
+ *
+ * @param[out] K           shared secrets, consecutive
+ * @param[in]  c           key encapsulation messages, consecutive
+ * @param[in]  sk          secret keys, the one of session _s_ at _sk + s * sk_stride_
+ * @param[in]  sk_stride   the distance between consecutive secret keys, 0 if the sessions share one
+ * @param[in]  nr_sessions the number of sessions
+ * @param[in]  params      the algorithm parameters to use
+ */
+static void decapsulate_multi(unsigned char *K, const unsigned char *c, const unsigned char *sk, const size_t sk_stride, const size_t nr_sessions, const parameters *params) {
+    unsigned char *m = checked_malloc(nr_sessions * params->ss_size);
+    size_t s;
+
+    /* Decrypt the m */
+    decrypt_multi(m, c, params->ct_size, sk, sk_stride, nr_sessions, params);
+
+    /* K = H(m, c) */
+    for (s = 0; s < nr_sessions; ++s) {
+        derive_key(K + s * params->ss_size, m + s * params->ss_size, c + s * params->ct_size, params);
+    }
+
+    free(m);
+}
+
+/**
+ * The state of an incremental CPA KEM encapsulation.
+ */
+struct cpa_kem_enc_ctx {
+    parameters params; /**< The algorithm parameters in use */
+    encrypt_ctx *encrypt; /**< The incremental encryption of m */
+    unsigned char *m; /**< The encapsulated message */
+};
+
+/**
+ * The state of an incremental CPA KEM decapsulation.
+ */
+struct cpa_kem_dec_ctx {
+    parameters params; /**< The algorithm parameters in use */
+    decrypt_ctx *decrypt; /**< The incremental decryption of m */
+    unsigned char *c; /**< The ciphertext received so far */
+    size_t c_len; /**< The number of bytes of the ciphertext received so far */
+};
+
 /*******************************************************************************
  * Public functions
  ******************************************************************************/
@@ -97,16 +160,38 @@ int crypto_kem_dec(unsigned char *ss, const unsigned char *ct, const unsigned ch
     return crypto_kem_dec_p(ss, ct, sk, &params);
 }
 
+int crypto_kem_enc_multi(unsigned char *ct, unsigned char *ss, const unsigned char *pk, const size_t nr_sessions) {
+    parameters params;
+    if (set_parameters_from_api(&params)) {
+        exit(EXIT_FAILURE);
+    }
+    check_api_parameters();
+    return crypto_kem_enc_multi_p(ct, ss, pk, nr_sessions, &params);
+}
+
+int crypto_kem_dec_multi(unsigned char *ss, const unsigned char *ct, const unsigned char *sk, const size_t nr_sessions) {
+    parameters params;
+    if (set_parameters_from_api(&params)) {
+        exit(EXIT_FAILURE);
+    }
+    check_api_parameters();
+    return crypto_kem_dec_multi_p(ss, ct, sk, nr_sessions, &params);
+}
+
 int crypto_kem_keypair_p(unsigned char *pk, unsigned char *sk, const parameters *params, const uint8_t fn) {
-    return generate_keypair(pk, sk, params, fn);
+    const uint64_t start = kem_latency_start(KEM_LATENCY_KEYPAIR);
+    const int result = generate_keypair(pk, sk, params, fn);
+
+    kem_latency_stop(KEM_LATENCY_KEYPAIR, start);
+
+    return result;
 }
 
 int crypto_kem_enc_p(unsigned char *c, unsigned char *K, const unsigned char *pk, const parameters *params) {
-    unsigned char *hash_input;
+    const uint64_t start = kem_latency_start(KEM_LATENCY_ENCAPSULATE);
     unsigned char *m;
 
     /* Allocate space */
-    hash_input = checked_malloc((size_t) (params->ss_size + params->ct_size));
     m = checked_malloc(params->ss_size);
 
     /* Generate a random m */
@@ -120,22 +205,20 @@ int crypto_kem_enc_p(unsigned char *c, unsigned char *K, const unsigned char *pk
     encrypt(c, m, pk, params);
 
     /* K = H(m, c) */
-    memcpy(hash_input, m, params->ss_size);
-    memcpy(hash_input + params->ss_size, c, params->ct_size);
-    hash(K, hash_input, (size_t) (params->ss_size + params->ct_size), params->ss_size);
+    derive_key(K, m, c, params);
 
-    free(hash_input);
     free(m);
 
+    kem_latency_stop(KEM_LATENCY_ENCAPSULATE, start);
+
     return 0;
 }
 
 int crypto_kem_dec_p(unsigned char *K, const unsigned char *c, const unsigned char *sk, const parameters *params) {
-    unsigned char *hash_input;
+    const uint64_t start = kem_latency_start(KEM_LATENCY_DECAPSULATE);
     unsigned char *m;
 
     /* Allocate space */
-    hash_input = checked_malloc((size_t) (params->ss_size + params->ct_size));
     m = checked_malloc(params->ss_size);
 
     /* Decrypt m */
@@ -146,12 +229,125 @@ int crypto_kem_dec_p(unsigned char *K, const unsigned char *c, const unsigned ch
 #endif
 
     /* K = H(m, c) */
-    memcpy(hash_input, m, params->ss_size);
-    memcpy(hash_input + params->ss_size, c, params->ct_size);
-    hash(K, hash_input, (size_t) (params->ss_size + params->ct_size), params->ss_size);
+    derive_key(K, m, c, params);
 
-    free(hash_input);
     free(m);
 
+    kem_latency_stop(KEM_LATENCY_DECAPSULATE, start);
+
+    return 0;
+}
+
+int crypto_kem_enc_multi_p(unsigned char *c, unsigned char *K, const unsigned char *pk, const size_t nr_sessions, const parameters *params) {
+    unsigned char *m = checked_malloc(nr_sessions * params->ss_size);
+    unsigned char *rho = checked_malloc(nr_sessions * params->ss_size);
+    size_t s;
+
+    /* Generate a random m and rho per session (in the same order as crypto_kem_enc_p) */
+    for (s = 0; s < nr_sessions; ++s) {
+        randombytes(m + s * params->ss_size, params->ss_size);
+        randombytes(rho + s * params->ss_size, params->ss_size);
+    }
+
+    /* Encrypt the m */
+    encrypt_rho_multi(c, params->ct_size, m, rho, pk, nr_sessions, params);
+
+    /* K = H(m, c) */
+    for (s = 0; s < nr_sessions; ++s) {
+        derive_key(K + s * params->ss_size, m + s * params->ss_size, c + s * params->ct_size, params);
+    }
+
+    memset(rho, 0, nr_sessions * params->ss_size);
+    free(rho);
+    free(m);
+
+    return 0;
+}
+
+int crypto_kem_dec_multi_p(unsigned char *K, const unsigned char *c, const unsigned char *sk, const size_t nr_sessions, const parameters *params) {
+    decapsulate_multi(K, c, sk, params->sk_size, nr_sessions, params);
+
+    return 0;
+}
+
+int crypto_kem_dec_multi_single_key_p(unsigned char *K, const unsigned char *c, const unsigned char *sk, const size_t nr_sessions, const parameters *params) {
+    decapsulate_multi(K, c, sk, 0, nr_sessions, params);
+
+    return 0;
+}
+
+cpa_kem_enc_ctx *crypto_kem_enc_init_p(const parameters *params) {
+    cpa_kem_enc_ctx *ctx = checked_calloc(1, sizeof (*ctx));
+    unsigned char *rho = checked_malloc(params->ss_size);
+
+    ctx->params = *params;
+    ctx->m = checked_malloc(params->ss_size);
+
+    /* Generate a random m and rho (in the same order as crypto_kem_enc_p) */
+    randombytes(ctx->m, params->ss_size);
+    randombytes(rho, params->ss_size);
+    ctx->encrypt = encrypt_init(rho, params);
+
+    memset(rho, 0, params->ss_size);
+    free(rho);
+
+    return ctx;
+}
+
+int crypto_kem_enc_feed(cpa_kem_enc_ctx *ctx, const unsigned char *pk, const size_t pk_len) {
+    return encrypt_feed(ctx->encrypt, pk, pk_len);
+}
+
+int crypto_kem_enc_finish(unsigned char *c, unsigned char *K, cpa_kem_enc_ctx *ctx) {
+    const parameters *params = &ctx->params;
+    const int result = encrypt_finish(c, ctx->m, ctx->encrypt);
+
+    if (!result) {
+        /* K = H(m, c) */
+        derive_key(K, ctx->m, c, params);
+    }
+
+    memset(ctx->m, 0, params->ss_size);
+    free(ctx->m);
+    free(ctx);
+
+    return result;
+}
+
+cpa_kem_dec_ctx *crypto_kem_dec_init_p(const unsigned char *sk, const parameters *params) {
+    cpa_kem_dec_ctx *ctx = checked_calloc(1, sizeof (*ctx));
+
+    ctx->params = *params;
+    ctx->decrypt = decrypt_init(sk, params);
+    ctx->c = checked_malloc(params->ct_size);
+
+    return ctx;
+}
+
+int crypto_kem_dec_feed(cpa_kem_dec_ctx *ctx, const unsigned char *c, const size_t c_len) {
+    if (decrypt_feed(ctx->decrypt, c, c_len)) {
+        return 1;
+    }
+    memcpy(ctx->c + ctx->c_len, c, c_len);
+    ctx->c_len += c_len;
+
     return 0;
 }
+
+int crypto_kem_dec_finish(unsigned char *K, cpa_kem_dec_ctx *ctx) {
+    const parameters *params = &ctx->params;
+    unsigned char *m = checked_malloc(params->ss_size);
+    const int result = decrypt_finish(m, ctx->decrypt);
+
+    if (!result) {
+        /* K = H(m, c) */
+        derive_key(K, m, ctx->c, params);
+    }
+
+    memset(m, 0, params->ss_size);
+    free(m);
+    free(ctx->c);
+    free(ctx);
+
+    return result;
+}
@@ -47,6 +47,9 @@
 
 #include <openssl/evp.h>
 
+#include "misc.h"
+#include "round2_stats.h"
+
 /*******************************************************************************
  * Private functions
  ******************************************************************************/
@@ -64,14 +67,10 @@ typedef struct {
 
 /**
  * The context of the seed expander used for generating the deterministic
- * random numbers.
- */
-static seed_expander_context seed_expander_ctx;
-
-/**
- * The AES ECB context as used within in the seed expander.
+ * random numbers. Each thread has its own context so that key pairs and
+ * ciphertexts can be generated concurrently.
  */
-static EVP_CIPHER_CTX *aes_ctx;
+static THREAD_LOCAL seed_expander_context seed_expander_ctx;
 
 /**
  * Runs AES in ECB mode on the given key and counter (=plaintext).
@@ -81,6 +80,7 @@ static EVP_CIPHER_CTX *aes_ctx;
  * @param[in]  ctr    the counter to use (16 bytes)
  */
 static void aes_ecb(unsigned char *buffer, const unsigned char *key, const unsigned char *ctr) {
+    EVP_CIPHER_CTX *aes_ctx;
     int len;
 
     /* Initialize */
@@ -127,7 +127,7 @@ static int seedexpander_init(const unsigned char *seed) {
  * @param[in]  xlen the number of random bytes to produce
  * @return __0__ upon success
  */
-static int seedexpander(unsigned char *x, unsigned long xlen) {
+TARGET_CLONES static int seedexpander(unsigned char *x, unsigned long xlen) {
     /*
      * Note: Since with Round2 only up to 2*d*d random bytes are ever requested
      * from the same seed, we do not need to check whether or not we have
@@ -189,6 +189,25 @@ int init_drng(const unsigned char *seed, const uint8_t seed_size) {
     return 0;
 }
 
+int drng_seek(const unsigned long position) {
+    const unsigned long block = position / 16;
+
+    /* Block b of the stream is the encryption of counter b */
+    seed_expander_ctx.ctr[12] = (unsigned char) (block >> 24);
+    seed_expander_ctx.ctr[13] = (unsigned char) (block >> 16);
+    seed_expander_ctx.ctr[14] = (unsigned char) (block >> 8);
+    seed_expander_ctx.ctr[15] = (unsigned char) block;
+    seed_expander_ctx.buffer_pos = 16;
+
+    /* Skip the bytes of the block before the position */
+    if (position % 16) {
+        unsigned char skipped[16];
+        seedexpander(skipped, position % 16);
+    }
+
+    return 0;
+}
+
 /**
  * Generates a number of deterministic random bytes.
  * @param[out] x    the buffer in which to place the deterministic random bytes
@@ -196,7 +215,11 @@ int init_drng(const unsigned char *seed, const uint8_t seed_size) {
  * @return __0__ upon success
  */
 int drng(unsigned char *x, const unsigned long xlen) {
+    ROUND2_STATS_START(stats_start);
+
     seedexpander(x, (unsigned long) xlen);
 
+    ROUND2_STATS_STOP(ROUND2_STATS_DRNG, stats_start, xlen);
+
     return 0;
 }
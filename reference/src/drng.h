@@ -54,6 +54,17 @@ extern "C" {
      */
     int init_drng(const unsigned char *seed, const uint8_t seed_size);
 
+    /**
+     * Sets the position within the sequence of deterministic random bytes of
+     * the current seed, from where the next bytes are generated. The
+     * sequence is generated in counter mode, so its parts can be generated
+     * independently, e.g. by several threads (each with its own generator).
+     *
+     * @param[in] position the position, in bytes from the start of the sequence
+     * @return __0__ in case of success
+     */
+    int drng_seek(const unsigned long position);
+
     /**
      * Generates a sequence of deterministic random bytes.
      *
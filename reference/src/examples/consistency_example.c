@@ -0,0 +1,533 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Example consistency check application, shows that the incremental
+ * (streamed), multi-session and thread pool versions of the functions give
+ * the same results as the one-shot functions, for every parameter set and
+ * variant for the creation of A.
+ *
+ * The encryptions with a given seed of R are compared ciphertext by
+ * ciphertext. The KEM encapsulations draw their own randomness, so those
+ * are compared through the shared secrets of the one-shot de-capsulation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+
+#include "pst_api.h"
+#include "pst_core.h"
+#include "pst_encrypt.h"
+#include "cpa_kem.h"
+#include "cca_kem.h"
+#include "misc.h"
+#include "parameters.h"
+#include "randombytes.h"
+
+#ifdef PST_CORE_PARALLEL
+#include <pthread.h>
+#include "pst_parallel.h"
+#endif
+
+/**
+ * The number of sessions of the multi-session functions: more than the 16
+ * sessions that are interleaved at a time, and not a multiple of 8.
+ */
+#define NR_SESSIONS 19
+
+/**
+ * The number of distinct key pairs of the multi-session functions, the
+ * sessions use them in turn (key generation dominates the running time for
+ * the non-ring parameter sets).
+ */
+#define NR_KEYS 3
+
+/** The number of threads of the thread pool (including the caller) */
+#define POOL_THREADS 4
+
+/** The lengths of the consecutive parts in which keys and ciphertexts are fed */
+static const size_t part_lengths[] = {1, 3, 16, 61, 509};
+
+/**
+ * Determines the length of a part of an incremental key or ciphertext.
+ *
+ * @param[in] part      the number of the part
+ * @param[in] remaining the number of bytes not fed yet
+ * @return the length of the part
+ */
+static size_t part_length(const size_t part, const size_t remaining) {
+    const size_t length = part_lengths[part % (sizeof (part_lengths) / sizeof (part_lengths[0]))];
+
+    return length < remaining ? length : remaining;
+}
+
+/**
+ * Reports the result of a comparison on `stdout` if it failed.
+ *
+ * @param[in] set  the parameter set
+ * @param[in] fn   the variant for the generation of A
+ * @param[in] what the compared function
+ * @param[in] ok   whether the results were the same
+ * @return __0__ if the results were the same, __1__ otherwise
+ */
+static unsigned int report(const size_t set, const uint8_t fn, const char *what, const int ok) {
+    if (!ok) {
+        printf("set %2lu fn %u: %s differs from the one-shot function\n", (unsigned long) set, (unsigned) fn, what);
+    }
+
+    return !ok;
+}
+
+/**
+ * Compares the incremental and multi-session encryptions and decryptions
+ * with `encrypt_rho()` and `decrypt()`.
+ *
+ * @param[in] set    the parameter set
+ * @param[in] params the algorithm parameters to use
+ * @param[in] fn     the variant for the generation of A
+ * @return the number of differences
+ */
+static unsigned int check_encrypt(const size_t set, const parameters *params, const uint8_t fn) {
+    unsigned char *pk = checked_malloc((size_t) params->pk_size * NR_SESSIONS);
+    unsigned char *sk = checked_malloc((size_t) params->sk_size * NR_SESSIONS);
+    unsigned char *m = checked_malloc((size_t) params->ss_size * NR_SESSIONS);
+    unsigned char *rho = checked_malloc((size_t) params->ss_size * NR_SESSIONS);
+    unsigned char *c = checked_malloc((size_t) params->ct_size * NR_SESSIONS);
+    unsigned char *c_test = checked_malloc((size_t) params->ct_size * NR_SESSIONS);
+    unsigned char *m_dec = checked_malloc((size_t) params->ss_size * NR_SESSIONS);
+    unsigned char *m_test = checked_malloc((size_t) params->ss_size * NR_SESSIONS);
+    encrypt_ctx *enc;
+    decrypt_ctx *dec;
+    unsigned int failed = 0;
+    int error = 0;
+    size_t s, offset, part;
+
+    /* The one-shot functions, with NR_KEYS key pairs used in turn */
+    randombytes(m, (unsigned long long) params->ss_size * NR_SESSIONS);
+    randombytes(rho, (unsigned long long) params->ss_size * NR_SESSIONS);
+    for (s = 0; s < NR_SESSIONS; ++s) {
+        if (s < NR_KEYS) {
+            generate_keypair(pk + s * params->pk_size, sk + s * params->sk_size, params, fn);
+        } else {
+            memcpy(pk + s * params->pk_size, pk + (s % NR_KEYS) * params->pk_size, params->pk_size);
+            memcpy(sk + s * params->sk_size, sk + (s % NR_KEYS) * params->sk_size, params->sk_size);
+        }
+        encrypt_rho(c + s * params->ct_size, m + s * params->ss_size, rho + s * params->ss_size, pk + s * params->pk_size, params);
+        decrypt(m_dec + s * params->ss_size, c + s * params->ct_size, sk + s * params->sk_size, params);
+    }
+    failed += report(set, fn, "decrypt (round trip)", memcmp(m_dec, m, (size_t) params->ss_size * NR_SESSIONS) == 0);
+
+    /* Incremental */
+    enc = encrypt_init(rho, params);
+    for (offset = 0, part = 0; offset < params->pk_size; offset += part_length(part++, params->pk_size - offset)) {
+        error |= encrypt_feed(enc, pk + offset, part_length(part, params->pk_size - offset));
+    }
+    error |= encrypt_finish(c_test, m, enc);
+    failed += report(set, fn, "encrypt_feed", !error && memcmp(c_test, c, params->ct_size) == 0);
+    dec = decrypt_init(sk, params);
+    for (offset = 0, part = 0; offset < params->ct_size; offset += part_length(part++, params->ct_size - offset)) {
+        error |= decrypt_feed(dec, c + offset, part_length(part, params->ct_size - offset));
+    }
+    error |= decrypt_finish(m_test, dec);
+    failed += report(set, fn, "decrypt_feed", !error && memcmp(m_test, m_dec, params->ss_size) == 0);
+
+    /* Multi-session */
+    encrypt_rho_multi(c_test, params->ct_size, m, rho, pk, NR_SESSIONS, params);
+    failed += report(set, fn, "encrypt_rho_multi", memcmp(c_test, c, (size_t) params->ct_size * NR_SESSIONS) == 0);
+    decrypt_multi(m_test, c, params->ct_size, sk, params->sk_size, NR_SESSIONS, params);
+    failed += report(set, fn, "decrypt_multi", memcmp(m_test, m_dec, (size_t) params->ss_size * NR_SESSIONS) == 0);
+
+    /* Multi-session with a single key: the ciphertexts for the first key */
+    for (s = 0; s < NR_SESSIONS; ++s) {
+        encrypt_rho(c + s * params->ct_size, m + s * params->ss_size, rho + s * params->ss_size, pk, params);
+        decrypt(m_dec + s * params->ss_size, c + s * params->ct_size, sk, params);
+    }
+    decrypt_multi(m_test, c, params->ct_size, sk, 0, NR_SESSIONS, params);
+    failed += report(set, fn, "decrypt_multi (single key)", memcmp(m_test, m_dec, (size_t) params->ss_size * NR_SESSIONS) == 0);
+
+    free(pk);
+    free(sk);
+    free(m);
+    free(rho);
+    free(c);
+    free(c_test);
+    free(m_dec);
+    free(m_test);
+
+    return failed;
+}
+
+/**
+ * Compares the incremental and multi-session CPA KEM functions with
+ * `crypto_kem_dec_p()`.
+ *
+ * @param[in] set    the parameter set
+ * @param[in] params the algorithm parameters to use
+ * @param[in] fn     the variant for the generation of A
+ * @return the number of differences
+ */
+static unsigned int check_cpa_kem(const size_t set, const parameters *params, const uint8_t fn) {
+    unsigned char *pk = checked_malloc((size_t) params->pk_size * NR_SESSIONS);
+    unsigned char *sk = checked_malloc((size_t) params->sk_size * NR_SESSIONS);
+    unsigned char *c = checked_malloc((size_t) params->ct_size * NR_SESSIONS);
+    unsigned char *K = checked_malloc((size_t) params->ss_size * NR_SESSIONS);
+    unsigned char *K_dec = checked_malloc((size_t) params->ss_size * NR_SESSIONS);
+    unsigned char *K_test = checked_malloc((size_t) params->ss_size * NR_SESSIONS);
+    cpa_kem_enc_ctx *enc;
+    cpa_kem_dec_ctx *dec;
+    unsigned int failed = 0;
+    int error = 0;
+    size_t s, offset, part;
+
+    for (s = 0; s < NR_SESSIONS; ++s) {
+        if (s < NR_KEYS) {
+            crypto_kem_keypair_p(pk + s * params->pk_size, sk + s * params->sk_size, params, fn);
+        } else {
+            memcpy(pk + s * params->pk_size, pk + (s % NR_KEYS) * params->pk_size, params->pk_size);
+            memcpy(sk + s * params->sk_size, sk + (s % NR_KEYS) * params->sk_size, params->sk_size);
+        }
+    }
+
+    /* Incremental */
+    enc = crypto_kem_enc_init_p(params);
+    for (offset = 0, part = 0; offset < params->pk_size; offset += part_length(part++, params->pk_size - offset)) {
+        error |= crypto_kem_enc_feed(enc, pk + offset, part_length(part, params->pk_size - offset));
+    }
+    error |= crypto_kem_enc_finish(c, K, enc);
+    crypto_kem_dec_p(K_dec, c, sk, params);
+    failed += report(set, fn, "crypto_kem_enc_feed", !error && memcmp(K_dec, K, params->ss_size) == 0);
+    dec = crypto_kem_dec_init_p(sk, params);
+    for (offset = 0, part = 0; offset < params->ct_size; offset += part_length(part++, params->ct_size - offset)) {
+        error |= crypto_kem_dec_feed(dec, c + offset, part_length(part, params->ct_size - offset));
+    }
+    error |= crypto_kem_dec_finish(K_test, dec);
+    failed += report(set, fn, "crypto_kem_dec_feed", !error && memcmp(K_test, K_dec, params->ss_size) == 0);
+
+    /* Multi-session */
+    crypto_kem_enc_multi_p(c, K, pk, NR_SESSIONS, params);
+    for (s = 0; s < NR_SESSIONS; ++s) {
+        crypto_kem_dec_p(K_dec + s * params->ss_size, c + s * params->ct_size, sk + s * params->sk_size, params);
+    }
+    failed += report(set, fn, "crypto_kem_enc_multi_p", memcmp(K_dec, K, (size_t) params->ss_size * NR_SESSIONS) == 0);
+    crypto_kem_dec_multi_p(K_test, c, sk, NR_SESSIONS, params);
+    failed += report(set, fn, "crypto_kem_dec_multi_p", memcmp(K_test, K_dec, (size_t) params->ss_size * NR_SESSIONS) == 0);
+    for (s = 0; s < NR_SESSIONS; ++s) {
+        crypto_kem_enc_p(c + s * params->ct_size, K + s * params->ss_size, pk, params);
+        crypto_kem_dec_p(K_dec + s * params->ss_size, c + s * params->ct_size, sk, params);
+    }
+    crypto_kem_dec_multi_single_key_p(K_test, c, sk, NR_SESSIONS, params);
+    failed += report(set, fn, "crypto_kem_dec_multi_single_key_p", memcmp(K_test, K_dec, (size_t) params->ss_size * NR_SESSIONS) == 0);
+
+    free(pk);
+    free(sk);
+    free(c);
+    free(K);
+    free(K_dec);
+    free(K_test);
+
+    return failed;
+}
+
+/**
+ * Compares the incremental and multi-session CCA KEM functions with
+ * `crypto_cca_kem_dec_p()`.
+ *
+ * @param[in] set    the parameter set
+ * @param[in] params the algorithm parameters to use
+ * @param[in] fn     the variant for the generation of A
+ * @return the number of differences
+ */
+static unsigned int check_cca_kem(const size_t set, const parameters *params, const uint8_t fn) {
+    const size_t sk_size = (size_t) (params->sk_size + params->ss_size + params->pk_size);
+    const size_t ct_size = (size_t) (params->ct_size + params->ss_size);
+    unsigned char *pk = checked_malloc((size_t) params->pk_size * NR_SESSIONS);
+    unsigned char *sk = checked_malloc(sk_size * NR_SESSIONS);
+    unsigned char *c = checked_malloc(ct_size * NR_SESSIONS);
+    unsigned char *K = checked_malloc((size_t) params->ss_size * NR_SESSIONS);
+    unsigned char *K_dec = checked_malloc((size_t) params->ss_size * NR_SESSIONS);
+    unsigned char *K_test = checked_malloc((size_t) params->ss_size * NR_SESSIONS);
+    cca_kem_dec_ctx *dec;
+    unsigned int failed = 0;
+    int error = 0;
+    size_t s, offset, part;
+
+    for (s = 0; s < NR_SESSIONS; ++s) {
+        if (s < NR_KEYS) {
+            crypto_cca_kem_keypair_p(pk + s * params->pk_size, sk + s * sk_size, params, fn);
+        } else {
+            memcpy(pk + s * params->pk_size, pk + (s % NR_KEYS) * params->pk_size, params->pk_size);
+            memcpy(sk + s * sk_size, sk + (s % NR_KEYS) * sk_size, sk_size);
+        }
+    }
+
+    /* Multi-session */
+    crypto_cca_kem_enc_multi_p(c, K, pk, NR_SESSIONS, params);
+    for (s = 0; s < NR_SESSIONS; ++s) {
+        crypto_cca_kem_dec_p(K_dec + s * params->ss_size, c + s * ct_size, sk + s * sk_size, params);
+    }
+    failed += report(set, fn, "crypto_cca_kem_enc_multi_p", memcmp(K_dec, K, (size_t) params->ss_size * NR_SESSIONS) == 0);
+    crypto_cca_kem_dec_multi_p(K_test, c, sk, NR_SESSIONS, params);
+    failed += report(set, fn, "crypto_cca_kem_dec_multi_p", memcmp(K_test, K_dec, (size_t) params->ss_size * NR_SESSIONS) == 0);
+
+    /* Incremental */
+    dec = crypto_cca_kem_dec_init_p(sk, params);
+    for (offset = 0, part = 0; offset < ct_size; offset += part_length(part++, ct_size - offset)) {
+        error |= crypto_cca_kem_dec_feed(dec, c + offset, part_length(part, ct_size - offset));
+    }
+    error |= crypto_cca_kem_dec_finish(K_test, dec);
+    failed += report(set, fn, "crypto_cca_kem_dec_feed", !error && memcmp(K_test, K_dec, params->ss_size) == 0);
+
+    /* Multi-session with a single key */
+    for (s = 0; s < NR_SESSIONS; ++s) {
+        crypto_cca_kem_enc_p(c + s * ct_size, K + s * params->ss_size, pk, params);
+        crypto_cca_kem_dec_p(K_dec + s * params->ss_size, c + s * ct_size, sk, params);
+    }
+    crypto_cca_kem_dec_multi_single_key_p(K_test, c, sk, NR_SESSIONS, params);
+    failed += report(set, fn, "crypto_cca_kem_dec_multi_single_key_p", memcmp(K_test, K_dec, (size_t) params->ss_size * NR_SESSIONS) == 0);
+
+    free(pk);
+    free(sk);
+    free(c);
+    free(K);
+    free(K_dec);
+    free(K_test);
+
+    return failed;
+}
+
+#ifdef PST_CORE_PARALLEL
+
+/**
+ * A computation run on the threads of the pool.
+ */
+typedef struct {
+    pst_parallel_task task; /**< Computes a part of the computation */
+    void *context; /**< The computation */
+    size_t nr_parts; /**< The number of parts of the computation */
+    size_t next_part; /**< The next part to compute (accessed atomically) */
+} pool_computation;
+
+/**
+ * Computes parts of a computation until all have been claimed.
+ *
+ * @param[in,out] arg the computation (`pool_computation`)
+ * @return `NULL`
+ */
+static void *compute_parts(void *arg) {
+    pool_computation *computation = arg;
+    size_t part;
+
+    while ((part = __atomic_fetch_add(&computation->next_part, 1, __ATOMIC_RELAXED)) < computation->nr_parts) {
+        computation->task(part, computation->context);
+    }
+
+    return NULL;
+}
+
+/**
+ * Runs a computation on `POOL_THREADS` threads (see `pst_thread_pool_run`):
+ * the caller and threads started for the computation.
+ *
+ * @param[in,out] pool      not used
+ * @param[in]     nr_parts  the number of parts
+ * @param[in]     task      computes a part
+ * @param[in,out] context   the computation, passed to _task_
+ */
+static void run_on_threads(void *pool, const size_t nr_parts, pst_parallel_task task, void *context) {
+    pool_computation computation;
+    pthread_t threads[POOL_THREADS - 1];
+    size_t i;
+
+    (void) pool;
+    computation.task = task;
+    computation.context = context;
+    computation.nr_parts = nr_parts;
+    computation.next_part = 0;
+    for (i = 0; i < POOL_THREADS - 1; ++i) {
+        if (pthread_create(&threads[i], NULL, compute_parts, &computation)) {
+            fprintf(stderr, "Could not create thread %lu\n", (unsigned long) i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    compute_parts(&computation);
+    for (i = 0; i < POOL_THREADS - 1; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/**
+ * Compares the key generation, encryption and decryption on a thread pool
+ * with those without.
+ *
+ * @param[in] set    the parameter set
+ * @param[in] params the algorithm parameters to use
+ * @param[in] fn     the variant for the generation of A
+ * @return the number of differences
+ */
+static unsigned int check_pool(const size_t set, const parameters *params, const uint8_t fn) {
+    unsigned char *pk = checked_malloc(params->pk_size);
+    unsigned char *sk = checked_malloc(params->sk_size);
+    unsigned char *m = checked_malloc(params->ss_size);
+    unsigned char *rho = checked_malloc(params->ss_size);
+    unsigned char *c = checked_malloc(params->ct_size);
+    unsigned char *c_pool = checked_malloc(params->ct_size);
+    unsigned char *m_dec = checked_malloc(params->ss_size);
+    unsigned char *m_pool = checked_malloc(params->ss_size);
+    unsigned int failed = 0;
+
+    randombytes(m, params->ss_size);
+    randombytes(rho, params->ss_size);
+
+    /* The key pair generated on the pool must work without it */
+    pst_parallel_set_pool(run_on_threads, NULL, POOL_THREADS);
+    generate_keypair(pk, sk, params, fn);
+    encrypt_rho(c_pool, m, rho, pk, params);
+    decrypt(m_pool, c_pool, sk, params);
+    pst_parallel_set_pool(NULL, NULL, 0);
+    encrypt_rho(c, m, rho, pk, params);
+    decrypt(m_dec, c, sk, params);
+
+    failed += report(set, fn, "generate_keypair (thread pool)", memcmp(m_dec, m, params->ss_size) == 0);
+    failed += report(set, fn, "encrypt_rho (thread pool)", memcmp(c_pool, c, params->ct_size) == 0);
+    failed += report(set, fn, "decrypt (thread pool)", memcmp(m_pool, m_dec, params->ss_size) == 0);
+
+    free(pk);
+    free(sk);
+    free(m);
+    free(rho);
+    free(c);
+    free(c_pool);
+    free(m_dec);
+    free(m_pool);
+
+    return failed;
+}
+
+#endif
+
+/**
+ * Runs all comparisons for a parameter set and variant for the generation
+ * of A.
+ *
+ * @param[in] set the parameter set
+ * @param[in] fn  the variant for the generation of A
+ * @return the number of differences
+ */
+static unsigned int check_set(const size_t set, const uint8_t fn) {
+    const parameters *params = get_parameter_set(set);
+    unsigned int failed = 0;
+
+    if (params == NULL) {
+        printf("set %2lu: invalid parameter set\n", (unsigned long) set);
+        return 1;
+    }
+    if (fn == 1) {
+        unsigned char *seed = checked_malloc(params->ss_size);
+        randombytes(seed, params->ss_size);
+        create_A_fixed(seed, params->ss_size, params);
+        free(seed);
+    }
+
+    failed += check_encrypt(set, params, fn);
+    failed += check_cpa_kem(set, params, fn);
+    failed += check_cca_kem(set, params, fn);
+#ifdef PST_CORE_PARALLEL
+    failed += check_pool(set, params, fn);
+#endif
+    printf("set %2lu fn %u (d=%u, n=%u): %s\n", (unsigned long) set, (unsigned) fn, (unsigned) params->d, (unsigned) params->n, failed ? "NOT OK" : "OK");
+
+    return failed;
+}
+
+/**
+ * Main program, compares the incremental, multi-session and thread pool
+ * functions with the one-shot functions for all parameter sets (from
+ * `api_to_internal_parameters.h`) and, for the non-ring sets, all variants
+ * for the creation of matrix A, or for the ones specified.
+ *
+ * @param argc the number of command-line arguments (including the executable itself)
+ * @param argv the command-line arguments
+ * @return __0__ if all results were the same
+ */
+int main(int argc, char **argv) {
+    const long nr_sets = (long) nr_parameter_sets();
+    long number, first_set = 0, last_set = nr_sets - 1;
+    int first_fn = 0, last_fn = 2;
+    unsigned int failed = 0;
+    int ch, fn;
+    long set;
+
+    while ((ch = getopt(argc, argv, "a:f:")) != -1) {
+        switch (ch) {
+            case 'a':
+                number = strtol(optarg, NULL, 10);
+                if (number < 0 || number >= nr_sets) {
+                    fprintf(stderr, "%s Invalid api set number specified: %s, must be less than %ld\n", argv[0], optarg, nr_sets);
+                    exit(EXIT_FAILURE);
+                }
+                first_set = last_set = number;
+                break;
+            case 'f':
+                number = strtol(optarg, NULL, 10);
+                if (number < 0 || number > 2) {
+                    fprintf(stderr, "%s Invalid fn specified: %s, must be 0, 1, or 2\n", argv[0], optarg);
+                    exit(EXIT_FAILURE);
+                }
+                first_fn = last_fn = (int) number;
+                break;
+            default:
+                fprintf(stderr, "%s: unknown option %s\n", argv[0], optarg);
+                exit(EXIT_FAILURE);
+        }
+    }
+    argc -= optind;
+    if (argc > 0) {
+        fprintf(stderr, "Usage: %s [-a N] [-f N]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    for (set = first_set; set <= last_set; ++set) {
+        const parameters *params = get_parameter_set((size_t) set);
+        for (fn = first_fn; fn <= last_fn; ++fn) {
+            /* The variant for the creation of A only matters for the non-ring sets */
+            if (params != NULL && params->n != 1 && fn != first_fn) {
+                break;
+            }
+            failed += check_set((size_t) set, (uint8_t) fn);
+        }
+    }
+    printf("\n%s\n", failed ? "Differences found" : "All results are the same");
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
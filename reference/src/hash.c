@@ -31,18 +31,65 @@
 #include "hash.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <libkeccak.a.headers/SimpleFIPS202.h>
+#include <libkeccak.a.headers/KeccakHash.h>
+
+#include "misc.h"
+#include "round2_stats.h"
 
 #define H_BYTES 64 /* Using SHA3_512 */
 
+/**
+ * The state of an incremental hash.
+ */
+struct hash_ctx {
+    Keccak_HashInstance instance; /**< The Keccak sponge */
+};
+
 int hash(unsigned char *output, const unsigned char *input, const size_t input_byte_len, const size_t output_byte_len) {
     unsigned char output_hash[H_BYTES];
     int err;
+    ROUND2_STATS_START(stats_start);
 
     err = SHA3_512(output_hash, input, input_byte_len);
 
     memcpy(output, output_hash, output_byte_len);
 
+    ROUND2_STATS_STOP(ROUND2_STATS_HASH, stats_start, input_byte_len);
+
     return err;
 }
 
+hash_ctx *hash_init(void) {
+    hash_ctx *ctx = checked_malloc(sizeof (*ctx));
+
+    Keccak_HashInitialize_SHA3_512(&ctx->instance);
+
+    return ctx;
+}
+
+int hash_update(hash_ctx *ctx, const unsigned char *input, const size_t input_byte_len) {
+    int err;
+    ROUND2_STATS_START(stats_start);
+
+    err = Keccak_HashUpdate(&ctx->instance, input, input_byte_len * 8) != SUCCESS;
+
+    ROUND2_STATS_STOP(ROUND2_STATS_HASH, stats_start, input_byte_len);
+
+    return err;
+}
+
+int hash_final(unsigned char *output, hash_ctx *ctx, const size_t output_byte_len) {
+    unsigned char output_hash[H_BYTES];
+    int err;
+
+    err = Keccak_HashFinal(&ctx->instance, output_hash) != SUCCESS;
+    memcpy(output, output_hash, output_byte_len);
+
+    memset(ctx, 0, sizeof (*ctx));
+    free(ctx);
+
+    return err;
+}
@@ -55,6 +55,40 @@ extern "C" {
      */
     int hash(unsigned char *output, const unsigned char *input, const size_t input_byte_len, const size_t output_byte_len);
 
+    /**
+     * The state of an incremental hash (opaque).
+     */
+    typedef struct hash_ctx hash_ctx;
+
+    /**
+     * Starts an incremental hash, the input is passed in parts to
+     * `hash_update()`, `hash_final()` produces the same output as `hash()`
+     * on the complete input.
+     *
+     * @return the state of the hash
+     */
+    hash_ctx *hash_init(void);
+
+    /**
+     * Absorbs the next part of the input into an incremental hash.
+     *
+     * @param ctx the state of the hash
+     * @param input the next part of the input
+     * @param input_byte_len the length of the part
+     * @return __0__ in case of success
+     */
+    int hash_update(hash_ctx *ctx, const unsigned char *input, const size_t input_byte_len);
+
+    /**
+     * Finishes an incremental hash and releases its state.
+     *
+     * @param output the hashed output
+     * @param ctx the state of the hash
+     * @param output_byte_len the length of the output of the hash
+     * @return __0__ in case of success
+     */
+    int hash_final(unsigned char *output, hash_ctx *ctx, const size_t output_byte_len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the HDR histogram functions.
+ *
+ * The layout follows G. Tene's HdrHistogram: the counts array holds a first
+ * bucket of `sub_bucket_count` entries (values below `sub_bucket_count` units)
+ * followed by buckets of `sub_bucket_count / 2` entries, each covering the
+ * upper half of the next power of two (the lower half being covered by the
+ * buckets before it).
+ *
+ * @endcond
+ */
+
+#include "hdr_histogram.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "misc.h"
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/**
+ * The state of an HDR histogram.
+ */
+struct hdr_histogram {
+    uint64_t lowest; /**< The lowest value that can be distinguished from 0 */
+    uint64_t highest; /**< The highest value that can be recorded */
+    unsigned int unit_magnitude; /**< log2 of the value of one unit (the resolution of the first bucket) */
+    unsigned int sub_bucket_half_count_magnitude; /**< log2 of the number of sub-buckets per bucket (after the first) */
+    uint64_t sub_bucket_count; /**< The number of sub-buckets of the first bucket */
+    uint64_t sub_bucket_half_count; /**< The number of sub-buckets of the other buckets */
+    uint64_t sub_bucket_mask; /**< The mask of the values falling in the first bucket */
+    size_t counts_len; /**< The length of the counts array */
+    uint64_t total_count; /**< The number of recorded values (accessed atomically) */
+    uint64_t min; /**< The lowest recorded value (accessed atomically) */
+    uint64_t max; /**< The highest recorded value (accessed atomically) */
+    uint64_t *counts; /**< The number of recorded values per sub-bucket (accessed atomically) */
+};
+
+/**
+ * Determines the index into the counts array of a value.
+ *
+ * @param[in] h     the histogram
+ * @param[in] value the value (at most the highest trackable value)
+ * @return the index of the value's sub-bucket
+ */
+static size_t counts_index(const hdr_histogram *h, const uint64_t value) {
+    const unsigned int pow2_ceiling = 64 - (unsigned int) __builtin_clzll(value | h->sub_bucket_mask);
+    const unsigned int bucket_index = pow2_ceiling - h->unit_magnitude - (h->sub_bucket_half_count_magnitude + 1);
+    const uint64_t sub_bucket_index = value >> (bucket_index + h->unit_magnitude);
+
+    return (size_t) (((uint64_t) (bucket_index + 1) << h->sub_bucket_half_count_magnitude) + sub_bucket_index - h->sub_bucket_half_count);
+}
+
+/**
+ * Determines the lowest value of a sub-bucket.
+ *
+ * @param[in] h     the histogram
+ * @param[in] index the index of the sub-bucket in the counts array
+ * @return the lowest value of the sub-bucket
+ */
+static uint64_t value_from_index(const hdr_histogram *h, const size_t index) {
+    unsigned int bucket_index = (unsigned int) (index >> h->sub_bucket_half_count_magnitude);
+    uint64_t sub_bucket_index = (index & (h->sub_bucket_half_count - 1)) + h->sub_bucket_half_count;
+
+    if (bucket_index == 0) {
+        sub_bucket_index -= h->sub_bucket_half_count;
+    } else {
+        --bucket_index;
+    }
+    return sub_bucket_index << (bucket_index + h->unit_magnitude);
+}
+
+/**
+ * Determines the highest value of a sub-bucket, i.e. the highest value
+ * equivalent to its lowest value at the precision of the histogram.
+ *
+ * @param[in] h     the histogram
+ * @param[in] index the index of the sub-bucket in the counts array
+ * @return the highest value of the sub-bucket
+ */
+static uint64_t highest_value_from_index(const hdr_histogram *h, const size_t index) {
+    const unsigned int bucket_index = index < h->sub_bucket_count ? 0 : (unsigned int) (index >> h->sub_bucket_half_count_magnitude) - 1;
+
+    return value_from_index(h, index) + (((uint64_t) 1 << (bucket_index + h->unit_magnitude)) - 1);
+}
+
+/**
+ * Determines the value representing a sub-bucket in the mean and standard
+ * deviation: the middle of the sub-bucket.
+ *
+ * @param[in] h     the histogram
+ * @param[in] index the index of the sub-bucket in the counts array
+ * @return the middle value of the sub-bucket
+ */
+static double middle_value_from_index(const hdr_histogram *h, const size_t index) {
+    return ((double) value_from_index(h, index) + (double) highest_value_from_index(h, index)) / 2.0;
+}
+
+/**
+ * Records a number of occurrences of a value.
+ *
+ * @param[in] h     the histogram
+ * @param[in] value the value
+ * @param[in] count the number of occurrences
+ * @return __0__ if the value was in range, __1__ if it had to be clamped
+ */
+static int record_values(hdr_histogram *h, uint64_t value, const uint64_t count) {
+    const int clamped = value > h->highest;
+    uint64_t current;
+
+    if (clamped) {
+        value = h->highest;
+    }
+    __atomic_fetch_add(&h->counts[counts_index(h, value)], count, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total_count, count, __ATOMIC_RELAXED);
+    current = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+    while (value < current && !__atomic_compare_exchange_n(&h->min, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    current = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (value > current && !__atomic_compare_exchange_n(&h->max, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+
+    return clamped;
+}
+
+/**
+ * Prints a value divided by a scale, as an integer when not scaled.
+ *
+ * @param[in] out   the stream to print to
+ * @param[in] value the value
+ * @param[in] scale the divisor of the value
+ */
+static void print_scaled(FILE *out, const double value, const double scale) {
+    if (scale == 1.0) {
+        fprintf(out, "%.0f", value);
+    } else {
+        fprintf(out, "%.3f", value / scale);
+    }
+}
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+hdr_histogram *hdr_create(const uint64_t lowest, const uint64_t highest, const unsigned int significant_figures) {
+    hdr_histogram *h;
+    uint64_t single_unit_range, smallest_untrackable;
+    unsigned int sub_bucket_count_magnitude = 0, unit_magnitude = 0, bucket_count = 1, i;
+
+    if (lowest < 1 || highest < 2 * lowest || significant_figures < 1 || significant_figures > 5) {
+        return NULL;
+    }
+
+    /* The sub-buckets must distinguish values at the requested precision */
+    single_unit_range = 2;
+    for (i = 0; i < significant_figures; ++i) {
+        single_unit_range *= 10;
+    }
+    while (((uint64_t) 1 << sub_bucket_count_magnitude) < single_unit_range) {
+        ++sub_bucket_count_magnitude;
+    }
+    while (((uint64_t) 2 << unit_magnitude) <= lowest) {
+        ++unit_magnitude;
+    }
+    if (unit_magnitude + sub_bucket_count_magnitude > 62) {
+        return NULL;
+    }
+
+    h = checked_calloc(1, sizeof (*h));
+    h->lowest = lowest;
+    h->highest = highest;
+    h->unit_magnitude = unit_magnitude;
+    h->sub_bucket_half_count_magnitude = sub_bucket_count_magnitude - 1;
+    h->sub_bucket_count = (uint64_t) 1 << sub_bucket_count_magnitude;
+    h->sub_bucket_half_count = h->sub_bucket_count / 2;
+    h->sub_bucket_mask = (h->sub_bucket_count - 1) << unit_magnitude;
+
+    /* Add buckets until the highest value can be recorded */
+    smallest_untrackable = h->sub_bucket_count << unit_magnitude;
+    while (smallest_untrackable <= highest) {
+        ++bucket_count;
+        if (smallest_untrackable > UINT64_MAX / 2) {
+            break;
+        }
+        smallest_untrackable <<= 1;
+    }
+    h->counts_len = (size_t) (bucket_count + 1) * (size_t) h->sub_bucket_half_count;
+    h->counts = checked_calloc(h->counts_len, sizeof (*h->counts));
+    h->min = UINT64_MAX;
+
+    return h;
+}
+
+void hdr_destroy(hdr_histogram *histogram) {
+    if (histogram != NULL) {
+        free(histogram->counts);
+        free(histogram);
+    }
+}
+
+int hdr_record(hdr_histogram *histogram, const uint64_t value) {
+    return record_values(histogram, value, 1);
+}
+
+void hdr_add(hdr_histogram *to, const hdr_histogram *from) {
+    size_t i;
+
+    for (i = 0; i < from->counts_len; ++i) {
+        if (from->counts[i] != 0) {
+            uint64_t value = value_from_index(from, i);
+            /* Keep the recorded extremes exact */
+            if (value < from->min) {
+                value = from->min;
+            } else if (highest_value_from_index(from, i) >= from->max) {
+                value = from->max;
+            }
+            record_values(to, value, from->counts[i]);
+        }
+    }
+}
+
+void hdr_reset(hdr_histogram *histogram) {
+    memset(histogram->counts, 0, histogram->counts_len * sizeof (*histogram->counts));
+    histogram->total_count = 0;
+    histogram->min = UINT64_MAX;
+    histogram->max = 0;
+}
+
+uint64_t hdr_trim(hdr_histogram *histogram, const uint64_t low, const uint64_t high) {
+    const size_t first = counts_index(histogram, low < histogram->highest ? low : histogram->highest);
+    const size_t last = counts_index(histogram, high < histogram->highest ? high : histogram->highest);
+    uint64_t removed = 0;
+    size_t i;
+
+    if (low > high || histogram->total_count == 0) {
+        removed = histogram->total_count;
+        hdr_reset(histogram);
+        return removed;
+    }
+    for (i = 0; i < histogram->counts_len; ++i) {
+        if (i < first || i > last) {
+            removed += histogram->counts[i];
+            histogram->counts[i] = 0;
+        }
+    }
+    histogram->total_count -= removed;
+    if (histogram->total_count == 0) {
+        hdr_reset(histogram);
+        return removed;
+    }
+
+    /* The new extremes are only known at the precision of the histogram */
+    if (histogram->min < low) {
+        for (i = first; histogram->counts[i] == 0; ++i) {
+        }
+        histogram->min = value_from_index(histogram, i) > low ? value_from_index(histogram, i) : low;
+    }
+    if (histogram->max > high) {
+        for (i = last; histogram->counts[i] == 0; --i) {
+        }
+        histogram->max = highest_value_from_index(histogram, i) < high ? highest_value_from_index(histogram, i) : high;
+    }
+
+    return removed;
+}
+
+uint64_t hdr_count(const hdr_histogram *histogram) {
+    return histogram->total_count;
+}
+
+uint64_t hdr_min(const hdr_histogram *histogram) {
+    return histogram->total_count == 0 ? 0 : histogram->min;
+}
+
+uint64_t hdr_max(const hdr_histogram *histogram) {
+    return histogram->max;
+}
+
+double hdr_mean(const hdr_histogram *histogram) {
+    double sum = 0;
+    size_t i;
+
+    if (histogram->total_count == 0) {
+        return 0;
+    }
+    for (i = 0; i < histogram->counts_len; ++i) {
+        if (histogram->counts[i] != 0) {
+            sum += (double) histogram->counts[i] * middle_value_from_index(histogram, i);
+        }
+    }
+    return sum / (double) histogram->total_count;
+}
+
+double hdr_stddev(const hdr_histogram *histogram) {
+    const double mean = hdr_mean(histogram);
+    double sum = 0;
+    size_t i;
+
+    if (histogram->total_count == 0) {
+        return 0;
+    }
+    for (i = 0; i < histogram->counts_len; ++i) {
+        if (histogram->counts[i] != 0) {
+            const double diff = middle_value_from_index(histogram, i) - mean;
+            sum += (double) histogram->counts[i] * diff * diff;
+        }
+    }
+    return sqrt(sum / (double) histogram->total_count);
+}
+
+uint64_t hdr_value_at_percentile(const hdr_histogram *histogram, const double percentile) {
+    const double p = percentile < 0 ? 0 : (percentile > 100 ? 100 : percentile);
+    uint64_t rank = (uint64_t) (p / 100.0 * (double) histogram->total_count + 0.5);
+    uint64_t seen = 0;
+    size_t i;
+
+    if (histogram->total_count == 0) {
+        return 0;
+    }
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (i = 0; i < histogram->counts_len; ++i) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            const uint64_t value = highest_value_from_index(histogram, i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+uint64_t hdr_count_between(const hdr_histogram *histogram, const uint64_t low, const uint64_t high) {
+    const size_t first = counts_index(histogram, low < histogram->highest ? low : histogram->highest);
+    const size_t last = counts_index(histogram, high < histogram->highest ? high : histogram->highest);
+    uint64_t count = 0;
+    size_t i;
+
+    for (i = first; i <= last; ++i) {
+        count += histogram->counts[i];
+    }
+    return count;
+}
+
+void hdr_print_text(const hdr_histogram *histogram, FILE *out, const double scale, const unsigned int ticks_per_half) {
+    const uint64_t total = histogram->total_count;
+    double percentile = 0;
+
+    fprintf(out, "%15s %12s %12s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+    while (total != 0) {
+        const uint64_t value = hdr_value_at_percentile(histogram, percentile);
+        const uint64_t count = hdr_count_between(histogram, 0, value);
+        const double fraction = (double) count / (double) total;
+        const double reached = fraction * 100.0 > percentile ? fraction * 100.0 : percentile;
+        unsigned int half_distance = 1;
+
+        fprintf(out, "%15.3f %12.6f %12llu", (double) value / scale, fraction, (unsigned long long) count);
+        if (count == total) {
+            fprintf(out, "\n");
+            break;
+        }
+        fprintf(out, " %14.2f\n", 1.0 / (1.0 - fraction));
+        /* Report ticks_per_half lines per halving of the remaining distance to 100% */
+        while (half_distance < 62 && 100.0 - reached <= 100.0 / (double) ((uint64_t) 1 << half_distance)) {
+            ++half_distance;
+        }
+        percentile = reached + 100.0 / (double) ((uint64_t) ticks_per_half << half_distance);
+    }
+    fprintf(out, "#[Mean    = %15.3f, StdDeviation   = %15.3f]\n", hdr_mean(histogram) / scale, hdr_stddev(histogram) / scale);
+    fprintf(out, "#[Max     = %15.3f, Total count    = %15llu]\n", (double) hdr_max(histogram) / scale, (unsigned long long) total);
+}
+
+void hdr_print_json(const hdr_histogram *histogram, FILE *out, const double scale) {
+    static const double percentiles[] = {50, 90, 99, 99.9, 99.99};
+    const char *separator = "";
+    size_t i;
+
+    fprintf(out, "{\"count\": %llu, \"min\": ", (unsigned long long) histogram->total_count);
+    print_scaled(out, (double) hdr_min(histogram), scale);
+    fprintf(out, ", \"max\": ");
+    print_scaled(out, (double) hdr_max(histogram), scale);
+    fprintf(out, ", \"mean\": %.3f, \"stddev\": %.3f, \"percentiles\": {", hdr_mean(histogram) / scale, hdr_stddev(histogram) / scale);
+    for (i = 0; i < sizeof (percentiles) / sizeof (percentiles[0]); ++i) {
+        fprintf(out, "%s\"%g\": ", separator, percentiles[i]);
+        print_scaled(out, (double) hdr_value_at_percentile(histogram, percentiles[i]), scale);
+        separator = ", ";
+    }
+    fprintf(out, "}, \"buckets\": [");
+    separator = "";
+    for (i = 0; i < histogram->counts_len; ++i) {
+        if (histogram->counts[i] != 0) {
+            fprintf(out, "%s[", separator);
+            print_scaled(out, (double) highest_value_from_index(histogram, i), scale);
+            fprintf(out, ", %llu]", (unsigned long long) histogram->counts[i]);
+            separator = ", ";
+        }
+    }
+    fprintf(out, "]}");
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of the HDR histogram functions.
+ *
+ * An HDR (high dynamic range) histogram records values, e.g. latencies, with a
+ * fixed relative precision over a wide range, in memory that depends only on
+ * that range and precision, not on the number of values recorded. Values are
+ * grouped in buckets covering a power of two each, every bucket being divided
+ * into linear sub-buckets fine enough to distinguish values at the requested
+ * number of significant decimal digits. Percentiles are therefore exact up to
+ * that precision however many values (10^8 or more) are recorded.
+ *
+ * Recording is lock-free and can be done from several threads at once, the
+ * other functions should not run concurrently with recording into the same
+ * histogram.
+ */
+
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * An HDR histogram (opaque).
+     */
+    typedef struct hdr_histogram hdr_histogram;
+
+    /**
+     * Creates an (empty) HDR histogram.
+     *
+     * @param[in] lowest              the lowest value that can be distinguished
+     *                                from 0 (at least 1)
+     * @param[in] highest             the highest value that can be recorded
+     *                                (at least twice `lowest`)
+     * @param[in] significant_figures the number of significant decimal digits
+     *                                to which values are kept (1..5)
+     * @return the histogram, `NULL` in case of invalid arguments
+     */
+    hdr_histogram *hdr_create(const uint64_t lowest, const uint64_t highest, const unsigned int significant_figures);
+
+    /**
+     * Destroys an HDR histogram.
+     *
+     * @param[in] histogram the histogram to destroy, can be `NULL`
+     */
+    void hdr_destroy(hdr_histogram *histogram);
+
+    /**
+     * Records a value. Values above the highest trackable value are recorded
+     * as that highest value.
+     *
+     * @param[in] histogram the histogram
+     * @param[in] value     the value to record
+     * @return __0__ if the value was in range, __1__ if it had to be clamped
+     */
+    int hdr_record(hdr_histogram *histogram, const uint64_t value);
+
+    /**
+     * Adds the values recorded in one histogram to another. Values of `from`
+     * beyond the range of `to` are clamped to it.
+     *
+     * @param[in] to   the histogram to add to
+     * @param[in] from the histogram to add
+     */
+    void hdr_add(hdr_histogram *to, const hdr_histogram *from);
+
+    /**
+     * Removes all recorded values.
+     *
+     * @param[in] histogram the histogram
+     */
+    void hdr_reset(hdr_histogram *histogram);
+
+    /**
+     * Removes the recorded values outside a range of values, e.g. to reject
+     * outliers before determining the statistics of the remaining values.
+     *
+     * @param[in] histogram the histogram
+     * @param[in] low       the lowest value to keep
+     * @param[in] high      the highest value to keep
+     * @return the number of values removed
+     */
+    uint64_t hdr_trim(hdr_histogram *histogram, const uint64_t low, const uint64_t high);
+
+    /**
+     * Returns the number of recorded values.
+     *
+     * @param[in] histogram the histogram
+     * @return the number of recorded values
+     */
+    uint64_t hdr_count(const hdr_histogram *histogram);
+
+    /**
+     * Returns the lowest recorded value.
+     *
+     * @param[in] histogram the histogram
+     * @return the lowest recorded value (0 if empty)
+     */
+    uint64_t hdr_min(const hdr_histogram *histogram);
+
+    /**
+     * Returns the highest recorded value.
+     *
+     * @param[in] histogram the histogram
+     * @return the highest recorded value (0 if empty)
+     */
+    uint64_t hdr_max(const hdr_histogram *histogram);
+
+    /**
+     * Returns the mean of the recorded values (at the precision of the
+     * histogram).
+     *
+     * @param[in] histogram the histogram
+     * @return the mean (0 if empty)
+     */
+    double hdr_mean(const hdr_histogram *histogram);
+
+    /**
+     * Returns the standard deviation of the recorded values (at the precision
+     * of the histogram).
+     *
+     * @param[in] histogram the histogram
+     * @return the standard deviation (0 if empty)
+     */
+    double hdr_stddev(const hdr_histogram *histogram);
+
+    /**
+     * Returns the value at a percentile: the highest value equivalent (at the
+     * precision of the histogram) to the recorded value at or below which the
+     * given percentage of the recorded values fall.
+     *
+     * @param[in] histogram  the histogram
+     * @param[in] percentile the percentile, 0..100
+     * @return the value at the percentile (0 if empty)
+     */
+    uint64_t hdr_value_at_percentile(const hdr_histogram *histogram, const double percentile);
+
+    /**
+     * Returns the number of recorded values within a range of values.
+     *
+     * @param[in] histogram the histogram
+     * @param[in] low       the lowest value of the range
+     * @param[in] high      the highest value of the range
+     * @return the number of recorded values equivalent to values in [low, high]
+     */
+    uint64_t hdr_count_between(const hdr_histogram *histogram, const uint64_t low, const uint64_t high);
+
+    /**
+     * Prints the percentile distribution of the recorded values as text: a
+     * summary line, then per line a value, its percentile, and the number of
+     * values at or below it, with `ticks_per_half` lines per halving of the
+     * remaining percentage (as HdrHistogram does).
+     *
+     * @param[in] histogram      the histogram
+     * @param[in] out            the stream to print to
+     * @param[in] scale          the divisor of the printed values (e.g. 1000 to
+     *                           print nanoseconds as microseconds)
+     * @param[in] ticks_per_half the number of lines per halving
+     */
+    void hdr_print_text(const hdr_histogram *histogram, FILE *out, const double scale, const unsigned int ticks_per_half);
+
+    /**
+     * Prints the recorded values as a JSON object: the count, min, max, mean,
+     * standard deviation, the common percentiles (50, 90, 99, 99.9, 99.99), and
+     * the non-empty buckets as `[value, count]` pairs (value being the highest
+     * value of the bucket).
+     *
+     * @param[in] histogram the histogram
+     * @param[in] out       the stream to print to
+     * @param[in] scale     the divisor of the printed values
+     */
+    void hdr_print_json(const hdr_histogram *histogram, FILE *out, const double scale);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HDR_HISTOGRAM_H */
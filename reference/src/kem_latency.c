@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the KEM latency instrumentation.
+ *
+ * @endcond
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "kem_latency.h"
+
+#include <stddef.h>
+#include <time.h>
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/** The histograms attached to the operations (accessed atomically) */
+static hdr_histogram *latency_histograms[KEM_LATENCY_NR_OPERATIONS];
+
+/**
+ * Determines the current time of the monotonic clock.
+ *
+ * @return the current time in nanoseconds (never 0)
+ */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000U + (uint64_t) ts.tv_nsec) | 1;
+}
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+void kem_latency_attach(const kem_latency_operation operation, hdr_histogram *histogram) {
+    if (operation < KEM_LATENCY_NR_OPERATIONS) {
+        __atomic_store_n(&latency_histograms[operation], histogram, __ATOMIC_RELEASE);
+    }
+}
+
+uint64_t kem_latency_start(const kem_latency_operation operation) {
+    return __atomic_load_n(&latency_histograms[operation], __ATOMIC_RELAXED) == NULL ? 0 : now_ns();
+}
+
+void kem_latency_stop(const kem_latency_operation operation, const uint64_t start) {
+    if (start != 0) {
+        hdr_histogram *histogram = __atomic_load_n(&latency_histograms[operation], __ATOMIC_ACQUIRE);
+        if (histogram != NULL) {
+            hdr_record(histogram, now_ns() - start);
+        }
+    }
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of the KEM latency instrumentation.
+ *
+ * An HDR histogram (see `hdr_histogram.h`) can be attached to each of the
+ * KEM operations (key generation, encapsulation, decapsulation). All CPA and
+ * CCA KEM calls (and thereby the PKE calls) of that operation, from any
+ * thread, then record their latency in nanoseconds into it. Without a
+ * histogram attached, the instrumentation costs one atomic load per call.
+ */
+
+#ifndef KEM_LATENCY_H
+#define KEM_LATENCY_H
+
+#include <stdint.h>
+
+#include "hdr_histogram.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * The instrumented KEM operations.
+     */
+    typedef enum {
+        KEM_LATENCY_KEYPAIR, /**< Key pair generation */
+        KEM_LATENCY_ENCAPSULATE, /**< Encapsulation */
+        KEM_LATENCY_DECAPSULATE, /**< Decapsulation */
+        KEM_LATENCY_NR_OPERATIONS /**< The number of instrumented operations */
+    } kem_latency_operation;
+
+    /**
+     * Attaches a histogram to a KEM operation, replacing the one attached
+     * before. The histogram must remain valid until it is detached (and no
+     * operation is still recording into it).
+     *
+     * @param[in] operation the operation
+     * @param[in] histogram the histogram to record the latencies (in
+     *                      nanoseconds) into, `NULL` to detach
+     */
+    void kem_latency_attach(const kem_latency_operation operation, hdr_histogram *histogram);
+
+    /**
+     * Starts the latency measurement of a KEM operation (used by the KEM
+     * functions).
+     *
+     * @param[in] operation the operation
+     * @return the start time in nanoseconds, __0__ if no histogram is attached
+     */
+    uint64_t kem_latency_start(const kem_latency_operation operation);
+
+    /**
+     * Stops the latency measurement of a KEM operation and records it (used
+     * by the KEM functions).
+     *
+     * @param[in] operation the operation
+     * @param[in] start     the start time returned by `kem_latency_start()`
+     */
+    void kem_latency_stop(const kem_latency_operation operation, const uint64_t start);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KEM_LATENCY_H */
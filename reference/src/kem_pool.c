@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the encapsulation pool functions.
+ *
+ * @endcond
+ */
+
+#include "kem_pool.h"
+
+#include <string.h>
+#include <pthread.h>
+
+#include "cpa_kem.h"
+#include "cca_kem.h"
+#include "misc.h"
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/**
+ * The state of an encapsulation pool. The pairs are kept in a ring buffer of
+ * _depth_ entries, each entry being a ciphertext followed by its shared secret.
+ */
+struct kem_pool {
+    parameters params; /**< The algorithm parameters in use */
+    unsigned char *pk; /**< The public key */
+    int (*enc)(unsigned char *, unsigned char *, const unsigned char *, const parameters *); /**< The encapsulation function */
+    size_t ct_size; /**< The size of a ciphertext */
+    size_t entry_size; /**< The size of an entry (ciphertext and shared secret) */
+    unsigned char *entries; /**< The ring buffer of entries */
+    size_t depth; /**< The number of entries in the ring buffer */
+    size_t low_watermark; /**< The low watermark */
+    size_t head; /**< The position of the oldest entry */
+    size_t count; /**< The number of entries in use */
+    int below_watermark; /**< Whether the callback was called for the current crossing of the watermark */
+    int stop; /**< Whether the background thread has to stop */
+    kem_pool_low_watermark_callback callback; /**< The low watermark callback */
+    void *arg; /**< The argument for the callback */
+    pthread_mutex_t lock; /**< Protects the ring buffer and the flags */
+    pthread_cond_t not_full; /**< Signalled when an entry has been taken */
+    pthread_t thread; /**< The background thread */
+};
+
+/**
+ * The background thread of a pool: computes encapsulations (without holding
+ * the lock) as long as the pool is not full.
+ *
+ * @param[in] arg the pool
+ * @return `NULL`
+ */
+static void *fill_pool(void *arg) {
+    kem_pool *pool = arg;
+    unsigned char *entry = checked_malloc(pool->entry_size);
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop) {
+        if (pool->count == pool->depth) {
+            pthread_cond_wait(&pool->not_full, &pool->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->enc(entry, entry + pool->ct_size, pool->pk, &pool->params);
+
+        pthread_mutex_lock(&pool->lock);
+        if (!pool->stop) {
+            memcpy(pool->entries + ((pool->head + pool->count) % pool->depth) * pool->entry_size, entry, pool->entry_size);
+            ++pool->count;
+            if (pool->count > pool->low_watermark) {
+                pool->below_watermark = 0;
+            }
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    memset(entry, 0, pool->entry_size);
+    free(entry);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+kem_pool *kem_pool_create(const unsigned char *pk, const parameters *params, const uint8_t cca, const size_t depth, const size_t low_watermark, kem_pool_low_watermark_callback callback, void *arg) {
+    kem_pool *pool;
+
+    if (depth == 0) {
+        return NULL;
+    }
+
+    pool = checked_calloc(1, sizeof (*pool));
+    pool->params = *params;
+    pool->pk = checked_malloc(params->pk_size);
+    memcpy(pool->pk, pk, params->pk_size);
+    pool->enc = cca ? crypto_cca_kem_enc_p : crypto_kem_enc_p;
+    pool->ct_size = (size_t) (cca ? params->ct_size + params->ss_size : params->ct_size);
+    pool->entry_size = pool->ct_size + params->ss_size;
+    pool->entries = checked_malloc(depth * pool->entry_size);
+    pool->depth = depth;
+    pool->low_watermark = low_watermark;
+    pool->callback = callback;
+    pool->arg = arg;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+
+    if (pthread_create(&pool->thread, NULL, fill_pool, pool)) {
+        pthread_cond_destroy(&pool->not_full);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool->entries);
+        free(pool->pk);
+        free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+int kem_pool_enc(kem_pool *pool, unsigned char *ct, unsigned char *ss) {
+    const size_t ss_size = pool->entry_size - pool->ct_size;
+    int taken = 0;
+    int notify = 0;
+    size_t depth;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count > 0) {
+        unsigned char *entry = pool->entries + pool->head * pool->entry_size;
+        memcpy(ct, entry, pool->ct_size);
+        memcpy(ss, entry + pool->ct_size, ss_size);
+        memset(entry, 0, pool->entry_size);
+        pool->head = (pool->head + 1) % pool->depth;
+        --pool->count;
+        pthread_cond_signal(&pool->not_full);
+        taken = 1;
+    }
+    depth = pool->count;
+    if (depth <= pool->low_watermark && !pool->below_watermark) {
+        pool->below_watermark = 1;
+        notify = 1;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (notify && pool->callback != NULL) {
+        pool->callback(pool, depth, pool->arg);
+    }
+
+    /* Pool ran dry, encapsulate directly */
+    if (!taken) {
+        return pool->enc(ct, ss, pool->pk, &pool->params);
+    }
+
+    return 0;
+}
+
+size_t kem_pool_depth(kem_pool *pool) {
+    size_t depth;
+
+    pthread_mutex_lock(&pool->lock);
+    depth = pool->count;
+    pthread_mutex_unlock(&pool->lock);
+
+    return depth;
+}
+
+void kem_pool_destroy(kem_pool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_signal(&pool->not_full);
+    pthread_mutex_unlock(&pool->lock);
+    pthread_join(pool->thread, NULL);
+
+    pthread_cond_destroy(&pool->not_full);
+    pthread_mutex_destroy(&pool->lock);
+    memset(pool->entries, 0, pool->depth * pool->entry_size);
+    free(pool->entries);
+    free(pool->pk);
+    free(pool);
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of the encapsulation pool functions.
+ *
+ * An encapsulation pool holds ready-made (ciphertext, shared secret) pairs for
+ * a single public key. A background thread keeps the pool filled, so
+ * encapsulating on the request path is reduced to taking a pair out of the
+ * pool. Since the randomness of an encapsulation does not depend on the
+ * request, a pooled pair is exactly as good as one computed on demand, as long
+ * as each pair is handed out only once (which the pool guarantees).
+ *
+ * Note: pools for public keys created with fn=1 require `A_fixed` to have been
+ * initialised (see `create_A_fixed()`) before the pool is created.
+ */
+
+#ifndef KEM_POOL_H
+#define KEM_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parameters.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * An encapsulation pool (opaque).
+     */
+    typedef struct kem_pool kem_pool;
+
+    /**
+     * The function called when the number of pairs in a pool drops to (or
+     * below) the low watermark. The callback is called from the thread taking
+     * the pair, without any lock held, once per crossing of the watermark.
+     *
+     * @param[in] pool  the pool
+     * @param[in] depth the number of pairs left in the pool
+     * @param[in] arg   the argument as passed to `kem_pool_create()`
+     */
+    typedef void (*kem_pool_low_watermark_callback)(kem_pool *pool, size_t depth, void *arg);
+
+    /**
+     * Creates an encapsulation pool for the given public key and starts the
+     * background thread that fills it.
+     *
+     * @param[in] pk            the public key (copied into the pool)
+     * @param[in] params        the algorithm parameters to use (copied into the pool)
+     * @param[in] cca           __0__ for a pool of CPA KEM encapsulations, __1__ for CCA KEM
+     * @param[in] depth         the (maximum) number of pairs kept in the pool
+     * @param[in] low_watermark the number of pairs at (or below) which the callback is called
+     * @param[in] callback      the low watermark callback, can be `NULL`
+     * @param[in] arg           the argument passed to the callback
+     * @return the pool, `NULL` in case of an error (`depth == 0` or thread creation failed)
+     */
+    kem_pool *kem_pool_create(const unsigned char *pk, const parameters *params, const uint8_t cca, const size_t depth, const size_t low_watermark, kem_pool_low_watermark_callback callback, void *arg);
+
+    /**
+     * Takes a (ciphertext, shared secret) pair out of the pool. When the pool
+     * is empty, the encapsulation is computed by the calling thread instead of
+     * waiting for the background thread.
+     *
+     * @param[in]  pool the pool
+     * @param[out] ct   key encapsulation message (ciphertext)
+     * @param[out] ss   shared secret
+     * @return __0__ in case of success
+     */
+    int kem_pool_enc(kem_pool *pool, unsigned char *ct, unsigned char *ss);
+
+    /**
+     * Gets the number of pairs currently in the pool.
+     *
+     * @param[in] pool the pool
+     * @return the number of pairs in the pool
+     */
+    size_t kem_pool_depth(kem_pool *pool);
+
+    /**
+     * Stops the background thread and destroys the pool. The pairs still in
+     * the pool are wiped.
+     *
+     * @param[in] pool the pool to destroy, can be `NULL`
+     */
+    void kem_pool_destroy(kem_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KEM_POOL_H */
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the key pair pool functions.
+ *
+ * The ring is a bounded queue in which every slot carries a sequence number
+ * (after D. Vyukov). A slot at position _pos_ can be filled when its sequence
+ * number equals _pos_ and taken when it equals _pos + 1_. Taking a key pair
+ * then sets it to _pos + capacity_, i.e. the position at which the slot is
+ * filled next. Consumers claim a position with a compare-and-swap, the
+ * (single, serialised) producer simply advances its position.
+ *
+ * @endcond
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "keypair_pool.h"
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "cpa_kem.h"
+#include "cca_kem.h"
+#include "misc.h"
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/**
+ * A slot of the ring.
+ */
+typedef struct {
+    size_t sequence; /**< The sequence number of the slot (accessed atomically) */
+    unsigned char *keypair; /**< The key pair (public key followed by secret key) */
+} keypair_slot;
+
+/**
+ * The state of a key pair pool.
+ */
+struct keypair_pool {
+    parameters params; /**< The algorithm parameters in use */
+    uint8_t fn; /**< The variant to use for the generation of A */
+    int (*keypair)(unsigned char *, unsigned char *, const parameters *, const uint8_t); /**< The key pair generation function */
+    size_t pk_size; /**< The size of a public key */
+    size_t sk_size; /**< The size of a secret key */
+    size_t capacity; /**< The number of slots of the ring */
+    keypair_slot *slots; /**< The slots of the ring */
+    unsigned char *storage; /**< The storage of the key pairs in the slots */
+    size_t enqueue_pos; /**< The position of the next slot to fill (protected by producer_lock) */
+    size_t dequeue_pos; /**< The position of the next slot to take (accessed atomically) */
+    size_t waiting; /**< The number of workers waiting for room (accessed atomically) */
+    int stop; /**< Whether the workers have to stop (protected by producer_lock) */
+    pthread_mutex_t producer_lock; /**< Serialises the workers publishing key pairs */
+    pthread_cond_t room; /**< Signalled when a key pair has been taken */
+    size_t nr_workers; /**< The number of worker threads */
+    pthread_t *workers; /**< The worker threads */
+    struct timespec created; /**< The moment the pool was created */
+    unsigned long long generated; /**< Metric: key pairs generated by the workers (accessed atomically) */
+    unsigned long long taken; /**< Metric: key pairs taken from the pool (accessed atomically) */
+    unsigned long long stalls; /**< Metric: takes that found the pool empty (accessed atomically) */
+    unsigned long long worker_waits; /**< Metric: waits of the workers for room (accessed atomically) */
+};
+
+/**
+ * Determines whether the slot at the producer's position can be filled.
+ *
+ * @param[in] pool the pool
+ * @return __1__ if the slot is free, __0__ if the ring is full
+ */
+static int slot_free(keypair_pool *pool) {
+    const keypair_slot *slot = &pool->slots[pool->enqueue_pos % pool->capacity];
+    return __atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST) == pool->enqueue_pos;
+}
+
+/**
+ * A worker thread of a pool: generates key pairs (without holding a lock) and
+ * publishes them, waiting for room in the ring when it is full.
+ *
+ * @param[in] arg the pool
+ * @return `NULL`
+ */
+static void *generate_keypairs(void *arg) {
+    keypair_pool *pool = arg;
+    unsigned char *keypair = checked_malloc(pool->pk_size + pool->sk_size);
+
+    for (;;) {
+        pool->keypair(keypair, keypair + pool->pk_size, &pool->params, pool->fn);
+        __atomic_add_fetch(&pool->generated, 1, __ATOMIC_RELAXED);
+
+        pthread_mutex_lock(&pool->producer_lock);
+        while (!pool->stop && !slot_free(pool)) {
+            /* Announce the wait before checking again, a consumer taking a key
+             * pair in between then sees it and signals under the lock */
+            __atomic_add_fetch(&pool->waiting, 1, __ATOMIC_SEQ_CST);
+            __atomic_add_fetch(&pool->worker_waits, 1, __ATOMIC_RELAXED);
+            if (!slot_free(pool)) {
+                pthread_cond_wait(&pool->room, &pool->producer_lock);
+            }
+            __atomic_sub_fetch(&pool->waiting, 1, __ATOMIC_SEQ_CST);
+        }
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->producer_lock);
+            break;
+        }
+        {
+            keypair_slot *slot = &pool->slots[pool->enqueue_pos % pool->capacity];
+            memcpy(slot->keypair, keypair, pool->pk_size + pool->sk_size);
+            __atomic_store_n(&slot->sequence, pool->enqueue_pos + 1, __ATOMIC_RELEASE);
+            ++pool->enqueue_pos;
+        }
+        pthread_mutex_unlock(&pool->producer_lock);
+    }
+
+    memset(keypair, 0, pool->pk_size + pool->sk_size);
+    free(keypair);
+
+    return NULL;
+}
+
+/**
+ * Signals the workers that the pool has to stop and waits for them to finish.
+ *
+ * @param[in] pool       the pool
+ * @param[in] nr_workers the number of workers that were started
+ */
+static void stop_workers(keypair_pool *pool, const size_t nr_workers) {
+    size_t i;
+
+    pthread_mutex_lock(&pool->producer_lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->room);
+    pthread_mutex_unlock(&pool->producer_lock);
+    for (i = 0; i < nr_workers; ++i) {
+        pthread_join(pool->workers[i], NULL);
+    }
+}
+
+/**
+ * Releases the resources of a pool, wiping the key pairs in it.
+ *
+ * @param[in] pool the pool
+ */
+static void free_pool(keypair_pool *pool) {
+    pthread_cond_destroy(&pool->room);
+    pthread_mutex_destroy(&pool->producer_lock);
+    memset(pool->storage, 0, pool->capacity * (pool->pk_size + pool->sk_size));
+    free(pool->storage);
+    free(pool->slots);
+    free(pool->workers);
+    free(pool);
+}
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+keypair_pool *keypair_pool_create(const parameters *params, const uint8_t fn, const uint8_t cca, const size_t capacity, const size_t nr_workers) {
+    keypair_pool *pool;
+    size_t i;
+
+    if (capacity == 0 || nr_workers == 0) {
+        return NULL;
+    }
+
+    pool = checked_calloc(1, sizeof (*pool));
+    pool->params = *params;
+    pool->fn = fn;
+    pool->keypair = cca ? crypto_cca_kem_keypair_p : crypto_kem_keypair_p;
+    pool->pk_size = params->pk_size;
+    pool->sk_size = (size_t) (cca ? params->sk_size + params->ss_size + params->pk_size : params->sk_size);
+    pool->capacity = capacity;
+    pool->slots = checked_malloc(capacity * sizeof (*pool->slots));
+    pool->storage = checked_malloc(capacity * (pool->pk_size + pool->sk_size));
+    for (i = 0; i < capacity; ++i) {
+        pool->slots[i].sequence = i;
+        pool->slots[i].keypair = pool->storage + i * (pool->pk_size + pool->sk_size);
+    }
+    pthread_mutex_init(&pool->producer_lock, NULL);
+    pthread_cond_init(&pool->room, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &pool->created);
+
+    pool->workers = checked_malloc(nr_workers * sizeof (*pool->workers));
+    for (i = 0; i < nr_workers; ++i) {
+        if (pthread_create(&pool->workers[i], NULL, generate_keypairs, pool)) {
+            stop_workers(pool, i);
+            free_pool(pool);
+            return NULL;
+        }
+    }
+    pool->nr_workers = nr_workers;
+
+    return pool;
+}
+
+int keypair_pool_keypair(keypair_pool *pool, unsigned char *pk, unsigned char *sk) {
+    size_t pos = __atomic_load_n(&pool->dequeue_pos, __ATOMIC_RELAXED);
+
+    for (;;) {
+        keypair_slot *slot = &pool->slots[pos % pool->capacity];
+        const size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+
+        if (sequence == pos + 1) { /* Filled, try to claim it */
+            if (__atomic_compare_exchange_n(&pool->dequeue_pos, &pos, pos + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                memcpy(pk, slot->keypair, pool->pk_size);
+                memcpy(sk, slot->keypair + pool->pk_size, pool->sk_size);
+                memset(slot->keypair, 0, pool->pk_size + pool->sk_size);
+                __atomic_store_n(&slot->sequence, pos + pool->capacity, __ATOMIC_SEQ_CST);
+                __atomic_add_fetch(&pool->taken, 1, __ATOMIC_RELAXED);
+                /* Wake up a worker waiting for room */
+                if (__atomic_load_n(&pool->waiting, __ATOMIC_SEQ_CST)) {
+                    pthread_mutex_lock(&pool->producer_lock);
+                    pthread_cond_signal(&pool->room);
+                    pthread_mutex_unlock(&pool->producer_lock);
+                }
+                return 0;
+            }
+            /* pos has been updated by the failed compare-and-swap */
+        } else if (sequence == pos) { /* Empty, generate it ourselves */
+            __atomic_add_fetch(&pool->stalls, 1, __ATOMIC_RELAXED);
+            return pool->keypair(pk, sk, &pool->params, pool->fn);
+        } else { /* Taken by another consumer in the meantime */
+            pos = __atomic_load_n(&pool->dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void keypair_pool_get_metrics(keypair_pool *pool, keypair_pool_metrics *metrics) {
+    struct timespec now;
+    double elapsed;
+    size_t produced, consumed;
+
+    pthread_mutex_lock(&pool->producer_lock);
+    produced = pool->enqueue_pos;
+    pthread_mutex_unlock(&pool->producer_lock);
+    consumed = __atomic_load_n(&pool->dequeue_pos, __ATOMIC_RELAXED);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (double) (now.tv_sec - pool->created.tv_sec) + (double) (now.tv_nsec - pool->created.tv_nsec) / 1e9;
+
+    metrics->depth = produced > consumed ? produced - consumed : 0;
+    metrics->capacity = pool->capacity;
+    metrics->generated = __atomic_load_n(&pool->generated, __ATOMIC_RELAXED);
+    metrics->taken = __atomic_load_n(&pool->taken, __ATOMIC_RELAXED);
+    metrics->stalls = __atomic_load_n(&pool->stalls, __ATOMIC_RELAXED);
+    metrics->worker_waits = __atomic_load_n(&pool->worker_waits, __ATOMIC_RELAXED);
+    metrics->refill_rate = elapsed > 0 ? (double) metrics->generated / elapsed : 0;
+}
+
+void keypair_pool_destroy(keypair_pool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    stop_workers(pool, pool->nr_workers);
+    free_pool(pool);
+}
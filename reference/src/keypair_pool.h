@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of the key pair pool functions.
+ *
+ * A key pair pool holds ready-made key pairs, for instance for use as
+ * forward-secret ephemeral keys. A number of worker threads generate key pairs
+ * in the background and publish them in a bounded ring. Threads needing a key
+ * pair take one from the ring without taking a lock. Publishing is serialised
+ * between the workers, so the ring has a single producer and many consumers.
+ *
+ * Note: pools using fn=1 require `A_fixed` to have been initialised (see
+ * `create_A_fixed()`) before the pool is created.
+ */
+
+#ifndef KEYPAIR_POOL_H
+#define KEYPAIR_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parameters.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * A key pair pool (opaque).
+     */
+    typedef struct keypair_pool keypair_pool;
+
+    /**
+     * The metrics of a key pair pool.
+     */
+    typedef struct {
+        size_t depth; /**< The number of key pairs currently in the pool */
+        size_t capacity; /**< The maximum number of key pairs in the pool */
+        unsigned long long generated; /**< The number of key pairs generated by the workers */
+        unsigned long long taken; /**< The number of key pairs taken from the pool */
+        unsigned long long stalls; /**< The number of takes that found the pool empty (and generated the key pair themselves) */
+        unsigned long long worker_waits; /**< The number of times a worker had to wait for room in the pool */
+        double refill_rate; /**< The number of key pairs generated by the workers per second since the creation of the pool */
+    } keypair_pool_metrics;
+
+    /**
+     * Creates a key pair pool and starts its worker threads.
+     *
+     * @param[in] params     the algorithm parameters to use (copied into the pool)
+     * @param[in] fn         the variant to use for the generation of A
+     * @param[in] cca        __0__ for CPA KEM key pairs, __1__ for CCA KEM key pairs
+     * @param[in] capacity   the (maximum) number of key pairs kept in the pool
+     * @param[in] nr_workers the number of worker threads generating key pairs
+     * @return the pool, `NULL` in case of an error (zero capacity or workers, or thread creation failed)
+     */
+    keypair_pool *keypair_pool_create(const parameters *params, const uint8_t fn, const uint8_t cca, const size_t capacity, const size_t nr_workers);
+
+    /**
+     * Takes a key pair from the pool without blocking. When the pool is empty,
+     * the key pair is generated by the calling thread instead (a stall).
+     *
+     * @param[in]  pool the pool
+     * @param[out] pk   public key
+     * @param[out] sk   secret key
+     * @return __0__ in case of success
+     */
+    int keypair_pool_keypair(keypair_pool *pool, unsigned char *pk, unsigned char *sk);
+
+    /**
+     * Gets the metrics of the pool.
+     *
+     * @param[in]  pool    the pool
+     * @param[out] metrics the metrics
+     */
+    void keypair_pool_get_metrics(keypair_pool *pool, keypair_pool_metrics *metrics);
+
+    /**
+     * Stops the worker threads and destroys the pool. The key pairs still in
+     * the pool are wiped.
+     *
+     * @param[in] pool the pool to destroy, can be `NULL`
+     */
+    void keypair_pool_destroy(keypair_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KEYPAIR_POOL_H */
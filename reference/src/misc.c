@@ -40,6 +40,8 @@
 
 #include <stdio.h>
 
+#include "round2_stats.h"
+
 void print_hex(const char *var, const unsigned char *data, const size_t nr_elements, const size_t element_size) {
     size_t i, ii;
     if (var != NULL) {
@@ -238,6 +240,7 @@ void *checked_malloc(size_t size) {
         fprintf(stderr, "Could not allocate memory of size %lu\n", (unsigned long) size);
         exit(EXIT_FAILURE);
     }
+    ROUND2_STATS_COUNT(ROUND2_STATS_ALLOC, size);
     return temp;
 }
 
@@ -247,6 +250,7 @@ void *checked_calloc(size_t count, size_t size) {
         fprintf(stderr, "Could not allocate memory for %lu elements of size %lu\n", (unsigned long) count, (unsigned long) size);
         exit(EXIT_FAILURE);
     }
+    ROUND2_STATS_COUNT(ROUND2_STATS_ALLOC, count * size);
     return temp;
 }
 
@@ -256,6 +260,7 @@ void *checked_realloc(void *ptr, size_t size) {
         fprintf(stderr, "Could not reallocate memory of size %lu\n", (unsigned long) size);
         exit(EXIT_FAILURE);
     }
+    ROUND2_STATS_COUNT(ROUND2_STATS_ALLOC, size);
     return temp;
 }
 
@@ -68,6 +68,50 @@
  */
 #define BITS_TO_BYTES(b) (CEIL_DIV(b,8))
 
+/**
+ * Storage class specifier for variables that need a separate instance in each
+ * thread. Expands to nothing for compilers without thread-local storage, in
+ * which case the library is not thread-safe.
+ */
+#if defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL
+#endif
+
+/**
+ * Function specifier for the generic versions of kernels that are specialised
+ * by calling them with constant arguments, which only works if they are
+ * inlined into each of these calls.
+ */
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+/**
+ * Whether the hot functions are compiled for several x86-64
+ * micro-architecture levels (function multi-versioning), as is done for the
+ * library (`make lib`). Default is 0.
+ */
+#ifndef ROUND2_MULTIVERSION
+#define ROUND2_MULTIVERSION 0
+#endif
+
+/**
+ * Function specifier for the hot functions. With `ROUND2_MULTIVERSION` (and
+ * GCC 11 or later on x86-64 ELF platforms) versions of the function are
+ * compiled for the baseline and the x86-64-v2, v3 (AVX2) and v4 (AVX-512)
+ * levels, of which the dynamic loader selects the best one for the cpu when
+ * the library is loaded (through an ifunc). Expands to nothing otherwise.
+ */
+#if ROUND2_MULTIVERSION && defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11 && defined(__x86_64__) && defined(__ELF__)
+#define TARGET_CLONES __attribute__((target_clones("default", "arch=x86-64-v2", "arch=x86-64-v3", "arch=x86-64-v4")))
+#else
+#define TARGET_CLONES
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +40,7 @@
 
 #include <string.h>
 #include "misc.h"
+#include "round2_stats.h"
 
 /*******************************************************************************
  * Private functions
@@ -54,7 +55,7 @@
  * @param[in]  nr_bits the number of significant bits value
  * @return the length of the packed vector in bytes
  */
-static size_t pack(unsigned char *packed, const uint16_t *m, size_t els, uint8_t nr_bits) {
+TARGET_CLONES static size_t pack(unsigned char *packed, const uint16_t *m, size_t els, uint8_t nr_bits) {
     const size_t packed_len = (size_t) (BITS_TO_BYTES(els * nr_bits));
     const uint8_t val_size = (uint8_t) (8 * sizeof (uint16_t));
     size_t idx = 0;
@@ -98,7 +99,7 @@ static size_t pack(unsigned char *packed, const uint16_t *m, size_t els, uint8_t
  * @param[in]  nr_bits number of significant bits per element
  * @return total number of packed bytes processed
  */
-static size_t unpack(uint16_t *m, const unsigned char *packed, const size_t els, const uint8_t nr_bits) {
+TARGET_CLONES static size_t unpack(uint16_t *m, const unsigned char *packed, const size_t els, const uint8_t nr_bits) {
     const size_t unpacked_len = (size_t) (BITS_TO_BYTES(els * nr_bits));
     size_t idx = 0;
     size_t packed_idx = 0;
@@ -128,7 +129,11 @@ static size_t unpack(uint16_t *m, const unsigned char *packed, const size_t els,
             m[idx] = (uint16_t) (m[idx] | bits);
             if (used_bits == 8) {
                 used_bits = 0;
-                val = packed[++packed_idx];
+                ++packed_idx;
+                /* Do not read beyond the last byte */
+                if (remaining_bits > 0 || idx + 1 < els) {
+                    val = packed[packed_idx];
+                }
             }
         }
     }
@@ -144,7 +149,7 @@ static size_t unpack(uint16_t *m, const unsigned char *packed, const size_t els,
  * @param[in]  els     number of elements
  * @return length of the packed vector in bytes
  */
-static size_t pack_sptervec(unsigned char *packed, const int16_t *m, size_t els) {
+TARGET_CLONES static size_t pack_sptervec(unsigned char *packed, const int16_t *m, size_t els) {
     const size_t packed_len = (size_t) (BITS_TO_BYTES(els * 2));
     size_t i;
     size_t packed_idx;
@@ -171,7 +176,7 @@ static size_t pack_sptervec(unsigned char *packed, const int16_t *m, size_t els)
  * @param[in]  els     number of elements
  * @return processed bytes
  */
-static size_t unpack_sptervec(int16_t *m, const unsigned char *packed, size_t els) {
+TARGET_CLONES static size_t unpack_sptervec(int16_t *m, const unsigned char *packed, size_t els) {
     size_t i;
     size_t packed_idx = 0;
 
@@ -184,13 +189,62 @@ static size_t unpack_sptervec(int16_t *m, const unsigned char *packed, size_t el
     return packed_idx;
 }
 
+/** The size of the chunks passed on by `pack_ct_chunked()` */
+#define PACK_CHUNK_SIZE 256
+
+/**
+ * Packs the given vector like `pack()` and passes the packed bytes to the
+ * consumer in chunks of at most `PACK_CHUNK_SIZE` bytes.
+ *
+ * @param[in]  m        the vector to pack
+ * @param[in]  els      the number of elements
+ * @param[in]  nr_bits  the number of significant bits value
+ * @param[in]  consumer the function to which the packed bytes are passed
+ * @param[in]  arg      the argument for the consumer
+ * @return the length of the packed vector in bytes
+ */
+static size_t pack_chunked(const uint16_t *m, size_t els, uint8_t nr_bits, pack_consumer consumer, void *arg) {
+    const uint32_t mask = (1U << nr_bits) - 1;
+    unsigned char chunk[PACK_CHUNK_SIZE];
+    size_t len = 0;
+    size_t total = 0;
+    uint32_t acc = 0;
+    uint8_t acc_bits = 0;
+    size_t i;
+
+    for (i = 0; i < els; ++i) {
+        acc = (acc << nr_bits) | (m[i] & mask);
+        acc_bits = (uint8_t) (acc_bits + nr_bits);
+        while (acc_bits >= 8) {
+            acc_bits = (uint8_t) (acc_bits - 8);
+            chunk[len++] = (unsigned char) (acc >> acc_bits);
+            if (len == PACK_CHUNK_SIZE) {
+                consumer(arg, chunk, len);
+                total += len;
+                len = 0;
+            }
+        }
+    }
+    /* The last bits go at the top of the last byte */
+    if (acc_bits > 0) {
+        chunk[len++] = (unsigned char) (acc << (8 - acc_bits));
+    }
+    if (len > 0) {
+        consumer(arg, chunk, len);
+        total += len;
+    }
+
+    return total;
+}
+
 /*******************************************************************************
  * Public functions
  ******************************************************************************/
 
 size_t pack_pk(unsigned char *packed_pk, const uint8_t fn, const unsigned char *sigma, size_t sigma_len, const uint16_t *B, size_t elements, uint8_t nr_bits) {
     size_t packed_idx = 0;
-    
+    ROUND2_STATS_START(stats_start);
+
     /* Pack fn */
     packed_pk[packed_idx++] = fn;
     /* Pack sigma */
@@ -199,15 +253,25 @@ size_t pack_pk(unsigned char *packed_pk, const uint8_t fn, const unsigned char *
     /* Pack B */
     packed_idx += pack((packed_pk + packed_idx), B, elements, nr_bits);
 
+    ROUND2_STATS_STOP(ROUND2_STATS_PACK, stats_start, packed_idx);
+
     return packed_idx;
 }
 
 size_t pack_sk(unsigned char *packed_sk, const int16_t *sk, size_t elements) {
-    return pack_sptervec(packed_sk, sk, elements);
+    size_t packed_len;
+    ROUND2_STATS_START(stats_start);
+
+    packed_len = pack_sptervec(packed_sk, sk, elements);
+
+    ROUND2_STATS_STOP(ROUND2_STATS_PACK, stats_start, packed_len);
+
+    return packed_len;
 }
 
 size_t unpack_pk(uint8_t *fn, unsigned char *sigma, uint16_t *B, const unsigned char *packed_pk, size_t sigma_len, size_t elements, uint8_t nr_bits) {
     size_t unpacked_idx = 0;
+    ROUND2_STATS_START(stats_start);
 
     /* Unpack fn */
     *fn = (uint8_t) packed_pk[unpacked_idx++];
@@ -217,31 +281,86 @@ size_t unpack_pk(uint8_t *fn, unsigned char *sigma, uint16_t *B, const unsigned
     /* Unpack B */
     unpacked_idx += unpack(B, packed_pk + unpacked_idx, elements, nr_bits);
 
+    ROUND2_STATS_STOP(ROUND2_STATS_UNPACK, stats_start, unpacked_idx);
+
     return unpacked_idx;
 }
 
 size_t unpack_sk(int16_t *sk, const unsigned char *packed_sk, size_t elements) {
-    return unpack_sptervec(sk, packed_sk, elements);
+    size_t packed_len;
+    ROUND2_STATS_START(stats_start);
+
+    packed_len = unpack_sptervec(sk, packed_sk, elements);
+
+    ROUND2_STATS_STOP(ROUND2_STATS_UNPACK, stats_start, packed_len);
+
+    return packed_len;
 }
 
 size_t pack_ct(unsigned char *packed_ct, const uint16_t *U, size_t U_els, uint8_t U_bits, const uint16_t *v, size_t v_els, uint8_t v_bits) {
     size_t idx = 0;
+    ROUND2_STATS_START(stats_start);
 
     /* Pack U */
     idx += pack(packed_ct, U, U_els, U_bits);
     /* Pack v */
     idx += pack((packed_ct + idx), v, v_els, v_bits);
 
+    ROUND2_STATS_STOP(ROUND2_STATS_PACK, stats_start, idx);
+
     return idx;
 }
 
 size_t unpack_ct(uint16_t *U, uint16_t *v, const unsigned char *packed_ct, const size_t U_els, const uint8_t U_bits, const size_t v_els, const uint8_t v_bits) {
     size_t idx = 0;
+    ROUND2_STATS_START(stats_start);
 
     /* Unpack U */
     idx += unpack(U, packed_ct, U_els, U_bits);
     /* Unpack v */
     idx += unpack(v, (packed_ct + idx), v_els, v_bits);
 
+    ROUND2_STATS_STOP(ROUND2_STATS_UNPACK, stats_start, idx);
+
+    return idx;
+}
+
+size_t unpack_part(uint16_t *m, const unsigned char *packed, const size_t first, const size_t els, const uint8_t nr_bits) {
+    const uint16_t mask = (uint16_t) ((1U << nr_bits) - 1);
+    size_t i;
+    ROUND2_STATS_START(stats_start);
+
+    for (i = 0; i < els; ++i) {
+        /* An element spans at most 3 bytes, read these (most significant
+         * bits first, like pack() stores them) and extract the element */
+        const size_t bit = (first + i) * nr_bits;
+        const size_t last = (bit + nr_bits - 1) / 8;
+        uint32_t window = 0;
+        unsigned window_bits = 0;
+        size_t b;
+
+        for (b = bit / 8; b <= last; ++b) {
+            window = (window << 8) | packed[b];
+            window_bits += 8;
+        }
+        m[i] = (uint16_t) (window >> (window_bits - bit % 8 - nr_bits)) & mask;
+    }
+
+    ROUND2_STATS_STOP(ROUND2_STATS_UNPACK, stats_start, BITS_TO_BYTES(els * nr_bits));
+
+    return (size_t) (BITS_TO_BYTES((first + els) * nr_bits));
+}
+
+size_t pack_ct_chunked(const uint16_t *U, size_t U_els, uint8_t U_bits, const uint16_t *v, size_t v_els, uint8_t v_bits, pack_consumer consumer, void *arg) {
+    size_t idx = 0;
+    ROUND2_STATS_START(stats_start);
+
+    /* Pack U */
+    idx += pack_chunked(U, U_els, U_bits, consumer, arg);
+    /* Pack v */
+    idx += pack_chunked(v, v_els, v_bits, consumer, arg);
+
+    ROUND2_STATS_STOP(ROUND2_STATS_PACK, stats_start, idx);
+
     return idx;
 }
@@ -122,6 +122,46 @@ extern "C" {
      */
     size_t unpack_ct(uint16_t *U, uint16_t *v, const unsigned char *packed_ct, const size_t U_els, const uint8_t U_bits, const size_t v_els, const uint8_t v_bits);
 
+    /**
+     * Unpacks a part of a packed sequence of elements (as used for the
+     * components of a ciphertext), i.e. elements _first_ up to _first + els_.
+     * Only the bytes holding these elements are read, so the packed data can
+     * be incomplete.
+     *
+     * @param[out] m         the unpacked elements
+     * @param[in]  packed    the packed elements
+     * @param[in]  first     the index of the first element to unpack
+     * @param[in]  els       the number of elements to unpack
+     * @param[in]  nr_bits   significant bits per element
+     * @return the number of bytes of the packed data holding elements up to _first + els_
+     */
+    size_t unpack_part(uint16_t *m, const unsigned char *packed, const size_t first, const size_t els, const uint8_t nr_bits);
+
+    /**
+     * The function to which `pack_ct_chunked()` passes the packed ciphertext.
+     *
+     * @param[in]  arg    the argument given to `pack_ct_chunked()`
+     * @param[in]  packed the next bytes of the packed ciphertext
+     * @param[in]  len    the number of bytes
+     */
+    typedef void (*pack_consumer)(void *arg, const unsigned char *packed, size_t len);
+
+    /**
+     * Packs a ciphertext like `pack_ct()`, but instead of writing it into one
+     * buffer, the packed bytes are passed on in small chunks to the consumer.
+     *
+     * @param[in]  U         matrix U
+     * @param[in]  U_els     elements in U
+     * @param[in]  U_bits    significant bits per element
+     * @param[in]  v         vector v
+     * @param[in]  v_els     elements in v
+     * @param[in]  v_bits    significant bits per element
+     * @param[in]  consumer  the function to which the packed bytes are passed
+     * @param[in]  arg       the argument for the consumer
+     * @return total packed bytes
+     */
+    size_t pack_ct_chunked(const uint16_t *U, size_t U_els, uint8_t U_bits, const uint16_t *v, size_t v_els, uint8_t v_bits, pack_consumer consumer, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
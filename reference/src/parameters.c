@@ -40,6 +40,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #include "pst_api.h"
 #include "api_to_internal_parameters.h"
@@ -98,11 +99,14 @@ int check_parameters(const parameters *params) {
     return 0;
 }
 
-/*******************************************************************************
- * Public functions
- ******************************************************************************/
-
-int set_parameters_from_api(parameters *params) {
+/**
+ * Sets the algorithm parameters according to the values from the (NIST) API
+ * setting macros in `api.h`, see `set_parameters_from_api()`.
+ *
+ * @param[out] params the algorithm parameters set up according to `api.h`
+ * @return __0__ if successful, error code otherwise
+ */
+static int setup_parameters_from_api(parameters *params) {
     const size_t nr_param_sets = sizeof (api_to_internal_parameters) / sizeof (api_to_internal_parameters[0]);
     size_t param_set;
     int err;
@@ -190,6 +194,75 @@ int set_parameters_from_api(parameters *params) {
     return err;
 }
 
+/** The number of predefined parameter sets */
+#define NR_PARAMETER_SETS (sizeof (api_to_internal_parameters) / sizeof (api_to_internal_parameters[0]))
+
+/** The parameters according to `api.h`, set up once */
+static parameters api_parameters;
+/** The result of setting up `api_parameters` */
+static int api_parameters_err;
+/** Makes sure `api_parameters` is set up only once */
+static pthread_once_t api_parameters_once = PTHREAD_ONCE_INIT;
+
+/** The predefined parameter sets, set up once */
+static parameters parameter_sets[NR_PARAMETER_SETS];
+/** Whether the corresponding predefined parameter set is valid */
+static int parameter_set_valid[NR_PARAMETER_SETS];
+/** Makes sure the predefined parameter sets are set up only once */
+static pthread_once_t parameter_sets_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Sets up `api_parameters`.
+ */
+static void init_api_parameters(void) {
+    api_parameters_err = setup_parameters_from_api(&api_parameters);
+}
+
+/**
+ * Sets up and checks the predefined parameter sets.
+ */
+static void init_parameter_sets(void) {
+    size_t set;
+
+    for (set = 0; set < NR_PARAMETER_SETS; ++set) {
+        parameter_set_valid[set] = !set_parameters(&parameter_sets[set],
+                (uint8_t) api_to_internal_parameters[set][POS_SS],
+                api_to_internal_parameters[set][POS_D],
+                api_to_internal_parameters[set][POS_N],
+                api_to_internal_parameters[set][POS_H],
+                api_to_internal_parameters[set][POS_Q],
+                (uint8_t) api_to_internal_parameters[set][POS_P_BITS],
+                (uint8_t) api_to_internal_parameters[set][POS_T_BITS],
+                api_to_internal_parameters[set][POS_N_BAR],
+                api_to_internal_parameters[set][POS_M_BAR],
+                (uint8_t) api_to_internal_parameters[set][POS_B]);
+    }
+}
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+int set_parameters_from_api(parameters *params) {
+    pthread_once(&api_parameters_once, init_api_parameters);
+    *params = api_parameters;
+
+    return api_parameters_err;
+}
+
+size_t nr_parameter_sets(void) {
+    return NR_PARAMETER_SETS;
+}
+
+const parameters *get_parameter_set(const size_t set) {
+    if (set >= NR_PARAMETER_SETS) {
+        return NULL;
+    }
+    pthread_once(&parameter_sets_once, init_parameter_sets);
+
+    return parameter_set_valid[set] ? &parameter_sets[set] : NULL;
+}
+
 int set_parameters(parameters *params, const uint8_t ss_size, const uint16_t d, const uint16_t n, const uint16_t h, const uint16_t q, const uint8_t p_bits, const uint8_t t_bits, const uint16_t n_bar, const uint16_t m_bar, const uint8_t B) {
     uint16_t tmp_q = q;
     uint8_t tmp_bits = 0;
@@ -38,6 +38,7 @@
 #ifndef PARAMETERS_H
 #define PARAMETERS_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -105,6 +106,25 @@ extern "C" {
      */
     int set_parameters_from_api(parameters *params);
 
+    /**
+     * Returns the number of predefined parameter sets, i.e. the sets of
+     * `api_to_internal_parameters.h`.
+     *
+     * @return the number of predefined parameter sets
+     */
+    size_t nr_parameter_sets(void);
+
+    /**
+     * Returns a handle to one of the predefined parameter sets, for use with
+     * the functions taking the parameters as argument (the `_p` functions).
+     * All sets are set up and checked once, on the first call, so that one
+     * process can use any of them without per-call setup.
+     *
+     * @param[in] set the index of the parameter set (in `api_to_internal_parameters.h`)
+     * @return the parameters of the set, `NULL` if there is no such (valid) set
+     */
+    const parameters *get_parameter_set(const size_t set);
+
     /**
      * Set the algorithm parameters as specified.
      *
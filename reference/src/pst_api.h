@@ -58,7 +58,9 @@ extern "C" {
 #endif
 
     /**
-     * Function to generate a fixed A matrix from the given seed.
+     * Function to generate a fixed A matrix from the given seed. There is one
+     * fixed A matrix at a time: using fn=1 with a parameter set of another
+     * dimension or modulus than the one it was generated for is an error.
      *
      * @param[in] seed      the seed to use to generate the fixed A matrix
      * @param[in] seed_size the size of the seed
@@ -47,6 +47,7 @@
 #include "drng.h"
 #include "hash.h"
 #include "a_fixed.h"
+#include "round2_probes.h"
 
 /*******************************************************************************
  * Private functions
@@ -59,7 +60,7 @@
  * @param len    length of the array
  * @return __0__ in case of success
  */
-static int radix_sort(uint32_t *arr, size_t len) {
+TARGET_CLONES static int radix_sort(uint32_t *arr, size_t len) {
     uint32_t *bucket = checked_malloc(2 * len * sizeof (*bucket));
     uint32_t ptr[2];
     size_t i, j;
@@ -149,7 +150,7 @@ static int create_spter_vec(int16_t *vector, const size_t len, const uint16_t h,
  * @param[in]  mod    reduction moduli for the coefficients
  * @return __0__ in case of success
  */
-static int mult_poly_mod_ntru(uint16_t *result, const int16_t *pol_a, const int16_t *pol_b, const size_t len, const uint16_t mod) {
+TARGET_CLONES static int mult_poly_mod_ntru(uint16_t *result, const int16_t *pol_a, const int16_t *pol_b, const size_t len, const uint16_t mod) {
     size_t i, j;
 
     for (i = 0; i < len; ++i) {
@@ -223,7 +224,7 @@ static int unlift_poly(uint16_t *cyc_pol, const uint16_t *ntru_pol, size_t len,
  * @param[in]  mod    reduction moduli for the coefficients
  * @return __0__ in case of success
  */
-static int mult_poly(uint16_t *result, const int16_t *pol_a, const int16_t *pol_b, const size_t len, const uint16_t mod) {
+TARGET_CLONES static int mult_poly(uint16_t *result, const int16_t *pol_a, const int16_t *pol_b, const size_t len, const uint16_t mod) {
     uint16_t *ntru_a;
     int16_t *ntru_b;
     uint16_t *ntru_res;
@@ -444,6 +445,8 @@ int create_A_fixed(const unsigned char *seed, const uint8_t seed_size, const par
 
     /* (Re)allocate space for A_fixed */
     A_fixed = realloc(A_fixed, len_a_fixed * sizeof (*A_fixed));
+    A_fixed_d = params->d;
+    A_fixed_q = params->q;
 
     /* Create A_fixed randomly */
     return create_A_random(A_fixed, len_a_fixed, seed, seed_size, params);
@@ -457,6 +460,8 @@ int create_A(uint16_t *A, const uint8_t fn, const unsigned char *sigma, const pa
     unsigned char *seed = checked_malloc(params->ss_size);
     const uint16_t els_row = (uint16_t) (params->k * params->n);
 
+    ROUND2_PROBE(create_A_entry, params, fn);
+
     /* Seed for generating A is hash(0x0000 | sigma) */
     prefixed_sigma[0] = 0;
     prefixed_sigma[1] = 0;
@@ -467,6 +472,11 @@ int create_A(uint16_t *A, const uint8_t fn, const unsigned char *sigma, const pa
     if (fn == 1) {
         if (A_fixed == NULL) {
             fprintf(stderr, "A_fixed has not been initialised, use create_A_fixed() to initialise it.\n");
+            exit(EXIT_FAILURE);
+        }
+        if (A_fixed_d != params->d || A_fixed_q != params->q) {
+            fprintf(stderr, "Error: A_fixed was created for d=%hu, q=%hu, not for d=%hu, q=%hu.\n", A_fixed_d, A_fixed_q, params->d, params->q);
+            exit(EXIT_FAILURE);
         }
         A_master = A_fixed;
     } else {
@@ -531,6 +541,8 @@ int create_A(uint16_t *A, const uint8_t fn, const unsigned char *sigma, const pa
     free(seed);
     free(prefixed_sigma);
 
+    ROUND2_PROBE(create_A_return, params, fn);
+
     return 0;
 }
 
@@ -539,6 +551,8 @@ int create_S_T(int16_t *S_T, const parameters *params) {
     size_t len = (size_t) (params->k * params->n);
     unsigned char *seed;
 
+    ROUND2_PROBE(create_S_entry, params, -1);
+
     seed = checked_malloc(params->ss_size);
 
     for (i = 0; i < params->n_bar; ++i) {
@@ -548,6 +562,8 @@ int create_S_T(int16_t *S_T, const parameters *params) {
 
     free(seed);
 
+    ROUND2_PROBE(create_S_return, params, -1);
+
     return 0;
 }
 
@@ -556,6 +572,8 @@ int create_R_T(int16_t *R_T, const unsigned char *rho, const parameters *params)
     size_t len = (size_t) (params->k * params->n);
     unsigned char *seed;
 
+    ROUND2_PROBE(create_R_entry, params, -1);
+
     seed = checked_malloc(params->ss_size);
     init_drng(rho, params->ss_size);
 
@@ -566,10 +584,12 @@ int create_R_T(int16_t *R_T, const unsigned char *rho, const parameters *params)
 
     free(seed);
 
+    ROUND2_PROBE(create_R_return, params, -1);
+
     return 0;
 }
 
-int mult_matrix(uint16_t *result, const int16_t *left, const size_t l_rows, const size_t l_cols, const int16_t *right, const size_t r_rows, const size_t r_cols, const size_t els, const uint16_t mod) {
+TARGET_CLONES int mult_matrix(uint16_t *result, const int16_t *left, const size_t l_rows, const size_t l_cols, const int16_t *right, const size_t r_rows, const size_t r_cols, const size_t els, const uint16_t mod) {
     size_t i, j, k;
     uint16_t *temp_poly = checked_malloc(els * sizeof (*temp_poly));
 
@@ -652,7 +672,7 @@ int decompress_matrix_base2(uint16_t *matrix, const size_t len, const size_t els
     return 0;
 }
 
-int transpose_matrix(uint16_t *matrix_t, const uint16_t *matrix, const size_t rows, const size_t cols, const size_t els) {
+TARGET_CLONES int transpose_matrix(uint16_t *matrix_t, const uint16_t *matrix, const size_t rows, const size_t cols, const size_t els) {
     size_t i, j, k;
 
     for (i = 0; i < rows; ++i) {
@@ -47,6 +47,8 @@
 #include "hash.h"
 #include "misc.h"
 #include "randombytes.h"
+#include "round2_stats.h"
+#include "round2_probes.h"
 
 /*******************************************************************************
  * Public functions
@@ -65,6 +67,9 @@ int round2_dem(unsigned char *c2, unsigned long long *c2_len, const unsigned cha
     unsigned char tag[16];
     unsigned char iv[12];
     uint64_t iv_tmp = ++iv_counter;
+    ROUND2_STATS_START(stats_start);
+
+    ROUND2_PROBE_DEM(dem_entry, key_len, m_len);
 
     /* Use 256 bits (32 bytes) of key as initial key, truncate/pad if necessary */
     memcpy(key_used, key, key_used_size);
@@ -124,6 +129,9 @@ int round2_dem(unsigned char *c2, unsigned long long *c2_len, const unsigned cha
 done_dem:
     EVP_CIPHER_CTX_free(ctx);
 
+    ROUND2_STATS_STOP(ROUND2_STATS_DEM, stats_start, result ? 0 : *c2_len);
+    ROUND2_PROBE_DEM(dem_return, key_len, result ? 0 : *c2_len);
+
     return result;
 }
 
@@ -138,6 +146,9 @@ int round2_dem_inverse(unsigned char *m, unsigned long long *m_len, const unsign
     unsigned char tag[16];
     const unsigned long long c2_len_no_tag_iv = c2_len - 16U - 12U;
     const unsigned char * const iv = c2 + c2_len - 12U;
+    ROUND2_STATS_START(stats_start);
+
+    ROUND2_PROBE_DEM(dem_inverse_entry, key_len, c2_len);
 
     /* Use 256 bits (32 bytes) of K as initial key, truncate/pad if necessary */
     memcpy(key_used, key, key_used_size);
@@ -187,5 +198,8 @@ int round2_dem_inverse(unsigned char *m, unsigned long long *m_len, const unsign
 done_decrypt:
     EVP_CIPHER_CTX_free(ctx);
 
+    ROUND2_STATS_STOP(ROUND2_STATS_DEM_INVERSE, stats_start, result ? 0 : *m_len);
+    ROUND2_PROBE_DEM(dem_inverse_return, key_len, result ? 0 : *m_len);
+
     return result;
 }
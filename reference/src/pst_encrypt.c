@@ -48,6 +48,8 @@
 #include "randombytes.h"
 #include "drng.h"
 #include "hash.h"
+#include "round2_stats.h"
+#include "round2_probes.h"
 
 /*******************************************************************************
  * Private functions
@@ -127,6 +129,28 @@ static int msg_to_bitstring(unsigned char *m, const uint16_t *msg_int, const siz
     return ++idx_bytes;
 }
 
+/**
+ * The state of an incremental encryption. The reference implementation simply
+ * collects the public key and encrypts at the end.
+ */
+struct encrypt_ctx {
+    parameters params; /**< The algorithm parameters in use */
+    unsigned char *rho; /**< Seed of R */
+    unsigned char *pk; /**< The public key received so far */
+    size_t pk_len; /**< The number of bytes of the public key received so far */
+};
+
+/**
+ * The state of an incremental decryption. The reference implementation simply
+ * collects the ciphertext and decrypts it at the end.
+ */
+struct decrypt_ctx {
+    parameters params; /**< The algorithm parameters in use */
+    unsigned char *sk; /**< The secret key */
+    unsigned char *c; /**< The ciphertext received so far */
+    size_t c_len; /**< The number of bytes of the ciphertext received so far */
+};
+
 /*******************************************************************************
  * Public functions
  ******************************************************************************/
@@ -141,6 +165,8 @@ int generate_keypair(unsigned char *pk, unsigned char *sk, const parameters *par
     size_t len_s;
     size_t len_b;
 
+    ROUND2_PROBE(generate_keypair_entry, params, fn);
+
     fn = (params->d == params->n) ? 3 : fn;
 
     /* Calculate sizes */
@@ -159,16 +185,24 @@ int generate_keypair(unsigned char *pk, unsigned char *sk, const parameters *par
     randombytes(sigma, params->ss_size);
 
     /* Create A from sigma */
+    ROUND2_STATS_START(create_A_start);
     create_A(A, fn, sigma, params);
+    ROUND2_STATS_STOP(ROUND2_STATS_CREATE_A, create_A_start, 0);
 
     /* Randomly generate S_T */
+    ROUND2_STATS_START(create_S_start);
     create_S_T(S_T, params);
+    ROUND2_STATS_STOP(ROUND2_STATS_CREATE_S, create_S_start, 0);
 
     /* Transpose S_T to get S */
     transpose_matrix((uint16_t *) S, (uint16_t *) S_T, params->n_bar, params->k, params->n);
 
     /* B = A * S */
+    ROUND2_STATS_START(compute_B_start);
+    ROUND2_PROBE(compute_B_entry, params, fn);
     mult_matrix(B, (int16_t *) A, params->k, params->k, S, params->k, params->n_bar, params->n, params->q);
+    ROUND2_PROBE(compute_B_return, params, fn);
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_B, compute_B_start, 0);
 
     /* Compress B q_bits -> p_bits */
     r_compress_matrix(B, (size_t) (params->k * params->n_bar), params->n, params->q, params->p, params->ss_size);
@@ -193,6 +227,8 @@ int generate_keypair(unsigned char *pk, unsigned char *sk, const parameters *par
     free(S_T);
     free(B);
 
+    ROUND2_PROBE(generate_keypair_return, params, fn);
+
     return 0;
 }
 
@@ -238,6 +274,8 @@ int encrypt_rho(unsigned char *c, const unsigned char *m, const unsigned char *r
     /* fn */
     uint8_t fn;
 
+    ROUND2_PROBE(encrypt_rho_entry, params, pk[0]);
+
     /* B is guaranteed to be divisor of 8! */
     mu = (size_t) (params->ss_size * 8 / params->B);
 
@@ -265,9 +303,13 @@ int encrypt_rho(unsigned char *c, const unsigned char *m, const unsigned char *r
     fn = (params->d == params->n) ? 3 : fn;
 
     /* Create A from sigma */
+    ROUND2_STATS_START(create_A_start);
     create_A(A, fn, sigma, params);
+    ROUND2_STATS_STOP(ROUND2_STATS_CREATE_A, create_A_start, 0);
     /* Create R_T from rho */
+    ROUND2_STATS_START(create_R_start);
     create_R_T(R_T, rho, params);
+    ROUND2_STATS_STOP(ROUND2_STATS_CREATE_R, create_R_start, 0);
     /* Create noise seeds EU and EV from rho */
     hash(eu_seed, rho, params->ss_size, params->ss_size);
 
@@ -278,13 +320,21 @@ int encrypt_rho(unsigned char *c, const unsigned char *m, const unsigned char *r
     transpose_matrix((uint16_t *) R, (uint16_t *) R_T, params->m_bar, params->k, params->n);
 
     /* U = A^T * R */
+    ROUND2_STATS_START(compute_U_start);
+    ROUND2_PROBE(compute_U_entry, params, fn);
     mult_matrix(U, (int16_t *) A_T, params->k, params->k, R, params->k, params->m_bar, params->n, params->q);
+    ROUND2_PROBE(compute_U_return, params, fn);
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_U, compute_U_start, 0);
     /* Compress U q_bits -> p_bits */
     compress_matrix(U, (size_t) (params->k * params->m_bar), params->n, params->q, params->p, eu_seed, params->ss_size);
     /* Transpose B */
     transpose_matrix(B_T, B, params->k, params->n_bar, params->n);
     /* X = B^T * R */
+    ROUND2_STATS_START(compute_X_start);
+    ROUND2_PROBE(compute_X_entry, params, fn);
     mult_matrix(X, (int16_t *) B_T, params->n_bar, params->k, R, params->k, params->m_bar, params->n, params->p);
+    ROUND2_PROBE(compute_X_return, params, fn);
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_X, compute_X_start, 0);
 
     /* v is a matrix of scalars, so we use 1 as the number of coefficients */
     r_compress_matrix_base2(&X[number_coeff - mu], mu, 1, params->p_bits, params->t_bits);
@@ -319,6 +369,18 @@ int encrypt_rho(unsigned char *c, const unsigned char *m, const unsigned char *r
     free(X);
     free(v);
 
+    ROUND2_PROBE(encrypt_rho_return, params, pk[0]);
+
+    return 0;
+}
+
+int encrypt_rho_multi(unsigned char *c, const size_t c_size, const unsigned char *m, const unsigned char *rho, const unsigned char *pk, const size_t nr_sessions, const parameters *params) {
+    size_t s;
+
+    for (s = 0; s < nr_sessions; ++s) {
+        encrypt_rho(c + s * c_size, m + s * params->ss_size, rho + s * params->ss_size, pk + s * params->pk_size, params);
+    }
+
     return 0;
 }
 
@@ -338,6 +400,8 @@ int decrypt(unsigned char *m, const unsigned char *c, const unsigned char *sk, c
 
     size_t number_coeff = (size_t) (params->n_bar * params->m_bar * params->n);
 
+    ROUND2_PROBE(decrypt_entry, params, -1);
+
     mu = (size_t) (params->ss_size * 8 / params->B);
 
     len_s = (size_t) (params->d * params->n_bar);
@@ -357,7 +421,11 @@ int decrypt(unsigned char *m, const unsigned char *c, const unsigned char *sk, c
     /* Decompress v t_bits -> p_bits */
     decompress_matrix_base2(v, len_v, 1, params->p_bits, params->t_bits);
     /* S_T_U = S^T * U */
+    ROUND2_STATS_START(compute_X_start);
+    ROUND2_PROBE(compute_X_prime_entry, params, -1);
     mult_matrix(tmp, S_T, params->n_bar, params->k, (int16_t *) U, params->k, params->m_bar, params->n, params->p);
+    ROUND2_PROBE(compute_X_prime_return, params, -1);
+    ROUND2_STATS_STOP(ROUND2_STATS_COMPUTE_X, compute_X_start, 0);
 
     /* v - Sample_mu(S^T * U) */
     diff_msg(msg_tmp, mu, v, &tmp[number_coeff - mu]);
@@ -382,5 +450,124 @@ int decrypt(unsigned char *m, const unsigned char *c, const unsigned char *sk, c
     free(tmp);
     free(msg_tmp);
 
+    ROUND2_PROBE(decrypt_return, params, -1);
+
+    return 0;
+}
+
+int decrypt_multi(unsigned char *m, const unsigned char *c, const size_t c_size, const unsigned char *sk, const size_t sk_size, const size_t nr_sessions, const parameters *params) {
+    size_t s;
+
+    for (s = 0; s < nr_sessions; ++s) {
+        decrypt(m + s * params->ss_size, c + s * c_size, sk + s * sk_size, params);
+    }
+
     return 0;
 }
+
+int encrypt_rho_verify(unsigned char *K, const unsigned char *c, const unsigned char *m, const unsigned char *rho, const unsigned char *suffix, const unsigned char *prefix_equal, const unsigned char *prefix_differ, const unsigned char *pk, const parameters *params) {
+    const size_t c_len = (size_t) (params->ct_size + params->ss_size);
+    unsigned char *c_prime = checked_malloc(c_len);
+    unsigned char *prefix = checked_malloc(params->ss_size);
+    unsigned char diff = 0;
+    unsigned char differ_mask;
+    hash_ctx *h;
+    size_t i;
+
+    /* c' = (U',v',suffix) */
+    encrypt_rho(c_prime, m, rho, pk, params);
+    memcpy(c_prime + params->ct_size, suffix, params->ss_size);
+
+    /* Compare c and c' and select the prefix (in constant time) */
+    for (i = 0; i < c_len; ++i) {
+        diff = (unsigned char) (diff | (c[i] ^ c_prime[i]));
+    }
+    differ_mask = (unsigned char) (-(int) (((unsigned) diff + 0xFFU) >> 8));
+    for (i = 0; i < params->ss_size; ++i) {
+        prefix[i] = (unsigned char) ((prefix_equal[i] & ~differ_mask) | (prefix_differ[i] & differ_mask));
+    }
+
+    /* K = H(prefix, c') */
+    h = hash_init();
+    hash_update(h, prefix, params->ss_size);
+    hash_update(h, c_prime, c_len);
+    hash_final(K, h, params->ss_size);
+
+    memset(prefix, 0, params->ss_size);
+    free(prefix);
+    free(c_prime);
+
+    return 0;
+}
+
+encrypt_ctx *encrypt_init(const unsigned char *rho, const parameters *params) {
+    encrypt_ctx *ctx = checked_calloc(1, sizeof (*ctx));
+
+    ctx->params = *params;
+    ctx->rho = checked_malloc(params->ss_size);
+    memcpy(ctx->rho, rho, params->ss_size);
+    ctx->pk = checked_malloc(params->pk_size);
+
+    return ctx;
+}
+
+int encrypt_feed(encrypt_ctx *ctx, const unsigned char *pk, const size_t pk_len) {
+    if (pk_len > ctx->params.pk_size - ctx->pk_len) {
+        return 1;
+    }
+    memcpy(ctx->pk + ctx->pk_len, pk, pk_len);
+    ctx->pk_len += pk_len;
+
+    return 0;
+}
+
+int encrypt_finish(unsigned char *c, const unsigned char *m, encrypt_ctx *ctx) {
+    const int result = ctx->pk_len != ctx->params.pk_size;
+
+    if (!result) {
+        encrypt_rho(c, m, ctx->rho, ctx->pk, &ctx->params);
+    }
+
+    memset(ctx->rho, 0, ctx->params.ss_size);
+    free(ctx->rho);
+    free(ctx->pk);
+    free(ctx);
+
+    return result;
+}
+
+decrypt_ctx *decrypt_init(const unsigned char *sk, const parameters *params) {
+    decrypt_ctx *ctx = checked_calloc(1, sizeof (*ctx));
+
+    ctx->params = *params;
+    ctx->sk = checked_malloc(params->sk_size);
+    memcpy(ctx->sk, sk, params->sk_size);
+    ctx->c = checked_malloc(params->ct_size);
+
+    return ctx;
+}
+
+int decrypt_feed(decrypt_ctx *ctx, const unsigned char *c, const size_t c_len) {
+    if (c_len > ctx->params.ct_size - ctx->c_len) {
+        return 1;
+    }
+    memcpy(ctx->c + ctx->c_len, c, c_len);
+    ctx->c_len += c_len;
+
+    return 0;
+}
+
+int decrypt_finish(unsigned char *m, decrypt_ctx *ctx) {
+    const int result = ctx->c_len != ctx->params.ct_size;
+
+    if (!result) {
+        decrypt(m, ctx->c, ctx->sk, &ctx->params);
+    }
+
+    memset(ctx->sk, 0, ctx->params.sk_size);
+    free(ctx->sk);
+    free(ctx->c);
+    free(ctx);
+
+    return result;
+}
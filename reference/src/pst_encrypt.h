@@ -39,6 +39,8 @@
 #ifndef PST_ENCRYPT_H
 #define PST_ENCRYPT_H
 
+#include <stddef.h>
+
 #include "parameters.h"
 
 #ifdef __cplusplus
@@ -79,6 +81,86 @@ extern "C" {
      */
     int encrypt_rho(unsigned char *c, const unsigned char *m, const unsigned char *rho, const unsigned char *pk, const parameters *params);
 
+    /**
+     * Encrypts the plaintexts of several independent sessions using the
+     * provided seeds for R, each with its own public key. The result is the
+     * same as that of `encrypt_rho()` for each session. Of the ring
+     * parameter sets, the optimized implementation unlifts the products of
+     * the sessions side by side, one session per lane, and compresses them
+     * at once. All other steps, the products with __A__ and __B__ included,
+     * are done session by session. The sessions of the non-ring parameter
+     * sets are encrypted one by one with `encrypt_rho()`.
+     *
+     * @param[out] c           ciphertexts, the one of session _s_ at _c + s * c_size_
+     * @param[in]  c_size      the distance between consecutive ciphertexts (at least `ct_size`)
+     * @param[in]  m           plaintexts, consecutive (of size `ss_size` each)
+     * @param[in]  rho         seeds of R, consecutive (of size `ss_size` each)
+     * @param[in]  pk          public keys, consecutive (of size `pk_size` each)
+     * @param[in]  nr_sessions the number of sessions
+     * @param[in]  params      the algorithm parameters to use
+     * @return __0__ in case of success
+     */
+    int encrypt_rho_multi(unsigned char *c, const size_t c_size, const unsigned char *m, const unsigned char *rho, const unsigned char *pk, const size_t nr_sessions, const parameters *params);
+
+    /**
+     * Re-encrypts a plaintext and derives a key depending on whether the
+     * result matches a given ciphertext, as needed for the decapsulation of a
+     * CCA KEM. With c' = (`encrypt_rho(m, rho, pk)`, suffix), the key is
+     * K = H(prefix_equal, c') if c equals c' and K = H(prefix_differ, c')
+     * otherwise. The comparison and the derivation of the key take the
+     * same time in both cases.
+     *
+     * @param[out] K             derived key (of size `ss_size`)
+     * @param[in]  c             the ciphertext to compare with (of size `ct_size` + `ss_size`)
+     * @param[in]  m             plaintext
+     * @param[in]  rho           seed of R
+     * @param[in]  suffix        the suffix of c' (of size `ss_size`)
+     * @param[in]  prefix_equal  the prefix of the hash input if c equals c' (of size `ss_size`)
+     * @param[in]  prefix_differ the prefix of the hash input if c differs from c' (of size `ss_size`)
+     * @param[in]  pk            public key with which the message is encrypted
+     * @param[in]  params        the algorithm parameters to use
+     * @return __0__ in case of success
+     */
+    int encrypt_rho_verify(unsigned char *K, const unsigned char *c, const unsigned char *m, const unsigned char *rho, const unsigned char *suffix, const unsigned char *prefix_equal, const unsigned char *prefix_differ, const unsigned char *pk, const parameters *params);
+
+    /**
+     * The state of an incremental encryption (opaque).
+     */
+    typedef struct encrypt_ctx encrypt_ctx;
+
+    /**
+     * Starts an incremental encryption, for a public key that is received in
+     * parts. The parts are passed to `encrypt_feed()`, after the last part
+     * `encrypt_finish()` produces the ciphertext.
+     *
+     * @param[in]  rho    seed of R
+     * @param[in]  params the algorithm parameters to use
+     * @return the state of the encryption
+     */
+    encrypt_ctx *encrypt_init(const unsigned char *rho, const parameters *params);
+
+    /**
+     * Passes the next part of the public key to an incremental encryption.
+     * As soon as fn and sigma have been received, A is created and U is
+     * computed, only X needs the remainder (B) of the public key.
+     *
+     * @param[in]  ctx    the state of the encryption
+     * @param[in]  pk     the next part of the public key
+     * @param[in]  pk_len the length of the part
+     * @return __0__ in case of success, __1__ if the part does not fit in the public key
+     */
+    int encrypt_feed(encrypt_ctx *ctx, const unsigned char *pk, const size_t pk_len);
+
+    /**
+     * Finishes an incremental encryption and releases its state.
+     *
+     * @param[out] c      ciphertext
+     * @param[in]  m      plaintext
+     * @param[in]  ctx    the state of the encryption
+     * @return __0__ in case of success, __1__ if the public key was incomplete
+     */
+    int encrypt_finish(unsigned char *c, const unsigned char *m, encrypt_ctx *ctx);
+
     /**
      * Decrypts a ciphertext.
      *
@@ -90,6 +172,68 @@ extern "C" {
      */
     int decrypt(unsigned char *m, const unsigned char *c, const unsigned char *sk, const parameters *params);
 
+    /**
+     * Decrypts the ciphertexts of several independent sessions, each with
+     * its own secret key or all with the same one. The result is the same as
+     * that of `decrypt()` for each session. Of the ring parameter sets, the
+     * optimized implementation unlifts the products of the sessions side by
+     * side, one session per lane. With a single secret key, it computes the
+     * products with __U__ side by side as well (see
+     * `compute_X_sessions_shared()`), otherwise session by session. The
+     * sessions of the non-ring parameter sets are decrypted one by one with
+     * `decrypt()`.
+     *
+     * @param[out] m           plaintexts, consecutive (of size `ss_size` each)
+     * @param[in]  c           ciphertexts, the one of session _s_ at _c + s * c_size_
+     * @param[in]  c_size      the distance between consecutive ciphertexts (at least `ct_size`)
+     * @param[in]  sk          secret keys, the one of session _s_ at _sk + s * sk_size_
+     * @param[in]  sk_size     the distance between consecutive secret keys (at least `sk_size`), 0 if the sessions share one
+     * @param[in]  nr_sessions the number of sessions
+     * @param[in]  params      the algorithm parameters to use
+     * @return __0__ in case of success
+     */
+    int decrypt_multi(unsigned char *m, const unsigned char *c, const size_t c_size, const unsigned char *sk, const size_t sk_size, const size_t nr_sessions, const parameters *params);
+
+    /**
+     * The state of an incremental decryption (opaque).
+     */
+    typedef struct decrypt_ctx decrypt_ctx;
+
+    /**
+     * Starts an incremental decryption, for a ciphertext that is received in
+     * parts. The parts are passed to `decrypt_feed()`, after the last part
+     * `decrypt_finish()` produces the plaintext.
+     *
+     * @param[in]  sk     secret key with which the message is decrypted
+     * @param[in]  params the algorithm parameters to use
+     * @return the state of the decryption
+     */
+    decrypt_ctx *decrypt_init(const unsigned char *sk, const parameters *params);
+
+    /**
+     * Passes the next part of the ciphertext to an incremental decryption.
+     * As much of the decryption as possible is done with the data received so
+     * far: in the non-ring case, X' is accumulated over the rows of U that
+     * have been completed by the part. Each row of U is processed once, so
+     * the total work does not depend on how the ciphertext is split, and the
+     * work per row does not depend on the secret key.
+     *
+     * @param[in]  ctx    the state of the decryption
+     * @param[in]  c      the next part of the ciphertext
+     * @param[in]  c_len  the length of the part
+     * @return __0__ in case of success, __1__ if the part does not fit in the ciphertext
+     */
+    int decrypt_feed(decrypt_ctx *ctx, const unsigned char *c, const size_t c_len);
+
+    /**
+     * Finishes an incremental decryption and releases its state.
+     *
+     * @param[out] m      plaintext
+     * @param[in]  ctx    the state of the decryption
+     * @return __0__ in case of success, __1__ if the ciphertext was incomplete
+     */
+    int decrypt_finish(unsigned char *m, decrypt_ctx *ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -64,16 +64,24 @@ static int urandom = -1;
 
 int randombytes(unsigned char *x, unsigned long long xlen) {
     ssize_t s;
+    int fd = __atomic_load_n(&urandom, __ATOMIC_ACQUIRE);
 
-    /* Open /dev/urandom (if not already done) */
-    while (urandom == -1) {
-        urandom = open("/dev/urandom", O_RDONLY);
-        if (urandom == -1) sleep(1); /* Wait a bit before retrying */
+    /* Open /dev/urandom (if not already done). When several threads race to
+     * open it, only the first descriptor is kept, the others are closed. */
+    while (fd == -1) {
+        int expected = -1;
+        fd = open("/dev/urandom", O_RDONLY);
+        if (fd == -1) {
+            sleep(1); /* Wait a bit before retrying */
+        } else if (!__atomic_compare_exchange_n(&urandom, &expected, fd, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            close(fd);
+            fd = expected;
+        }
     }
 
     /* Get the random bytes in chunks */
     while (xlen > 0) {
-        s = read(urandom, x, (size_t) (xlen < CHUNK_SIZE ? xlen : CHUNK_SIZE));
+        s = read(fd, x, (size_t) (xlen < CHUNK_SIZE ? xlen : CHUNK_SIZE));
         /* Note: we completely ignore read errors (these really should never
          * occur with /dev/urandom anyway) and retry until successful. */
         if (s >= 0) {
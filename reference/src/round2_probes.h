@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of the static tracing probes (USDT) of the library.
+ *
+ * When compiled with `ROUND2_USDT` set to 1 (which requires `sys/sdt.h`,
+ * e.g. from SystemTap), the library has probes in the `round2` provider at
+ * the entry and return of the key generation, encryption and decryption
+ * (`generate_keypair`, `encrypt_rho`, `decrypt`), the CCA KEM encapsulation
+ * and decapsulation (`cca_kem_enc`, `cca_kem_dec`), the DEM (`dem`,
+ * `dem_inverse`), and the kernels of `pst_core.c`, named after them
+ * (`create_A`, `create_S`, `create_R`, `compute_B`, `compute_U`,
+ * `compute_X`, `compute_X_prime`, and, in the optimized implementation,
+ * their variants such as `compute_B_fn2`). The reference implementation
+ * computes __B__, __U__, __X__ and __X'__ with `mult_matrix()`, so there
+ * these probes are around its calls. E.g. `round2:encrypt_rho_entry` and
+ * `round2:encrypt_rho_return`.
+ *
+ * The arguments of the probes are the parameters _d_, _n_, _h_ and _q_, the
+ * variant of A (fn, -1 where it does not apply or is unknown), and a pointer
+ * to the parameters. The DEM probes have the key length and the length of
+ * the input (entry) or output (return, 0 on failure) as arguments instead.
+ * Probes are a single `nop` until a tracer (e.g. bpftrace or perf) attaches
+ * to them.
+ *
+ * With `ROUND2_USDT` 0 (the default) the probes are compiled out.
+ */
+
+#ifndef ROUND2_PROBES_H
+#define ROUND2_PROBES_H
+
+#ifndef ROUND2_USDT
+/** Enables (1) or disables (0) the static tracing probes. */
+#define ROUND2_USDT 0
+#endif
+
+#if ROUND2_USDT
+
+#include <sys/sdt.h>
+
+/** Fires the probe `round2:name` for the given parameters and variant of A. */
+#define ROUND2_PROBE(name, params, fn) DTRACE_PROBE6(round2, name, (params)->d, (params)->n, (params)->h, (params)->q, (int) (fn), (params))
+/** Fires the DEM probe `round2:name` for the given key and input length. */
+#define ROUND2_PROBE_DEM(name, key_len, len) DTRACE_PROBE2(round2, name, (key_len), (len))
+
+#else
+
+#define ROUND2_PROBE(name, params, fn) ((void) 0)
+#define ROUND2_PROBE_DEM(name, key_len, len) ((void) 0)
+
+#endif
+
+#endif /* ROUND2_PROBES_H */
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the internal statistics of the library.
+ *
+ * Each thread counts into a block of its own, which it claims on its first
+ * count and releases when it exits, after which another thread can claim it
+ * (and continue counting in it). The blocks are kept in a list that only
+ * grows, so a snapshot can add them up while the threads keep counting.
+ * Since each block has a single writer at any time, the counters are
+ * updated with plain atomic stores rather than read-modify-write
+ * operations.
+ *
+ * @endcond
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "round2_stats.h"
+
+#include <string.h>
+#include <inttypes.h>
+
+#if ROUND2_STATS
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "misc.h"
+#endif
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/** The names of the stages */
+static const char * const stage_names[ROUND2_STATS_NR_COUNTERS] = {
+    "drng",
+    "hash",
+    "alloc",
+    "create_A",
+    "create_S",
+    "create_R",
+    "compute_B",
+    "compute_U",
+    "compute_X",
+    "pack",
+    "unpack",
+    "dem",
+    "dem_inverse"
+};
+
+#if ROUND2_STATS
+
+/**
+ * The counters of (at any time) one thread.
+ */
+typedef struct stats_block {
+    round2_stats stats; /**< The counters of the thread */
+    struct stats_block *next; /**< The next block in the list of all blocks */
+    int in_use; /**< Whether a thread counts in the block */
+} stats_block;
+
+/** The list of all blocks (accessed atomically) */
+static stats_block *blocks = NULL;
+
+/** The block of the current thread */
+static THREAD_LOCAL stats_block *thread_block = NULL;
+
+/** Creation of the key used to release the blocks of exiting threads */
+static pthread_once_t release_key_once = PTHREAD_ONCE_INIT;
+
+/** The key used to release the blocks of exiting threads */
+static pthread_key_t release_key;
+
+/** Protects the baseline */
+static pthread_mutex_t baseline_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** The totals at the last reset */
+static round2_stats baseline;
+
+/**
+ * Releases the block of an exiting thread, so that another thread can
+ * claim it.
+ *
+ * @param[in] block the block to release
+ */
+static void release_block(void *block) {
+    __atomic_store_n(&((stats_block *) block)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Creates the key used to release the blocks of exiting threads.
+ */
+static void create_release_key(void) {
+    pthread_key_create(&release_key, release_block);
+}
+
+/**
+ * Claims a released block for the current thread, or adds a new one to the
+ * list if there is none.
+ *
+ * @return the block of the current thread
+ */
+static stats_block *claim_block(void) {
+    stats_block *block;
+
+    for (block = __atomic_load_n(&blocks, __ATOMIC_ACQUIRE); block != NULL; block = block->next) {
+        int released = 0;
+        if (__atomic_compare_exchange_n(&block->in_use, &released, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (block == NULL) {
+        /* Not checked_calloc(), as that counts the allocation */
+        block = calloc(1, sizeof (*block));
+        if (block == NULL) {
+            fprintf(stderr, "Could not allocate the statistics of a thread\n");
+            exit(EXIT_FAILURE);
+        }
+        block->in_use = 1;
+        block->next = __atomic_load_n(&blocks, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&blocks, &block->next, block, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    pthread_once(&release_key_once, create_release_key);
+    pthread_setspecific(release_key, block);
+
+    return block;
+}
+
+/**
+ * Adds up the counters of all blocks.
+ *
+ * @param[out] totals the totals
+ */
+static void add_up_blocks(round2_stats *totals) {
+    const stats_block *block;
+    size_t i;
+
+    memset(totals, 0, sizeof (*totals));
+    for (block = __atomic_load_n(&blocks, __ATOMIC_ACQUIRE); block != NULL; block = block->next) {
+        for (i = 0; i < ROUND2_STATS_NR_COUNTERS; ++i) {
+            totals->counter[i].calls += __atomic_load_n(&block->stats.counter[i].calls, __ATOMIC_RELAXED);
+            totals->counter[i].cycles += __atomic_load_n(&block->stats.counter[i].cycles, __ATOMIC_RELAXED);
+            totals->counter[i].bytes += __atomic_load_n(&block->stats.counter[i].bytes, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+#endif
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+#if ROUND2_STATS
+
+uint64_t round2_stats_ticks(void) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000U + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+void round2_stats_add(const round2_stats_stage stage, const uint64_t ticks, const uint64_t bytes) {
+    round2_stats_counter *counter;
+
+    if (thread_block == NULL) {
+        thread_block = claim_block();
+    }
+    counter = &thread_block->stats.counter[stage];
+
+    __atomic_store_n(&counter->calls, counter->calls + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&counter->cycles, counter->cycles + ticks, __ATOMIC_RELAXED);
+    __atomic_store_n(&counter->bytes, counter->bytes + bytes, __ATOMIC_RELAXED);
+}
+
+void round2_stats_snapshot(round2_stats *stats) {
+    size_t i;
+
+    add_up_blocks(stats);
+    pthread_mutex_lock(&baseline_lock);
+    for (i = 0; i < ROUND2_STATS_NR_COUNTERS; ++i) {
+        stats->counter[i].calls -= baseline.counter[i].calls;
+        stats->counter[i].cycles -= baseline.counter[i].cycles;
+        stats->counter[i].bytes -= baseline.counter[i].bytes;
+    }
+    pthread_mutex_unlock(&baseline_lock);
+}
+
+void round2_stats_reset(void) {
+    pthread_mutex_lock(&baseline_lock);
+    add_up_blocks(&baseline);
+    pthread_mutex_unlock(&baseline_lock);
+}
+
+#else
+
+void round2_stats_snapshot(round2_stats *stats) {
+    memset(stats, 0, sizeof (*stats));
+}
+
+void round2_stats_reset(void) {
+}
+
+#endif
+
+const char *round2_stats_name(const round2_stats_stage stage) {
+    return stage < ROUND2_STATS_NR_COUNTERS ? stage_names[stage] : "unknown";
+}
+
+int round2_stats_print_text(const round2_stats *stats, FILE *output) {
+    size_t i;
+
+    fprintf(output, "%-12s %14s %20s %20s\n", "Stage", "Calls", "Cycles", "Bytes");
+    for (i = 0; i < ROUND2_STATS_NR_COUNTERS; ++i) {
+        const round2_stats_counter *counter = &stats->counter[i];
+        if (counter->calls != 0) {
+            fprintf(output, "%-12s %14" PRIu64 " %20" PRIu64 " %20" PRIu64 "\n", stage_names[i], counter->calls, counter->cycles, counter->bytes);
+        }
+    }
+
+    return 0;
+}
+
+int round2_stats_print_json(const round2_stats *stats, FILE *output) {
+    size_t i;
+
+    fprintf(output, "{");
+    for (i = 0; i < ROUND2_STATS_NR_COUNTERS; ++i) {
+        const round2_stats_counter *counter = &stats->counter[i];
+        fprintf(output, "%s\"%s\": {\"calls\": %" PRIu64 ", \"cycles\": %" PRIu64 ", \"bytes\": %" PRIu64 "}", i > 0 ? ", " : "", stage_names[i], counter->calls, counter->cycles, counter->bytes);
+    }
+    fprintf(output, "}");
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of the internal statistics of the library (round2_stats).
+ *
+ * When compiled with `ROUND2_STATS` set to 1, the library counts the calls,
+ * time spent (in cpu cycles on x86, in nanoseconds elsewhere), and bytes
+ * processed of its internal stages: the bytes produced by the DRNG, the
+ * bytes hashed, the allocations made, the creation of __A__, __S__ and
+ * __R__, the computation of __B__, __U__ and __X__, the (un)packing, and
+ * the DEM. The counters are kept per thread, without locks; a snapshot adds
+ * up those of all threads.
+ *
+ * With `ROUND2_STATS` 0 (the default) the instrumentation is compiled out
+ * and the snapshots are all zero.
+ */
+
+#ifndef ROUND2_STATS_H
+#define ROUND2_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef ROUND2_STATS
+/** Enables (1) or disables (0) the collection of the internal statistics. */
+#define ROUND2_STATS 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * The counted stages.
+     */
+    typedef enum {
+        ROUND2_STATS_DRNG, /**< Deterministic random bytes generated (`drng()`) */
+        ROUND2_STATS_HASH, /**< Bytes hashed (`hash()`, `hash_update()`) */
+        ROUND2_STATS_ALLOC, /**< Memory allocated (`checked_malloc()` and friends) */
+        ROUND2_STATS_CREATE_A, /**< Creation of A */
+        ROUND2_STATS_CREATE_S, /**< Creation of S */
+        ROUND2_STATS_CREATE_R, /**< Creation of R */
+        ROUND2_STATS_COMPUTE_B, /**< Computation of B = A * S */
+        ROUND2_STATS_COMPUTE_U, /**< Computation of U = A^T * R */
+        ROUND2_STATS_COMPUTE_X, /**< Computation of X = B^T * R and X' = S^T * U */
+        ROUND2_STATS_PACK, /**< Packing of keys and ciphertexts (bytes produced) */
+        ROUND2_STATS_UNPACK, /**< Unpacking of keys and ciphertexts (bytes consumed) */
+        ROUND2_STATS_DEM, /**< DEM encryption (bytes of ciphertext produced) */
+        ROUND2_STATS_DEM_INVERSE, /**< DEM decryption (bytes of message produced) */
+        ROUND2_STATS_NR_COUNTERS /**< The number of counted stages */
+    } round2_stats_stage;
+
+    /**
+     * The counters of a stage.
+     */
+    typedef struct {
+        uint64_t calls; /**< The number of calls */
+        uint64_t cycles; /**< The time spent (0 for the allocations) */
+        uint64_t bytes; /**< The number of bytes processed (0 for the matrix stages) */
+    } round2_stats_counter;
+
+    /**
+     * A snapshot of the counters of all stages.
+     */
+    typedef struct {
+        round2_stats_counter counter[ROUND2_STATS_NR_COUNTERS]; /**< The counters, indexed by stage */
+    } round2_stats;
+
+    /**
+     * Takes a snapshot of the counters of all threads, since the last reset.
+     *
+     * @param[out] stats the snapshot
+     */
+    void round2_stats_snapshot(round2_stats *stats);
+
+    /**
+     * Resets the counters of all threads (to be precise: subsequent snapshots
+     * only count what happened after the reset).
+     */
+    void round2_stats_reset(void);
+
+    /**
+     * Returns the name of a stage as used in the text and JSON output.
+     *
+     * @param[in] stage the stage
+     * @return the name of the stage
+     */
+    const char *round2_stats_name(const round2_stats_stage stage);
+
+    /**
+     * Prints a snapshot as a table, one line per stage that was called.
+     *
+     * @param[in] stats  the snapshot
+     * @param[in] output the stream to print to
+     * @return __0__ in case of success
+     */
+    int round2_stats_print_text(const round2_stats *stats, FILE *output);
+
+    /**
+     * Prints a snapshot as a JSON object (on one line, without a newline),
+     * with an object of `calls`, `cycles` and `bytes` per stage.
+     *
+     * @param[in] stats  the snapshot
+     * @param[in] output the stream to print to
+     * @return __0__ in case of success
+     */
+    int round2_stats_print_json(const round2_stats *stats, FILE *output);
+
+#if ROUND2_STATS
+
+    /**
+     * Reads the clock used for the time spent in the stages (used by the
+     * instrumentation).
+     *
+     * @return the cycle counter on x86, the monotonic time in nanoseconds
+     *         elsewhere
+     */
+    uint64_t round2_stats_ticks(void);
+
+    /**
+     * Adds a call to the counters of the calling thread (used by the
+     * instrumentation).
+     *
+     * @param[in] stage  the stage
+     * @param[in] ticks  the time spent in the call
+     * @param[in] bytes  the number of bytes processed by the call
+     */
+    void round2_stats_add(const round2_stats_stage stage, const uint64_t ticks, const uint64_t bytes);
+
+/** Starts timing a stage, declaring `start` to hold its start time. */
+#define ROUND2_STATS_START(start) const uint64_t start = round2_stats_ticks()
+/** Stops timing a stage started with `ROUND2_STATS_START(start)` and counts the call. */
+#define ROUND2_STATS_STOP(stage, start, bytes) round2_stats_add((stage), round2_stats_ticks() - (start), (uint64_t) (bytes))
+/** Counts an untimed call of a stage. */
+#define ROUND2_STATS_COUNT(stage, bytes) round2_stats_add((stage), 0, (uint64_t) (bytes))
+
+#else
+
+#define ROUND2_STATS_START(start) ((void) 0)
+#define ROUND2_STATS_STOP(stage, start, bytes) ((void) 0)
+#define ROUND2_STATS_COUNT(stage, bytes) ((void) 0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ROUND2_STATS_H */
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the intra-operation parallelism test of the speed tests.
+ *
+ * The thread pool is a minimal one: its threads wait for a computation and
+ * claim its parts one at a time (atomically), as does the caller, which
+ * waits until all parts have been computed and no thread claims parts any
+ * more. A computation is only set up while no thread claims parts.
+ *
+ * @endcond
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "parallel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "api.h"
+#include "cpa_kem.h"
+#include "cca_encrypt.h"
+#include "hdr_histogram.h"
+#include "pst_core.h"
+#include "test_utils.h"
+#include "misc.h"
+
+#ifdef PST_CORE_PARALLEL
+
+#include "pst_parallel.h"
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/** The number of timed operations of a handshake */
+#define NR_OPERATIONS 3
+
+/** The highest latency (in nanoseconds) the histograms can hold */
+#define HIGHEST_LATENCY 1000000000000ULL
+
+/** The names of the timed operations, as used in the output */
+static const char *operation_names[] = {"keygen", "enc", "dec"};
+
+/** The message encrypted by the PKE */
+static const char parallel_message[] = "This is the message to be encrypted.";
+
+/** A thread pool */
+typedef struct {
+    pthread_mutex_t lock; /**< Protects the computation and the flags */
+    pthread_cond_t work; /**< Signalled when a computation is started or the pool stops */
+    pthread_cond_t done; /**< Signalled when all parts have been computed */
+    pthread_t *threads; /**< The threads (besides the caller) */
+    size_t nr_threads; /**< The number of threads (besides the caller) */
+    pst_parallel_task task; /**< Computes a part of the computation */
+    void *context; /**< The computation */
+    size_t nr_parts; /**< The number of parts of the computation */
+    size_t next_part; /**< The next part to compute (accessed atomically) */
+    size_t finished; /**< The number of parts computed (accessed atomically) */
+    size_t active; /**< The number of threads computing parts */
+    unsigned long generation; /**< The number of computations started */
+    int stop; /**< Set when the pool stops */
+} thread_pool;
+
+/**
+ * Computes parts of the current computation of the pool until all have been
+ * claimed.
+ *
+ * @param[in,out] pool the thread pool
+ */
+static void compute_parts(thread_pool *pool) {
+    size_t part;
+
+    while ((part = __atomic_fetch_add(&pool->next_part, 1, __ATOMIC_ACQ_REL)) < pool->nr_parts) {
+        pool->task(part, pool->context);
+        if (__atomic_add_fetch(&pool->finished, 1, __ATOMIC_ACQ_REL) == pool->nr_parts) {
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_signal(&pool->done);
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+}
+
+/**
+ * Runs a thread of the pool: computes parts of each computation started.
+ *
+ * @param[in,out] arg the thread pool (`thread_pool`)
+ * @return `NULL`
+ */
+static void *run_pool_thread(void *arg) {
+    thread_pool *pool = arg;
+    unsigned long generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == generation) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+        generation = pool->generation;
+        ++pool->active;
+        pthread_mutex_unlock(&pool->lock);
+        compute_parts(pool);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/**
+ * Runs a computation on the pool, see `pst_thread_pool_run`.
+ *
+ * @param[in,out] arg       the thread pool (`thread_pool`)
+ * @param[in]     nr_parts  the number of parts
+ * @param[in]     task      computes a part
+ * @param[in,out] context   the computation, passed to _task_
+ */
+static void run_on_pool(void *arg, const size_t nr_parts, pst_parallel_task task, void *context) {
+    thread_pool *pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    /* Threads that woke up for the previous computation after it was
+     * finished may still be looking for parts of it */
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pool->task = task;
+    pool->context = context;
+    pool->nr_parts = nr_parts;
+    __atomic_store_n(&pool->finished, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->next_part, 0, __ATOMIC_RELAXED);
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    compute_parts(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (__atomic_load_n(&pool->finished, __ATOMIC_ACQUIRE) < nr_parts || pool->active > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Creates a thread pool.
+ *
+ * @param[in] nr_threads the number of threads, including the caller
+ * @return the thread pool
+ */
+static thread_pool *create_pool(const unsigned int nr_threads) {
+    thread_pool *pool = checked_calloc(1, sizeof (*pool));
+    size_t i;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->nr_threads = nr_threads - 1;
+    pool->threads = checked_calloc(pool->nr_threads + 1, sizeof (*pool->threads));
+    for (i = 0; i < pool->nr_threads; ++i) {
+        if (pthread_create(&pool->threads[i], NULL, run_pool_thread, pool)) {
+            fprintf(stderr, "Could not create thread %zu\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return pool;
+}
+
+/**
+ * Stops the threads of a thread pool and frees it.
+ *
+ * @param[in,out] pool the thread pool
+ */
+static void destroy_pool(thread_pool *pool) {
+    size_t i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (i = 0; i < pool->nr_threads; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool);
+}
+
+/**
+ * Runs the handshakes for one number of threads and prints the results.
+ *
+ * @param[in]     params          the algorithm parameters in use
+ * @param[in]     fn              the variant to use for the creation of A
+ * @param[in]     nr_threads      the number of threads
+ * @param[in]     nr_test_repeats the number of timed handshakes
+ * @param[in]     nr_warm_ups     the number of untimed handshakes before these
+ * @param[in,out] base_median     the median latencies of a single thread
+ *                                (set when `nr_threads` is 1)
+ * @return the number of failed handshakes
+ */
+static unsigned int run_pool(const parameters *params, const uint8_t fn, const unsigned int nr_threads, const unsigned int nr_test_repeats, const unsigned int nr_warm_ups, double *base_median) {
+    const int is_kem = CRYPTO_CIPHERTEXTBYTES != 0;
+    const unsigned long long message_len = sizeof (parallel_message);
+    const size_t sk_len = is_kem ? params->sk_size : (size_t) (params->sk_size + params->ss_size + params->pk_size);
+    const size_t ct_len = is_kem ? params->ct_size : (size_t) (params->ct_size + params->ss_size + 16 + 12) + (size_t) message_len;
+    unsigned char *pk = checked_malloc(params->pk_size);
+    unsigned char *sk = checked_malloc(sk_len);
+    unsigned char *ct = checked_malloc(ct_len);
+    unsigned char *ss_r = checked_malloc(params->ss_size);
+    unsigned char *ss_i = checked_malloc(params->ss_size);
+    unsigned char *m = checked_malloc(message_len);
+    thread_pool *pool = create_pool(nr_threads);
+    hdr_histogram *latency[NR_OPERATIONS];
+    unsigned long long c_len, m_len;
+    uint64_t start, t[NR_OPERATIONS];
+    unsigned int failures = 0, i, op;
+
+    for (op = 0; op < NR_OPERATIONS; ++op) {
+        latency[op] = hdr_create(1, HIGHEST_LATENCY, 3);
+    }
+    pst_parallel_set_pool(run_on_pool, pool, nr_threads);
+    for (i = 0; i < nr_warm_ups + nr_test_repeats; ++i) {
+        int ok;
+        start = clock_ns();
+        if (is_kem) {
+            crypto_kem_keypair_p(pk, sk, params, fn);
+            t[0] = clock_ns();
+            crypto_kem_enc_p(ct, ss_r, pk, params);
+            t[1] = clock_ns();
+            crypto_kem_dec_p(ss_i, ct, sk, params);
+            t[2] = clock_ns();
+            ok = memcmp(ss_r, ss_i, params->ss_size) == 0;
+        } else {
+            crypto_encrypt_keypair_p(pk, sk, params, fn);
+            t[0] = clock_ns();
+            crypto_encrypt_p(ct, &c_len, (const unsigned char *) parallel_message, message_len, pk, params);
+            t[1] = clock_ns();
+            crypto_encrypt_open_p(m, &m_len, ct, c_len, sk, params);
+            t[2] = clock_ns();
+            ok = m_len == message_len && memcmp(m, parallel_message, message_len) == 0;
+        }
+        if (!ok) {
+            ++failures;
+        }
+        if (i >= nr_warm_ups) {
+            hdr_record(latency[0], t[0] - start);
+            hdr_record(latency[1], t[1] - t[0]);
+            hdr_record(latency[2], t[2] - t[1]);
+        }
+    }
+    pst_parallel_set_pool(NULL, NULL, 0);
+    destroy_pool(pool);
+
+    printf("%7u", nr_threads);
+    for (op = 0; op < NR_OPERATIONS; ++op) {
+        const double median = (double) hdr_value_at_percentile(latency[op], 50) / 1000.0;
+        if (nr_threads == 1) {
+            base_median[op] = median;
+        }
+        printf(" %11.1f %11.1f %8.2f", median, (double) hdr_value_at_percentile(latency[op], 99) / 1000.0, median > 0 ? base_median[op] / median : 0.0);
+        hdr_destroy(latency[op]);
+    }
+    printf(" %8u\n", failures);
+
+    free(pk);
+    free(sk);
+    free(ct);
+    free(ss_r);
+    free(ss_i);
+    free(m);
+
+    return failures;
+}
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+unsigned int speedtest_parallel(const parameters *params, const uint8_t fn, unsigned int max_threads, const unsigned int nr_test_repeats, const unsigned int nr_warm_ups) {
+    double base_median[NR_OPERATIONS] = {0};
+    unsigned int nr_failed = 0;
+    unsigned int nr_threads, op;
+
+    if (max_threads == 0) {
+        const long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        max_threads = nr_cpus > 0 ? (unsigned int) nr_cpus : 1;
+    }
+
+    printf("Latency of single operations on a pool of up to %u threads, %u handshakes per number of threads\n\n", max_threads, nr_test_repeats);
+    printf("%7s", "Threads");
+    for (op = 0; op < NR_OPERATIONS; ++op) {
+        printf(" %7s p50 %7s p99 %8s", operation_names[op], operation_names[op], "Speedup");
+    }
+    printf(" %8s  (us)\n", "Failures");
+    for (nr_threads = 1; nr_threads <= max_threads; nr_threads = nr_threads < max_threads && 2 * nr_threads > max_threads ? max_threads : 2 * nr_threads) {
+        nr_failed += run_pool(params, fn, nr_threads, nr_test_repeats, nr_warm_ups, base_median);
+        if (nr_threads == max_threads) {
+            break;
+        }
+    }
+    printf("\n");
+
+    return nr_failed;
+}
+
+#else
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+unsigned int speedtest_parallel(const parameters *params, const uint8_t fn, unsigned int max_threads, const unsigned int nr_test_repeats, const unsigned int nr_warm_ups) {
+    (void) params;
+    (void) fn;
+    (void) max_threads;
+    (void) nr_test_repeats;
+    (void) nr_warm_ups;
+    fprintf(stderr, "The parallelism test needs the optimized implementation\n");
+
+    return 1;
+}
+
+#endif
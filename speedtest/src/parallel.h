@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Declaration of the intra-operation parallelism test of the speed tests.
+ *
+ * @endcond
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "parameters.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * Runs the intra-operation parallelism test: for 1, 2, 4, ... up to
+     * `max_threads` threads (and `max_threads` itself), single operations
+     * (key generation, encapsulation/encryption, decapsulation/decryption)
+     * are run one at a time, each spread over a thread pool of that many
+     * threads. For each number of threads the median and 99th percentile
+     * latency of the operations, and the speedup of the median with respect
+     * to a single thread, are printed. Only available with the optimized
+     * implementation.
+     *
+     * @param[in] params          the algorithm parameters in use
+     * @param[in] fn              the variant to use for the creation of A
+     * @param[in] max_threads     the maximum number of threads, __0__ for the
+     *                            number of online cpus
+     * @param[in] nr_test_repeats the number of handshakes per number of threads
+     * @param[in] nr_warm_ups     the number of untimed handshakes before these
+     * @return the number of handshakes that failed
+     */
+    unsigned int speedtest_parallel(const parameters *params, const uint8_t fn, unsigned int max_threads, const unsigned int nr_test_repeats, const unsigned int nr_warm_ups);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PARALLEL_H */
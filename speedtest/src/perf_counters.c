@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the hardware performance counter functions of the speed
+ * tests.
+ *
+ * The counters are opened individually, not as a group, so that the kernel
+ * can multiplex them when the PMU has fewer counters than requested. Their
+ * values are then scaled with the ratio of the time they were enabled to the
+ * time they actually counted.
+ *
+ * @endcond
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "perf_counters.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/** The names of the counters */
+static const char *counter_names[NR_PERF_COUNTERS] = {"Instr", "Cycles", "L1D-miss", "LLC-miss", "Br-miss", "dTLB-miss"};
+
+#ifdef __linux__
+
+/**
+ * Composes the configuration of a hardware cache read miss counter.
+ *
+ * @param[in] cache the cache (`PERF_COUNT_HW_CACHE_*`)
+ */
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+/** The types of the counters */
+static const uint32_t counter_types[NR_PERF_COUNTERS] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+};
+
+/** The configurations of the counters */
+static const uint64_t counter_configs[NR_PERF_COUNTERS] = {
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CPU_CYCLES,
+    CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D),
+    CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL),
+    PERF_COUNT_HW_BRANCH_MISSES,
+    CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB)
+};
+
+/** The file descriptors of the counters, -1 if not open */
+static int counter_fds[NR_PERF_COUNTERS] = {-1, -1, -1, -1, -1, -1};
+
+#endif
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+unsigned int perf_counters_open(void) {
+    unsigned int nr_open = 0;
+#ifdef __linux__
+    struct perf_event_attr attr;
+    unsigned int i;
+
+    for (i = 0; i < NR_PERF_COUNTERS; ++i) {
+        if (counter_fds[i] != -1) {
+            ++nr_open;
+            continue;
+        }
+        memset(&attr, 0, sizeof (attr));
+        attr.size = sizeof (attr);
+        attr.type = counter_types[i];
+        attr.config = counter_configs[i];
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        counter_fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (counter_fds[i] == -1) {
+            fprintf(stderr, "Could not open the %s counter: %s\n", counter_names[i], strerror(errno));
+        } else {
+            ++nr_open;
+        }
+    }
+#endif
+    return nr_open;
+}
+
+void perf_counters_close(void) {
+#ifdef __linux__
+    unsigned int i;
+
+    for (i = 0; i < NR_PERF_COUNTERS; ++i) {
+        if (counter_fds[i] != -1) {
+            close(counter_fds[i]);
+            counter_fds[i] = -1;
+        }
+    }
+#endif
+}
+
+void perf_counters_read(double *values) {
+    unsigned int i;
+
+    for (i = 0; i < NR_PERF_COUNTERS; ++i) {
+        values[i] = -1;
+#ifdef __linux__
+        if (counter_fds[i] != -1) {
+            uint64_t data[3]; /* value, time enabled, time running */
+            if (read(counter_fds[i], data, sizeof (data)) == (ssize_t) sizeof (data)) {
+                values[i] = data[2] == 0 ? 0 : (double) data[0] * ((double) data[1] / (double) data[2]);
+            }
+        }
+#endif
+    }
+}
+
+const char *perf_counter_name(const unsigned int counter) {
+    return counter < NR_PERF_COUNTERS ? counter_names[counter] : "";
+}
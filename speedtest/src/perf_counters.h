@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Declaration of the hardware performance counter functions of the speed
+ * tests.
+ *
+ * @endcond
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/** The number of hardware performance counters that are captured */
+#define NR_PERF_COUNTERS 6
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * Opens the hardware performance counters (instructions, cycles, L1D read
+     * misses, LLC read misses, branch misses, and dTLB read misses) of the
+     * calling thread, counting in user space only. Counters the system does
+     * not offer (or does not allow) are skipped. Only available on Linux
+     * (`perf_event_open`).
+     *
+     * @return the number of counters that could be opened
+     */
+    unsigned int perf_counters_open(void);
+
+    /**
+     * Closes the hardware performance counters.
+     */
+    void perf_counters_close(void);
+
+    /**
+     * Reads the hardware performance counters. When the kernel had to
+     * multiplex the counters, the values are scaled up to the time they were
+     * enabled.
+     *
+     * @param[out] values the values of the counters (`NR_PERF_COUNTERS`),
+     *                    __-1__ for counters that are not available
+     */
+    void perf_counters_read(double *values);
+
+    /**
+     * Returns the (short) name of a hardware performance counter.
+     *
+     * @param[in] counter the number of the counter
+     * @return the name of the counter
+     */
+    const char *perf_counter_name(const unsigned int counter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERF_COUNTERS_H */
@@ -46,16 +46,25 @@
 #include "cpa_kem.h"
 #include "cca_encrypt.h"
 #include "parameters.h"
+#include "pst_core.h"
+#include "pst_dem.h"
+#include "pack.h"
+#include "hash.h"
+#include "randombytes.h"
 #include "test_utils.h"
+#include "sweep.h"
+#include "throughput.h"
+#include "parallel.h"
 #include "misc.h"
 
 /**
  * Runs the speed tests for the individual steps of the KEM algorithm.
  *
  * @param[in] nr_test_repeats the number of times the tests should be repeated
+ * @param[in] nr_warm_ups     the number of untimed runs before the tests
  * @return __0__ on success, __1__ on failure
  */
-static unsigned int speedtest_kem(const unsigned int nr_test_repeats) {
+static unsigned int speedtest_kem(const unsigned int nr_test_repeats, const unsigned int nr_warm_ups) {
     unsigned int i, subtest;
     unsigned int nr_failed = 0;
     const char *subtest_names[] = {
@@ -69,6 +78,8 @@ static unsigned int speedtest_kem(const unsigned int nr_test_repeats) {
     unsigned char pk[CRYPTO_PUBLICKEYBYTES];
     unsigned char sk[CRYPTO_SECRETKEYBYTES];
 
+    WARM_UP(nr_warm_ups, crypto_kem_keypair(pk, sk); crypto_kem_enc(ct, ss_r, pk); crypto_kem_dec(ss_i, ct, sk));
+
     start_speed_test_suite("speed_tests", subtest_names, 3, nr_test_repeats);
 
     for (i = 0; i < nr_test_repeats; ++i) {
@@ -102,9 +113,10 @@ static unsigned int speedtest_kem(const unsigned int nr_test_repeats) {
  * Runs the speed tests for the individual steps of the PKE algorithm.
  *
  * @param[in] nr_test_repeats the number of times the tests should be repeated
+ * @param[in] nr_warm_ups     the number of untimed runs before the tests
  * @return __0__ on success, __1__ on failure
  */
-static unsigned int speedtest_encrypt(const unsigned int nr_test_repeats) {
+static unsigned int speedtest_encrypt(const unsigned int nr_test_repeats, const unsigned int nr_warm_ups) {
     unsigned int i, subtest;
     unsigned int nr_failed = 0;
     const char *subtest_names[] = {
@@ -124,6 +136,8 @@ static unsigned int speedtest_encrypt(const unsigned int nr_test_repeats) {
     memset(c, 0, CRYPTO_BYTES + message_len);
     memset(m, 0, message_len);
 
+    WARM_UP(nr_warm_ups, crypto_encrypt_keypair(pk, sk); crypto_encrypt(c, &clen, (const unsigned char *) message, message_len, pk); crypto_encrypt_open(m, &mlen, c, clen, sk));
+
     start_speed_test_suite("speed_tests", subtest_names, 3, nr_test_repeats);
 
     for (i = 0; i < nr_test_repeats; ++i) {
@@ -153,6 +167,203 @@ static unsigned int speedtest_encrypt(const unsigned int nr_test_repeats) {
     return nr_failed != 0;
 }
 
+#ifdef PST_CORE_INDEX_FORM
+
+/**
+ * Computes __U__ = __A__<sup>T</sup> * __R__ the way the encryption does,
+ * i.e. using the kernel the encryption selects for the parameters.
+ *
+ * @param[out] U      the result
+ * @param[in]  A      A_master
+ * @param[in]  A_perm the row displacements into A_master
+ * @param[in]  R_idx  R in index form
+ * @param[in]  params the algorithm parameters in use
+ */
+static void compute_U_as_encrypt(uint16_t *U, const uint16_t *A, const uint32_t *A_perm, const uint16_t *R_idx, const parameters *params) {
+    if (params->d == params->n) {
+        compute_B(U, A, A_perm, R_idx, params);
+    } else {
+        compute_U(U, A, A_perm, R_idx, params);
+    }
+}
+
+/**
+ * Runs the speed tests for the internal stages of the algorithm, so that the
+ * cost of each kernel can be followed separately.
+ *
+ * @param[in] params          the algorithm parameters in use
+ * @param[in] nr_test_repeats the number of times the tests should be repeated
+ * @param[in] nr_warm_ups     the number of untimed runs before each test
+ * @return __0__ on success
+ */
+static unsigned int speedtest_stages(const parameters *params, const unsigned int nr_test_repeats, const unsigned int nr_warm_ups) {
+    const char *subtest_names[] = {
+        "create_A",
+        "create_S",
+        "create_R",
+        "radix_sort",
+        "compute_B",
+        "compute_U",
+        "compute_X",
+        "compute_X_prime",
+        "compress_matrix (U)",
+        "decompress_matrix (v)",
+        "pack_pk",
+        "unpack_pk",
+        "pack_ct",
+        "unpack_ct",
+        "hash (ss_size)",
+        "hash (ss_size + pk_size)",
+        "hash (ss_size + ct_size)",
+        "round2_dem",
+        "round2_dem_inverse",
+    };
+    const unsigned int nr_subtests = (unsigned int) (sizeof (subtest_names) / sizeof (subtest_names[0]));
+    const uint8_t fn = (params->d == params->n) ? 3 : ROUND2_VARIANT_A;
+    const size_t mu = (size_t) (params->ss_size * 8 / params->B);
+    const size_t len_b = (size_t) (params->d * params->n_bar);
+    const size_t len_u = (size_t) (params->d * params->m_bar);
+    const size_t hash_len = (size_t) (params->ss_size + (params->pk_size > params->ct_size ? params->pk_size : params->ct_size));
+    const char *message = "This is the message to be encrypted.";
+    const unsigned long long message_len = strlen(message) + 1;
+    size_t len_a;
+    unsigned char *sigma, *rho, *pk, *ct, *hash_input, *hash_output, *c2, *m;
+    uint16_t *A, *S_idx, *R_idx, *B, *U, *v, *X;
+    int16_t *S;
+    uint32_t *A_perm, *sort_input, *sort_array;
+    unsigned long long c2_len, m_len;
+    uint8_t fn_unpacked;
+    unsigned int i, subtest;
+
+    switch (fn) {
+        case 0:
+            len_a = (size_t) (params->d * params->d);
+            break;
+        case 1:
+            len_a = 2 * (size_t) (params->d * params->d);
+            break;
+        case 2:
+            len_a = (size_t) (params->q + params->d);
+            break;
+        default:
+            len_a = 2 * (size_t) (params->d + 1);
+            break;
+    }
+
+    sigma = checked_malloc(params->ss_size);
+    rho = checked_malloc(params->ss_size);
+    pk = checked_malloc(params->pk_size);
+    ct = checked_malloc(params->ct_size);
+    hash_input = checked_calloc(hash_len, 1);
+    hash_output = checked_malloc(params->ss_size);
+    c2 = checked_malloc(message_len + 16 + 12);
+    m = checked_malloc(message_len);
+    A = checked_malloc(len_a * sizeof (*A));
+    A_perm = checked_malloc((size_t) (params->d + 1) * sizeof (*A_perm));
+    S = checked_malloc(len_b * sizeof (*S));
+    S_idx = checked_malloc((size_t) (params->h * params->n_bar) * sizeof (*S_idx));
+    R_idx = checked_malloc((size_t) (params->h * params->m_bar) * sizeof (*R_idx));
+    /* In the ring case B and U need one extra row for the lifted product */
+    B = checked_malloc((len_b + params->n_bar) * sizeof (*B));
+    U = checked_malloc((len_u + params->m_bar) * sizeof (*U));
+    v = checked_calloc(mu, sizeof (*v));
+    X = checked_malloc((size_t) (params->n_bar * params->m_bar * params->n) * sizeof (*X));
+    sort_input = checked_malloc(params->d * sizeof (*sort_input));
+    sort_array = checked_malloc(params->d * sizeof (*sort_array));
+
+    randombytes(sigma, params->ss_size);
+    randombytes(rho, params->ss_size);
+    randombytes((unsigned char *) sort_input, params->d * sizeof (*sort_input));
+
+    /* Set up the inputs of all stages once */
+    create_A(A, A_perm, fn, sigma, params);
+    create_S(S, S_idx, params);
+    create_R(R_idx, rho, params);
+    compute_B(B, A, A_perm, S_idx, params);
+    compute_U_as_encrypt(U, A, A_perm, R_idx, params);
+    pack_pk(pk, fn, sigma, params->ss_size, B, len_b, params->p_bits);
+    pack_ct(ct, U, len_u, params->p_bits, v, mu, params->t_bits);
+    round2_dem(c2, &c2_len, hash_output, params->ss_size, (const unsigned char *) message, message_len);
+
+    start_speed_test_suite("stage_speed_tests", subtest_names, nr_subtests, nr_test_repeats);
+
+#define TIME_STAGE(code) \
+    WARM_UP(nr_warm_ups, code); \
+    for (i = 0; i < nr_test_repeats; ++i) { \
+        TIME_TEST_REPEAT(subtest, i, code); \
+    } \
+    ++subtest
+
+    subtest = 0;
+    TIME_STAGE(create_A(A, A_perm, fn, sigma, params));
+    TIME_STAGE(create_S(S, S_idx, params));
+    TIME_STAGE(create_R(R_idx, rho, params));
+    TIME_STAGE(memcpy(sort_array, sort_input, params->d * sizeof (*sort_array)); radix_sort(sort_array, params->d));
+    TIME_STAGE(if (fn == 2) compute_B_fn2(B, A, A_perm, S_idx, params); else compute_B(B, A, A_perm, S_idx, params));
+    TIME_STAGE(compute_U_as_encrypt(U, A, A_perm, R_idx, params));
+    TIME_STAGE(compute_X(X, B, R_idx, params, params->p_bits, params->n_bar, params->m_bar));
+    TIME_STAGE(compute_X_prime(X, U, S_idx, params, params->p_bits, params->m_bar, params->n_bar));
+    TIME_STAGE(compress_matrix(U, (size_t) (params->k * params->m_bar), params->n, params->q_bits, params->p_bits));
+    TIME_STAGE(decompress_matrix(v, mu, 1, params->p_bits, params->t_bits));
+    TIME_STAGE(pack_pk(pk, fn, sigma, params->ss_size, B, len_b, params->p_bits));
+    TIME_STAGE(unpack_pk(&fn_unpacked, sigma, B, pk, params->ss_size, len_b, params->p_bits));
+    TIME_STAGE(pack_ct(ct, U, len_u, params->p_bits, v, mu, params->t_bits));
+    TIME_STAGE(unpack_ct(U, v, ct, len_u, params->p_bits, mu, params->t_bits));
+    TIME_STAGE(hash(hash_output, hash_input, params->ss_size, params->ss_size));
+    TIME_STAGE(hash(hash_output, hash_input, (size_t) (params->ss_size + params->pk_size), params->ss_size));
+    TIME_STAGE(hash(hash_output, hash_input, (size_t) (params->ss_size + params->ct_size), params->ss_size));
+    TIME_STAGE(round2_dem(c2, &c2_len, hash_output, params->ss_size, (const unsigned char *) message, message_len));
+    TIME_STAGE(round2_dem_inverse(m, &m_len, hash_output, params->ss_size, c2, c2_len));
+
+#undef TIME_STAGE
+
+    end_speed_test_suite(NULL);
+
+    free(sigma);
+    free(rho);
+    free(pk);
+    free(ct);
+    free(hash_input);
+    free(hash_output);
+    free(c2);
+    free(m);
+    free(A);
+    free(A_perm);
+    free(S);
+    free(S_idx);
+    free(R_idx);
+    free(B);
+    free(U);
+    free(v);
+    free(X);
+    free(sort_input);
+    free(sort_array);
+
+    return 0;
+}
+
+#else
+
+/**
+ * Runs the speed tests for the internal stages of the algorithm. These tests
+ * use the internal functions of the optimized implementation, with the
+ * reference implementation they are not available.
+ *
+ * @param[in] params          the algorithm parameters in use
+ * @param[in] nr_test_repeats the number of times the tests should be repeated
+ * @param[in] nr_warm_ups     the number of untimed runs before each test
+ * @return __1__ (not available)
+ */
+static unsigned int speedtest_stages(const parameters *params, const unsigned int nr_test_repeats, const unsigned int nr_warm_ups) {
+    (void) params;
+    (void) nr_test_repeats;
+    (void) nr_warm_ups;
+    fprintf(stderr, "The stage speed tests need the optimized implementation\n");
+    return 1;
+}
+
+#endif
+
 /**
  * Prints a usage message on `stderr` and exits the program.
  *
@@ -162,7 +373,21 @@ static void usage(const char *message) {
     if (message != NULL) {
         fprintf(stderr, "%s\n", message);
     }
-    fprintf(stderr, "Usage: speedtest [-r <repeats>]\n");
+    fprintf(stderr, "Usage: speedtest [-r <repeats>] [-w <warm-ups>] [-p] [-H] [-j <file>] [-s | -a [-f csv|json] | -t <threads> [-d <ms>] | -l <threads>]\n");
+    fprintf(stderr, "  -r <repeats>   the number of timed test repeats (default 100)\n");
+    fprintf(stderr, "  -w <warm-ups>  the number of untimed runs before the tests (default 10)\n");
+    fprintf(stderr, "  -p             also capture hardware performance counters (Linux)\n");
+    fprintf(stderr, "  -H             also print the percentile distribution of each subtest\n");
+    fprintf(stderr, "  -j <file>      write the histograms of each subtest to <file> (JSON lines)\n");
+    fprintf(stderr, "  -s             also time the internal stages of the algorithm\n");
+    fprintf(stderr, "  -a             time all parameter sets and A variants, printing one table\n");
+    fprintf(stderr, "  -f csv|json    the format of the table of -a (default csv)\n");
+    fprintf(stderr, "  -t <threads>   measure the throughput with 1, 2, 4, ... up to <threads>\n");
+    fprintf(stderr, "                 threads (0: the number of online cpus)\n");
+    fprintf(stderr, "  -d <ms>        the duration of -t per number of threads (default 1000)\n");
+    fprintf(stderr, "  -l <threads>   measure the latency of single operations spread over a pool\n");
+    fprintf(stderr, "                 of 1, 2, 4, ... up to <threads> threads (0: the number of\n");
+    fprintf(stderr, "                 online cpus)\n");
     exit(EXIT_FAILURE);
 }
 
@@ -180,8 +405,18 @@ int main(int argc, char** argv) {
     unsigned int nr_failed = 0;
 
     unsigned int nr_test_repeats = 100;
-
-    while ((ch = getopt(argc, argv, "?r:")) != -1) {
+    unsigned int nr_warm_ups = 10;
+    int stages = 0;
+    int sweep = 0;
+    sweep_format format = SWEEP_CSV;
+    int throughput = 0;
+    int parallel = 0;
+    unsigned int max_threads = 0;
+    unsigned int duration_ms = 1000;
+    FILE *histogram_text = NULL;
+    FILE *histogram_json = NULL;
+
+    while ((ch = getopt(argc, argv, "?r:w:pHj:saf:t:d:l:")) != -1) {
         switch (ch) {
             case 'r':
                 number = strtol(optarg, NULL, 10);
@@ -190,15 +425,83 @@ int main(int argc, char** argv) {
                 }
                 nr_test_repeats = (unsigned int) number;
                 break;
+            case 'w':
+                number = strtol(optarg, NULL, 10);
+                if (number < 0) {
+                    usage("Invalid number of warm-ups specified");
+                }
+                nr_warm_ups = (unsigned int) number;
+                break;
+            case 'p':
+                if (enable_perf_counters() == 0) {
+                    fprintf(stderr, "No hardware performance counters available\n");
+                }
+                break;
+            case 'H':
+                histogram_text = stdout;
+                break;
+            case 'j':
+                if (histogram_json != NULL) {
+                    fclose(histogram_json);
+                }
+                histogram_json = fopen(optarg, "w");
+                if (histogram_json == NULL) {
+                    usage("Could not open the histogram file");
+                }
+                break;
+            case 's':
+                stages = 1;
+                break;
+            case 'a':
+                sweep = 1;
+                break;
+            case 'f':
+                if (strcmp(optarg, "csv") == 0) {
+                    format = SWEEP_CSV;
+                } else if (strcmp(optarg, "json") == 0) {
+                    format = SWEEP_JSON;
+                } else {
+                    usage("Invalid output format specified");
+                }
+                break;
+            case 't':
+                number = strtol(optarg, NULL, 10);
+                if (number < 0) {
+                    usage("Invalid number of threads specified");
+                }
+                throughput = 1;
+                max_threads = (unsigned int) number;
+                break;
+            case 'd':
+                number = strtol(optarg, NULL, 10);
+                if (number <= 0) {
+                    usage("Invalid duration specified");
+                }
+                duration_ms = (unsigned int) number;
+                break;
+            case 'l':
+                number = strtol(optarg, NULL, 10);
+                if (number < 0) {
+                    usage("Invalid number of threads specified");
+                }
+                parallel = 1;
+                max_threads = (unsigned int) number;
+                break;
             default:
                 usage(NULL);
         }
     }
     argc -= optind;
     argv += optind;
-    if (argc > 0)
+    if (argc > 0 || sweep + stages + throughput + parallel > 1)
         usage(NULL);
 
+    set_speed_histogram_output(histogram_text, histogram_json);
+
+    if (sweep) {
+        return speedtest_sweep(nr_test_repeats, nr_warm_ups, format) ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
     if (set_parameters_from_api(&params)) {
         fprintf(stderr, "Incorrect API parameters\n");
         exit(EXIT_FAILURE);
@@ -222,12 +525,32 @@ int main(int argc, char** argv) {
     if (CRYPTO_CIPHERTEXTBYTES != 0) {
         printf("CRYPTO_CIPHERTEXTBYTES = %u\n", CRYPTO_CIPHERTEXTBYTES);
     }
-    printf("Tests are repeated %u times\n\n", nr_test_repeats);
+    if (!throughput && !parallel) {
+        printf("Tests are repeated %u times, after %u warm-up runs\n", nr_test_repeats, nr_warm_ups);
+    }
+    printf("\n");
 
-    if (CRYPTO_CIPHERTEXTBYTES != 0) {
-        nr_failed += speedtest_kem(nr_test_repeats);
+    if (ROUND2_VARIANT_A == 1 && params.n == 1) {
+        unsigned char *seed = checked_malloc(params.ss_size);
+        randombytes(seed, params.ss_size);
+        create_A_fixed(seed, params.ss_size, &params);
+        free(seed);
+    }
+
+    if (throughput) {
+        nr_failed += speedtest_throughput(&params, ROUND2_VARIANT_A, max_threads, duration_ms);
+    } else if (parallel) {
+        nr_failed += speedtest_parallel(&params, ROUND2_VARIANT_A, max_threads, nr_test_repeats, nr_warm_ups);
+    } else if (CRYPTO_CIPHERTEXTBYTES != 0) {
+        nr_failed += speedtest_kem(nr_test_repeats, nr_warm_ups);
     } else {
-        nr_failed += speedtest_encrypt(nr_test_repeats);
+        nr_failed += speedtest_encrypt(nr_test_repeats, nr_warm_ups);
+    }
+    if (stages) {
+        nr_failed += speedtest_stages(&params, nr_test_repeats, nr_warm_ups);
+    }
+    if (histogram_json != NULL) {
+        fclose(histogram_json);
     }
     return nr_failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,545 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the parameter sweep of the speed tests.
+ *
+ * @endcond
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "sweep.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "cpa_kem.h"
+#include "cca_kem.h"
+#include "cca_encrypt.h"
+#include "parameters.h"
+#include "api_to_internal_parameters.h"
+#include "randombytes.h"
+#include "pst_api.h"
+#include "hdr_histogram.h"
+#include "test_utils.h"
+#include "misc.h"
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/** The schemes that can be tested */
+typedef enum {
+    SCHEME_CPA_KEM, /**< The CPA KEM (`crypto_kem_*_p`) */
+    SCHEME_CCA_KEM, /**< The CCA KEM (`crypto_cca_kem_*_p`) */
+    SCHEME_PKE /**< The CCA encryption (`crypto_encrypt_*_p`) */
+} sweep_scheme;
+
+/** The names of the schemes, as used in the output */
+static const char *scheme_names[] = {"cpa_kem", "cca_kem", "pke"};
+
+/** The names of the timed operations, as used in the output */
+static const char *operation_names[] = {"keygen", "enc", "dec"};
+
+/** The number of timed operations */
+#define NR_OPERATIONS 3
+
+/** The message encrypted by the PKE */
+static const char sweep_message[] = "This is the message to be encrypted.";
+
+/**
+ * The results of a single configuration, passed from the child process that
+ * measured them to the parent.
+ */
+typedef struct {
+    unsigned long long pk_bytes; /**< The size of the public key */
+    unsigned long long sk_bytes; /**< The size of the secret key */
+    unsigned long long ct_bytes; /**< The size of the ciphertext */
+    uint64_t cycles[NR_OPERATIONS][3]; /**< Minimum, median and 99th percentile cycles per operation */
+    long peak_heap_kib; /**< The peak heap use in KiB, -1 if not measured */
+    unsigned int failures; /**< The number of runs with a wrong result */
+} sweep_result;
+
+#ifdef __GLIBC__
+
+/* The heap use is measured by replacing the allocation functions of the C
+ * library with wrappers around those of glibc, which count the usable size
+ * of the blocks while the measurement is active (in the child process of a
+ * configuration only, so the other speed tests are not affected). */
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+/** Whether the heap use is being measured (accessed atomically) */
+static int heap_measured = 0;
+
+/** The heap in use, in bytes (accessed atomically) */
+static size_t heap_in_use = 0;
+
+/** The high-water mark of `heap_in_use` (accessed atomically) */
+static size_t heap_peak = 0;
+
+/**
+ * Counts an allocated block in the heap use, if it is being measured.
+ *
+ * @param[in] ptr the block, may be `NULL`
+ */
+static void heap_allocated(void *ptr) {
+    if (ptr != NULL && __atomic_load_n(&heap_measured, __ATOMIC_RELAXED)) {
+        const size_t in_use = __atomic_add_fetch(&heap_in_use, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+        size_t peak = __atomic_load_n(&heap_peak, __ATOMIC_RELAXED);
+        while (in_use > peak && !__atomic_compare_exchange_n(&heap_peak, &peak, in_use, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+    }
+}
+
+/**
+ * Removes a block that is about to be released from the heap use, if it is
+ * being measured. Blocks allocated before the measurement started are
+ * released too, so the heap use does not drop below zero.
+ *
+ * @param[in] ptr the block, may be `NULL`
+ */
+static void heap_released(void *ptr) {
+    if (ptr != NULL && __atomic_load_n(&heap_measured, __ATOMIC_RELAXED)) {
+        const size_t size = malloc_usable_size(ptr);
+        size_t in_use = __atomic_load_n(&heap_in_use, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&heap_in_use, &in_use, in_use > size ? in_use - size : 0, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+    }
+}
+
+/** Counting version of `malloc()` */
+void *malloc(size_t size) {
+    void *ptr = __libc_malloc(size);
+    heap_allocated(ptr);
+    return ptr;
+}
+
+/** Counting version of `calloc()` */
+void *calloc(size_t count, size_t size) {
+    void *ptr = __libc_calloc(count, size);
+    heap_allocated(ptr);
+    return ptr;
+}
+
+/** Counting version of `realloc()` */
+void *realloc(void *ptr, size_t size) {
+    void *new_ptr;
+
+    heap_released(ptr);
+    new_ptr = __libc_realloc(ptr, size);
+    heap_allocated(new_ptr != NULL || size == 0 ? new_ptr : ptr);
+    return new_ptr;
+}
+
+/** Counting version of `memalign()` */
+void *memalign(size_t alignment, size_t size) {
+    void *ptr = __libc_memalign(alignment, size);
+    heap_allocated(ptr);
+    return ptr;
+}
+
+/** Counting version of `aligned_alloc()` */
+void *aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+/** Counting version of `posix_memalign()` */
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    void *block;
+
+    if (alignment < sizeof (void *) || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    block = memalign(alignment, size);
+    if (block == NULL && size != 0) {
+        return ENOMEM;
+    }
+    *ptr = block;
+    return 0;
+}
+
+/** Counting version of `free()` */
+void free(void *ptr) {
+    heap_released(ptr);
+    __libc_free(ptr);
+}
+
+/**
+ * Starts the measurement of the heap use: from here on the blocks are
+ * counted, and the high-water mark is that of the heap allocated after the
+ * start.
+ */
+static void start_peak_heap(void) {
+    __atomic_store_n(&heap_in_use, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&heap_peak, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&heap_measured, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Stops the measurement of the heap use.
+ *
+ * @return the high-water mark of the heap allocated since the start, in KiB
+ */
+static long stop_peak_heap(void) {
+    __atomic_store_n(&heap_measured, 0, __ATOMIC_RELAXED);
+    return (long) ((__atomic_load_n(&heap_peak, __ATOMIC_RELAXED) + 1023) / 1024);
+}
+
+#else
+
+/** Without glibc the heap use is not measured */
+static void start_peak_heap(void) {
+}
+
+/**
+ * Without glibc the heap use is not measured.
+ *
+ * @return __-1__
+ */
+static long stop_peak_heap(void) {
+    return -1;
+}
+
+#endif
+
+/**
+ * Runs the timed (and untimed warm-up) runs of one configuration.
+ *
+ * @param[out] result          the results of the configuration
+ * @param[in]  params          the algorithm parameters to use
+ * @param[in]  fn              the variant to use for the creation of A
+ * @param[in]  scheme          the scheme to test
+ * @param[in]  nr_test_repeats the number of timed runs
+ * @param[in]  nr_warm_ups     the number of untimed runs
+ */
+static void run_configuration(sweep_result *result, const parameters *params, const uint8_t fn, const sweep_scheme scheme, const unsigned int nr_test_repeats, const unsigned int nr_warm_ups) {
+    const unsigned long long message_len = sizeof (sweep_message);
+    unsigned char *pk, *sk, *ct, *ss_r, *ss_i, *m;
+    unsigned long long ct_len = 0, m_len;
+    hdr_histogram *cycles[NR_OPERATIONS];
+    uint64_t start;
+    unsigned int i, op;
+
+    memset(result, 0, sizeof (*result));
+    result->pk_bytes = params->pk_size;
+    switch (scheme) {
+        case SCHEME_CPA_KEM:
+            result->sk_bytes = params->sk_size;
+            result->ct_bytes = params->ct_size;
+            break;
+        case SCHEME_CCA_KEM:
+            result->sk_bytes = (unsigned long long) (params->sk_size + params->ss_size + params->pk_size);
+            result->ct_bytes = (unsigned long long) (params->ct_size + params->ss_size);
+            break;
+        case SCHEME_PKE:
+            result->sk_bytes = (unsigned long long) (params->sk_size + params->ss_size + params->pk_size);
+            result->ct_bytes = (unsigned long long) (params->ct_size + params->ss_size + 16 + 12) + message_len;
+            break;
+    }
+
+    if (fn == 1 && params->n == 1) {
+        unsigned char *seed = checked_malloc(params->ss_size);
+        randombytes(seed, params->ss_size);
+        create_A_fixed(seed, params->ss_size, params);
+        free(seed);
+    }
+
+    pk = checked_malloc(result->pk_bytes);
+    sk = checked_malloc(result->sk_bytes);
+    ct = checked_malloc(result->ct_bytes);
+    ss_r = checked_malloc(params->ss_size);
+    ss_i = checked_malloc(params->ss_size);
+    m = checked_malloc(message_len);
+    for (op = 0; op < NR_OPERATIONS; ++op) {
+        cycles[op] = hdr_create(1, 1000000000000ULL, 3);
+    }
+
+    for (i = 0; i < nr_warm_ups + nr_test_repeats; ++i) {
+        const int timed = i >= nr_warm_ups;
+        int ok = 0;
+
+        if (i == nr_warm_ups) {
+            start_peak_heap();
+        }
+
+        switch (scheme) {
+            case SCHEME_CPA_KEM:
+                start = cpu_cycles_start();
+                crypto_kem_keypair_p(pk, sk, params, fn);
+                if (timed) hdr_record(cycles[0], cpu_cycles_stop() - start);
+                start = cpu_cycles_start();
+                crypto_kem_enc_p(ct, ss_r, pk, params);
+                if (timed) hdr_record(cycles[1], cpu_cycles_stop() - start);
+                start = cpu_cycles_start();
+                crypto_kem_dec_p(ss_i, ct, sk, params);
+                if (timed) hdr_record(cycles[2], cpu_cycles_stop() - start);
+                ok = memcmp(ss_r, ss_i, params->ss_size) == 0;
+                break;
+            case SCHEME_CCA_KEM:
+                start = cpu_cycles_start();
+                crypto_cca_kem_keypair_p(pk, sk, params, fn);
+                if (timed) hdr_record(cycles[0], cpu_cycles_stop() - start);
+                start = cpu_cycles_start();
+                crypto_cca_kem_enc_p(ct, ss_r, pk, params);
+                if (timed) hdr_record(cycles[1], cpu_cycles_stop() - start);
+                start = cpu_cycles_start();
+                crypto_cca_kem_dec_p(ss_i, ct, sk, params);
+                if (timed) hdr_record(cycles[2], cpu_cycles_stop() - start);
+                ok = memcmp(ss_r, ss_i, params->ss_size) == 0;
+                break;
+            case SCHEME_PKE:
+                start = cpu_cycles_start();
+                crypto_encrypt_keypair_p(pk, sk, params, fn);
+                if (timed) hdr_record(cycles[0], cpu_cycles_stop() - start);
+                start = cpu_cycles_start();
+                crypto_encrypt_p(ct, &ct_len, (const unsigned char *) sweep_message, message_len, pk, params);
+                if (timed) hdr_record(cycles[1], cpu_cycles_stop() - start);
+                start = cpu_cycles_start();
+                crypto_encrypt_open_p(m, &m_len, ct, ct_len, sk, params);
+                if (timed) hdr_record(cycles[2], cpu_cycles_stop() - start);
+                ok = ct_len == result->ct_bytes && m_len == message_len && memcmp(m, sweep_message, message_len) == 0;
+                break;
+        }
+        if (!ok) {
+            ++result->failures;
+        }
+    }
+
+    for (op = 0; op < NR_OPERATIONS; ++op) {
+        result->cycles[op][0] = hdr_min(cycles[op]);
+        result->cycles[op][1] = hdr_value_at_percentile(cycles[op], 50);
+        result->cycles[op][2] = hdr_value_at_percentile(cycles[op], 99);
+        hdr_destroy(cycles[op]);
+    }
+    result->peak_heap_kib = stop_peak_heap();
+
+    free(pk);
+    free(sk);
+    free(ct);
+    free(ss_r);
+    free(ss_i);
+    free(m);
+}
+
+/**
+ * Runs one configuration in a child process and collects its results.
+ *
+ * @param[out] result          the results of the configuration
+ * @param[in]  params          the algorithm parameters to use
+ * @param[in]  fn              the variant to use for the creation of A
+ * @param[in]  scheme          the scheme to test
+ * @param[in]  nr_test_repeats the number of timed runs
+ * @param[in]  nr_warm_ups     the number of untimed runs
+ * @return __0__ if the child ran to completion, __1__ otherwise
+ */
+static int fork_configuration(sweep_result *result, const parameters *params, const uint8_t fn, const sweep_scheme scheme, const unsigned int nr_test_repeats, const unsigned int nr_warm_ups) {
+    int fds[2];
+    int status;
+    pid_t pid;
+    ssize_t len;
+
+    fflush(stdout);
+    if (pipe(fds)) {
+        return 1;
+    }
+    pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return 1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        run_configuration(result, params, fn, scheme, nr_test_repeats, nr_warm_ups);
+        _exit(write(fds[1], result, sizeof (*result)) == (ssize_t) sizeof (*result) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    do {
+        len = read(fds[0], result, sizeof (*result));
+    } while (len < 0 && errno == EINTR);
+    close(fds[0]);
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+
+    return len != (ssize_t) sizeof (*result) || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS;
+}
+
+/**
+ * Prints the header of the output table.
+ *
+ * @param[in] format the output format
+ */
+static void print_header(const sweep_format format) {
+    unsigned int op;
+
+    if (format == SWEEP_JSON) {
+        printf("[");
+        return;
+    }
+    printf("config,scheme,nist_level,fn,d,n,h,q,pk_bytes,sk_bytes,ct_bytes");
+    for (op = 0; op < NR_OPERATIONS; ++op) {
+        printf(",%s_min,%s_median,%s_p99", operation_names[op], operation_names[op], operation_names[op]);
+    }
+    printf(",peak_heap_kib,failures,status\n");
+}
+
+/**
+ * Prints the results of one configuration.
+ *
+ * @param[in] format the output format
+ * @param[in] first  whether this is the first configuration printed
+ * @param[in] config the name of the configuration
+ * @param[in] scheme the tested scheme
+ * @param[in] level  the NIST security level of the parameter set
+ * @param[in] fn     the variant used for the creation of A (negative for
+ *                   the ring sets)
+ * @param[in] params the algorithm parameters used
+ * @param[in] result the results of the configuration
+ * @param[in] failed whether the configuration did not run to completion
+ */
+static void print_result(const sweep_format format, const int first, const char *config, const sweep_scheme scheme, const unsigned int level, const int fn, const parameters *params, const sweep_result *result, const int failed) {
+    const char *status = failed ? "crashed" : (result->failures ? "failed" : "ok");
+    unsigned int op;
+
+    if (format == SWEEP_JSON) {
+        printf("%s\n  {\"config\": \"%s\", \"scheme\": \"%s\", \"nist_level\": %u, ", first ? "" : ",", config, scheme_names[scheme], level);
+        if (fn < 0) {
+            printf("\"fn\": null, ");
+        } else {
+            printf("\"fn\": %d, ", fn);
+        }
+        printf("\"d\": %u, \"n\": %u, \"h\": %u, \"q\": %u, ", params->d, params->n, params->h, params->q);
+        if (failed) {
+            printf("\"status\": \"%s\"}", status);
+            return;
+        }
+        printf("\"pk_bytes\": %llu, \"sk_bytes\": %llu, \"ct_bytes\": %llu, ", result->pk_bytes, result->sk_bytes, result->ct_bytes);
+        for (op = 0; op < NR_OPERATIONS; ++op) {
+            printf("\"%s_cycles\": {\"min\": %llu, \"median\": %llu, \"p99\": %llu}, ", operation_names[op],
+                    (unsigned long long) result->cycles[op][0], (unsigned long long) result->cycles[op][1], (unsigned long long) result->cycles[op][2]);
+        }
+        if (result->peak_heap_kib < 0) {
+            printf("\"peak_heap_kib\": null, ");
+        } else {
+            printf("\"peak_heap_kib\": %ld, ", result->peak_heap_kib);
+        }
+        printf("\"failures\": %u, \"status\": \"%s\"}", result->failures, status);
+        return;
+    }
+
+    printf("%s,%s,%u,", config, scheme_names[scheme], level);
+    if (fn >= 0) {
+        printf("%d", fn);
+    }
+    printf(",%u,%u,%u,%u", params->d, params->n, params->h, params->q);
+    if (failed) {
+        printf(",,,,,,,,,,,,,,,%s\n", status);
+        return;
+    }
+    printf(",%llu,%llu,%llu", result->pk_bytes, result->sk_bytes, result->ct_bytes);
+    for (op = 0; op < NR_OPERATIONS; ++op) {
+        printf(",%llu,%llu,%llu", (unsigned long long) result->cycles[op][0], (unsigned long long) result->cycles[op][1], (unsigned long long) result->cycles[op][2]);
+    }
+    if (result->peak_heap_kib < 0) {
+        printf(",-");
+    } else {
+        printf(",%ld", result->peak_heap_kib);
+    }
+    printf(",%u,%s\n", result->failures, status);
+}
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+unsigned int speedtest_sweep(const unsigned int nr_test_repeats, const unsigned int nr_warm_ups, const sweep_format format) {
+    const size_t nr_sets = nr_parameter_sets();
+    unsigned int nr_failed = 0;
+    int first = 1;
+    size_t set;
+
+    print_header(format);
+    for (set = 0; set < nr_sets; ++set) {
+        const parameters *params = get_parameter_set(set);
+        const int is_pke = api_to_internal_parameters[set][API_CIPHER] == 0;
+        const unsigned int level = (unsigned int) (set % 5) + 1;
+        sweep_scheme scheme;
+        int fn;
+
+        if (params == NULL) {
+            fprintf(stderr, "Parameter set %lu is invalid, skipped\n", (unsigned long) set);
+            ++nr_failed;
+            continue;
+        }
+        for (scheme = is_pke ? SCHEME_PKE : SCHEME_CPA_KEM; scheme <= (is_pke ? SCHEME_PKE : SCHEME_CCA_KEM); ++scheme) {
+            /* The ring sets always use variant 3, the others are tested with variants 0, 1 and 2 */
+            for (fn = params->n == 1 ? 0 : -1; fn <= (params->n == 1 ? 2 : -1); ++fn) {
+                sweep_result result;
+                char config[32];
+                int failed;
+
+                if (params->n == 1) {
+                    snprintf(config, sizeof (config), "%sround2_%s_n1_fn%d", params->q_bits == 0 ? "n" : "u", is_pke ? "pke" : "kem", fn);
+                } else {
+                    snprintf(config, sizeof (config), "%sround2_%s_nd", params->q_bits == 0 ? "n" : "u", is_pke ? "pke" : "kem");
+                }
+                failed = fork_configuration(&result, params, (uint8_t) (fn < 0 ? 0 : fn), scheme, nr_test_repeats, nr_warm_ups);
+                print_result(format, first, config, scheme, level, fn, params, &result, failed);
+                fflush(stdout);
+                first = 0;
+                if (failed || result.failures) {
+                    ++nr_failed;
+                }
+            }
+        }
+    }
+    if (format == SWEEP_JSON) {
+        printf("\n]\n");
+    }
+
+    return nr_failed;
+}
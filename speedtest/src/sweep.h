@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Declaration of the parameter sweep of the speed tests.
+ *
+ * @endcond
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * The output formats of the parameter sweep.
+     */
+    typedef enum {
+        SWEEP_CSV, /**< Comma separated values, one line per configuration */
+        SWEEP_JSON /**< A JSON array, one object per configuration */
+    } sweep_format;
+
+    /**
+     * Runs the speed tests for every predefined parameter set and, for the
+     * non-ring sets, every variant of the creation of A, using the `_p`
+     * functions. For the KEM sets both the CPA and the CCA KEM are tested, for
+     * the PKE sets the CCA encryption.
+     *
+     * Each configuration runs in a child process of its own, so that its peak
+     * heap use can be measured (with glibc, as the high-water mark of the
+     * heap allocated during the timed runs), a fixed A (variant 1) does not
+     * carry over to the next configuration, and a crash does not end the
+     * sweep. The results are printed on `stdout` as one table: the minimum,
+     * median and 99th percentile of the cpu cycles of key generation,
+     * encapsulation/encryption and decapsulation/decryption, the public key,
+     * secret key and ciphertext sizes, and the peak heap use.
+     *
+     * @param[in] nr_test_repeats the number of timed runs per configuration
+     * @param[in] nr_warm_ups     the number of untimed runs per configuration
+     * @param[in] format          the output format
+     * @return the number of configurations that failed
+     */
+    unsigned int speedtest_sweep(const unsigned int nr_test_repeats, const unsigned int nr_warm_ups, const sweep_format format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SWEEP_H */
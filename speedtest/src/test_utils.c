@@ -36,6 +36,8 @@
  * @endcond
  */
 
+#define _POSIX_C_SOURCE 199309L
+
 #include "test_utils.h"
 
 #include <stdio.h>
@@ -43,21 +45,55 @@
 #include <string.h>
 #include <math.h>
 
+#include "perf_counters.h"
+#include "hdr_histogram.h"
+#include "round2_stats.h"
+
+#ifndef CLOCK_MONOTONIC_RAW
+/** Falls back to the monotonic clock on systems without a raw one */
+#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+
 /**
- * Determines the current cpu cycle count.
+ * Determines the cpu cycle count at the start of a measurement. The `lfence`
+ * instructions keep the preceding instructions from finishing after, and the
+ * measured instructions from starting before, the `rdtsc`.
+ *
+ * @param[in] v the variable to store the result in (must be of type `uint64_t`)
+ */
+/**
+ * @def CPU_CYCLE_COUNT_STOP(v)
+ * Determines the cpu cycle count at the end of a measurement. The `rdtscp`
+ * waits for the measured instructions to finish, the `lfence` keeps the
+ * following instructions from starting before it.
  *
  * @param[in] v the variable to store the result in (must be of type `uint64_t`)
  */
 #if defined(__x86_64__)
-#define CPU_CYCLE_COUNT(v) __asm__ __volatile__("rdtsc; shlq $32,%%rdx;orq %%rdx,%%rax" : "=a" (v) : : "memory", "%rdx")
+#define CPU_CYCLE_COUNT_START(v) __asm__ __volatile__("lfence; rdtsc; lfence; shlq $32,%%rdx; orq %%rdx,%%rax" : "=a" (v) : : "memory", "%rdx")
+#define CPU_CYCLE_COUNT_STOP(v) __asm__ __volatile__("rdtscp; lfence; shlq $32,%%rdx; orq %%rdx,%%rax" : "=a" (v) : : "memory", "%rcx", "%rdx")
 #elif defined(__i386__)
 unsigned int lo, hi;
-#define CPU_CYCLE_COUNT(v)  __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi)); v = ((uint64_t)hi << 32) | lo
+#define CPU_CYCLE_COUNT_START(v) __asm__ __volatile__ ("lfence; rdtsc; lfence" : "=a" (lo), "=d" (hi) : : "memory"); v = ((uint64_t)hi << 32) | lo
+#define CPU_CYCLE_COUNT_STOP(v) __asm__ __volatile__ ("rdtscp; lfence" : "=a" (lo), "=d" (hi) : : "memory", "%ecx"); v = ((uint64_t)hi << 32) | lo
 #else
 #warning Can not run speed tests on non i386 platform
-#define CPU_CYCLE_COUNT(v)  v = 0
+#define CPU_CYCLE_COUNT_START(v)  v = 0
+#define CPU_CYCLE_COUNT_STOP(v)  v = 0
 #endif
 
+/** The highest timing (cpu cycles or nanoseconds) the histograms can hold */
+#define HIGHEST_TIMING 1000000000000ULL
+
+/** The number of significant decimal digits the histograms keep timings to */
+#define TIMING_SIGNIFICANT_FIGURES 3
+
+/**
+ * The factor of the interquartile range beyond the first and third quartile
+ * above/below which measurements are rejected as outliers (Tukey's fences).
+ */
+#define OUTLIER_IQR_FACTOR 1.5
+
 /**
  * Flag to indicate NetBeans test framework fluff should be added to the output.
  * The value of this flag is based on the existence of the `NBMAGIC` environment
@@ -90,20 +126,30 @@ static unsigned int nr_test_repeats;
 /** CPU Cycle count at start of an individual speed test */
 static uint64_t subtest_cpu_start;
 
-/** Buffer for the cpu timing results per subtest, per test repeat */
-static uint64_t **subtest_cpu;
+/** Histograms of the cpu timing results per subtest */
+static hdr_histogram **subtest_cpu;
+
 
-/** Buffer for the average cpu timing results per subtest */
-static uint64_t *subtest_cpu_average;
+/** Time (in nanoseconds) at start of an individual speed test */
+static uint64_t subtest_time_start;
 
-/** Clock count at start of an individual speed test */
-static clock_t subtest_clock_start;
+/** Histograms of the timing results (in nanoseconds) per subtest */
+static hdr_histogram **subtest_time;
 
-/** Buffer for the clock timing results per subtest, per test repeat */
-static clock_t **subtest_clock;
+/** The stream to print the percentile distributions of the subtests to, if any */
+static FILE *histogram_text;
 
-/** Buffer for the average cpu timing results per subtest */
-static clock_t *subtest_clock_average;
+/** The stream to print the histograms of the subtests to as JSON, if any */
+static FILE *histogram_json;
+
+/** Flag to indicate the hardware performance counters are captured */
+static int perf_enabled;
+
+/** Hardware performance counter values at the start of an individual speed test */
+static double subtest_perf_start[NR_PERF_COUNTERS];
+
+/** Sums of the hardware performance counter deltas per subtest, -1 if not available */
+static double (*subtest_perf)[NR_PERF_COUNTERS];
 
 /**
  * Determines the elapsed time in seconds.
@@ -116,57 +162,165 @@ static double elapsed_from(const clock_t start) {
 }
 
 /**
- * Compares two timings.
- * @param[in] a, b  the values to compare
- * @return __1__ if a>b, __0__ if a == b, or <b>-1</b> if a < b
+ * Determines the current time of the raw monotonic clock.
+ *
+ * @return the current time in nanoseconds
+ */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000U + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * The statistics of the measurements of a subtest.
+ */
+typedef struct {
+    uint64_t min; /**< The minimum */
+    uint64_t med; /**< The median */
+    uint64_t max; /**< The maximum */
+    uint64_t avg; /**< The average */
+    double var; /**< The variance */
+    unsigned int rejected; /**< The number of measurements rejected as outliers */
+    uint64_t p99; /**< The 99th percentile (including the outliers) */
+    uint64_t p999; /**< The 99.9th percentile (including the outliers) */
+} timing_stats;
+
+/**
+ * Determines the statistics of the measurements. The tail percentiles are
+ * those of all measurements, the other statistics those of the measurements
+ * within Tukey's fences (the others being rejected as outliers).
+ *
+ * @param[out] stats     the statistics
+ * @param[in]  histogram the measurements (the outliers are removed on return)
+ */
+static void compute_timing_stats(timing_stats *stats, hdr_histogram *histogram) {
+    double lower, upper, iqr;
+
+    stats->p99 = hdr_value_at_percentile(histogram, 99);
+    stats->p999 = hdr_value_at_percentile(histogram, 99.9);
+
+    /* Tukey's fences around the first and third quartile */
+    lower = (double) hdr_value_at_percentile(histogram, 25);
+    upper = (double) hdr_value_at_percentile(histogram, 75);
+    iqr = upper - lower;
+    lower -= OUTLIER_IQR_FACTOR * iqr;
+    upper += OUTLIER_IQR_FACTOR * iqr;
+    stats->rejected = (unsigned int) hdr_trim(histogram, lower > 0 ? (uint64_t) lower : 0, (uint64_t) upper);
+
+    stats->min = hdr_min(histogram);
+    stats->max = hdr_max(histogram);
+    stats->med = hdr_value_at_percentile(histogram, 50);
+    stats->avg = (uint64_t) hdr_mean(histogram);
+    stats->var = hdr_stddev(histogram) * hdr_stddev(histogram);
+}
+
+/**
+ * Prints the histograms of a subtest, as far as requested.
+ *
+ * @param[in] name the name of the subtest
+ * @param[in] cpu  the histogram of the cpu cycles
+ * @param[in] time the histogram of the times (in nanoseconds)
+ * @param[in] last whether this is the last subtest of the suite
  */
-static int compare_timings(const void *a, const void *b) {
-    return (*(const uint64_t *) a > *(const uint64_t *) b) - (*(const uint64_t *) a < *(const uint64_t *) b);
+static void print_histograms(const char *name, const hdr_histogram *cpu, const hdr_histogram *time, const int last) {
+    if (histogram_text != NULL) {
+        fprintf(histogram_text, "Percentile distribution of %s (cpu cycles):\n", name);
+        hdr_print_text(cpu, histogram_text, 1.0, 5);
+        fprintf(histogram_text, "\nPercentile distribution of %s (us):\n", name);
+        hdr_print_text(time, histogram_text, 1000.0, 5);
+        fprintf(histogram_text, "\n");
+    }
+    if (histogram_json != NULL) {
+        fprintf(histogram_json, "\"%s\": {\"cycles\": ", name);
+        hdr_print_json(cpu, histogram_json, 1.0);
+        fprintf(histogram_json, ", \"ns\": ");
+        hdr_print_json(time, histogram_json, 1.0);
+        fprintf(histogram_json, "}%s", last ? "" : ", ");
+    }
 }
 
 /**
  * Prints the timing results header.
  */
 static void print_timings_header() {
-    printf("%30s %9s %9s %9s %9s %9s\n", "Subtest", "Minimum", "Median", "Maximum", "Average", "StdDev");
+    printf("%30s %9s %9s %9s %9s %9s %8s %9s %9s\n", "Subtest", "Minimum", "Median", "Maximum", "Average", "StdDev", "Rejected", "P99", "P99.9");
 }
 
 /**
  * Prints the timing results separator line.
  */
 static void print_timings_separator() {
-    printf("------------------------------ --------- --------- --------- --------- ---------\n");
+    printf("------------------------------ --------- --------- --------- --------- --------- -------- --------- ---------\n");
 }
 
 /**
  * Prints the cpu timing results.
- * @param[in] test               the name of the test
- * @param[in] min, med, max, avg the minimum, median, maximum, average number of cpu cycles the test cost
- * @param[in] stdev              the standard deviation of the measured cpu cycles in each test repeat
+ * @param[in] test  the name of the test
+ * @param[in] stats the statistics of the number of cpu cycles the test cost
  */
-static void print_cpu_timings(const char *test, const uint64_t min, const uint64_t med, const uint64_t max, const uint64_t avg, const double stdev) {
+static void print_cpu_timings(const char *test, const timing_stats *stats) {
     printf("CPU %26s", test);
-    printf(" %9llu", min);
-    printf(" %9llu", med);
-    printf(" %9llu", max);
-    printf(" %9llu", avg);
-    if (stdev > 0) printf(" %9.0f", stdev);
+    printf(" %9llu", (unsigned long long) stats->min);
+    printf(" %9llu", (unsigned long long) stats->med);
+    printf(" %9llu", (unsigned long long) stats->max);
+    printf(" %9llu", (unsigned long long) stats->avg);
+    printf(" %9.0f", sqrt(stats->var));
+    printf(" %8u", stats->rejected);
+    printf(" %9llu", (unsigned long long) stats->p99);
+    printf(" %9llu", (unsigned long long) stats->p999);
     printf("\n");
 }
 
+/**
+ * Prints the average hardware performance counter values per test repeat of
+ * the subtests, and the instructions per cycle.
+ */
+static void print_perf_counters(void) {
+    unsigned int i, c;
+
+    printf("\n%30s", "Subtest (average per repeat)");
+    for (c = 0; c < NR_PERF_COUNTERS; ++c) {
+        printf(" %11s", perf_counter_name(c));
+    }
+    printf(" %6s\n", "IPC");
+    printf("------------------------------");
+    for (c = 0; c < NR_PERF_COUNTERS; ++c) {
+        printf(" -----------");
+    }
+    printf(" ------\n");
+    for (i = 0; i < nr_subtests; ++i) {
+        printf("PMC %26s", subtest_names[i]);
+        for (c = 0; c < NR_PERF_COUNTERS; ++c) {
+            if (subtest_perf[i][c] < 0) {
+                printf(" %11s", "-");
+            } else {
+                printf(" %11.0f", subtest_perf[i][c] / nr_test_repeats);
+            }
+        }
+        if (subtest_perf[i][0] > 0 && subtest_perf[i][1] > 0) {
+            printf(" %6.2f\n", subtest_perf[i][0] / subtest_perf[i][1]);
+        } else {
+            printf(" %6s\n", "-");
+        }
+    }
+}
+
 /**
  * Prints the clock timing results.
- * @param[in] test               the name of the test
- * @param[in] min, med, max, avg the minimum, median, maximum, average number of clock ticks the test cost
- * @param[in] stdev              the standard deviation of the measured clock ticks in each test repeat
+ * @param[in] test  the name of the test
+ * @param[in] stats the statistics of the number of nanoseconds the test cost
  */
-static void print_clock_timings(const char *test, const clock_t min, const clock_t med, const clock_t max, const clock_t avg, const double stdev) {
-    printf("ms  %26s", test);
-    printf(" %9.3f", min / (CLOCKS_PER_SEC / 1000.0));
-    printf(" %9.3f", med / (CLOCKS_PER_SEC / 1000.0));
-    printf(" %9.3f", max / (CLOCKS_PER_SEC / 1000.0));
-    printf(" %9.3f", avg / (CLOCKS_PER_SEC / 1000.0));
-    if (stdev > 0) printf(" %9.3f", stdev / (CLOCKS_PER_SEC / 1000.0));
+static void print_clock_timings(const char *test, const timing_stats *stats) {
+    printf("us  %26s", test);
+    printf(" %9.2f", (double) stats->min / 1000.0);
+    printf(" %9.2f", (double) stats->med / 1000.0);
+    printf(" %9.2f", (double) stats->max / 1000.0);
+    printf(" %9.2f", (double) stats->avg / 1000.0);
+    printf(" %9.2f", sqrt(stats->var) / 1000.0);
+    printf(" %8u", stats->rejected);
+    printf(" %9.2f", (double) stats->p99 / 1000.0);
+    printf(" %9.2f", (double) stats->p999 / 1000.0);
     printf("\n");
 }
 
@@ -223,115 +377,155 @@ void start_speed_test_suite(const char *suite, const char *names[], const unsign
     start_test_suite(suite);
     nr_subtests = subtests;
     nr_test_repeats = repeats;
-    subtest_cpu = malloc(nr_subtests * sizeof (uint64_t *));
-    subtest_clock = malloc(nr_subtests * sizeof (clock_t *));
+    subtest_cpu = malloc(nr_subtests * sizeof (hdr_histogram *));
+    subtest_time = malloc(nr_subtests * sizeof (hdr_histogram *));
     subtest_names = malloc(nr_subtests * sizeof (char *));
     for (i = 0; i < nr_subtests; ++i) {
-        subtest_cpu[i] = calloc(nr_test_repeats, sizeof (uint64_t));
-        subtest_clock[i] = calloc(nr_test_repeats, sizeof (clock_t));
+        subtest_cpu[i] = hdr_create(1, HIGHEST_TIMING, TIMING_SIGNIFICANT_FIGURES);
+        subtest_time[i] = hdr_create(1, HIGHEST_TIMING, TIMING_SIGNIFICANT_FIGURES);
         subtest_names[i] = malloc(strlen(names[i]) + 1);
 
         strcpy(subtest_names[i], names[i]);
     }
-    subtest_cpu_average = calloc(nr_subtests, sizeof (uint64_t));
-    subtest_clock_average = calloc(nr_subtests, sizeof (clock_t));
+    if (perf_enabled) {
+        subtest_perf = calloc(nr_subtests, sizeof (*subtest_perf));
+    }
+    round2_stats_reset();
+}
+
+unsigned int enable_perf_counters(void) {
+    const unsigned int nr_counters = perf_counters_open();
+    perf_enabled = nr_counters > 0;
+    return nr_counters;
 }
 
 void start_speed_subtest_timing(void) {
-    subtest_clock_start = clock();
-    CPU_CYCLE_COUNT(subtest_cpu_start);
+    if (perf_enabled) {
+        perf_counters_read(subtest_perf_start);
+    }
+    subtest_time_start = now_ns();
+    CPU_CYCLE_COUNT_START(subtest_cpu_start);
 }
 
 void stop_speed_subtest_timing(const unsigned int subtest, const unsigned int repeat_nr) {
-    CPU_CYCLE_COUNT(subtest_cpu[subtest][repeat_nr]);
-    subtest_clock[subtest][repeat_nr] = clock();
-    subtest_cpu[subtest][repeat_nr] -= subtest_cpu_start;
-    subtest_cpu_average[subtest] += subtest_cpu[subtest][repeat_nr];
-    subtest_clock[subtest][repeat_nr] -= subtest_clock_start;
-    subtest_clock_average[subtest] += subtest_clock[subtest][repeat_nr];
+    uint64_t cpu_stop;
+    CPU_CYCLE_COUNT_STOP(cpu_stop);
+    hdr_record(subtest_time[subtest], now_ns() - subtest_time_start);
+    hdr_record(subtest_cpu[subtest], cpu_stop - subtest_cpu_start);
+    (void) repeat_nr;
+    if (perf_enabled) {
+        double perf_stop[NR_PERF_COUNTERS];
+        unsigned int c;
+
+        perf_counters_read(perf_stop);
+        for (c = 0; c < NR_PERF_COUNTERS; ++c) {
+            if (perf_stop[c] < 0 || subtest_perf_start[c] < 0) {
+                subtest_perf[subtest][c] = -1;
+            } else if (subtest_perf[subtest][c] >= 0) {
+                subtest_perf[subtest][c] += perf_stop[c] - subtest_perf_start[c];
+            }
+        }
+    }
 }
 
 void end_speed_test_suite(const char* summary) {
-    unsigned int i, j;
-
-    uint64_t subtest_cpu_median;
-    uint64_t subtest_cpu_var;
-    double subtest_cpu_stdev;
-    uint64_t cpu_minimum = 0;
-    uint64_t cpu_median = 0;
-    uint64_t cpu_maximum = 0;
-    uint64_t cpu_average = 0;
-    uint64_t cpu_var = 0;
-    double cpu_stdev = 0;
-
-    uint64_t subtest_clock_median;
-    uint64_t subtest_clock_var;
-    double subtest_clock_stdev;
-    uint64_t clock_minimum = 0;
-    uint64_t clock_median = 0;
-    uint64_t clock_maximum = 0;
-    uint64_t clock_average = 0;
-    uint64_t clock_var = 0;
-    double clock_stdev = 0;
+    unsigned int i;
+    timing_stats stats;
+    timing_stats cpu_total;
+    timing_stats time_total;
+    round2_stats internal_stats;
 
-    print_timings_header();
-    print_timings_separator();
+    memset(&cpu_total, 0, sizeof (cpu_total));
+    memset(&time_total, 0, sizeof (time_total));
+    round2_stats_snapshot(&internal_stats);
 
+    if (histogram_json != NULL) {
+        fprintf(histogram_json, "{\"suite\": \"%s\", \"subtests\": {", suite_name);
+    }
     for (i = 0; i < nr_subtests; ++i) {
-        qsort(subtest_cpu[i], nr_test_repeats, sizeof (uint64_t), compare_timings);
-        subtest_cpu_median = (nr_test_repeats % 2) ? subtest_cpu[i][nr_test_repeats / 2] : (subtest_cpu[i][nr_test_repeats / 2 - 1] + subtest_cpu[i][nr_test_repeats / 2]) / 2;
-        subtest_cpu_average[i] /= nr_test_repeats;
-        cpu_minimum += subtest_cpu[i][0];
-        cpu_maximum += subtest_cpu[i][nr_test_repeats - 1];
-        cpu_median += subtest_cpu_median;
-        cpu_average += subtest_cpu_average[i];
-        subtest_cpu_var = 0;
-        for (j = 0; j < nr_test_repeats; ++j) {
-            subtest_cpu_var += (subtest_cpu[i][j] - subtest_cpu_average[i]) * (subtest_cpu[i][j] - subtest_cpu_average[i]);
-        }
-        cpu_var += subtest_cpu_var;
-        subtest_cpu_var /= nr_test_repeats;
-        subtest_cpu_stdev = sqrt((double) subtest_cpu_var);
-
-        qsort(subtest_clock[i], nr_test_repeats, sizeof (uint64_t), compare_timings);
-        subtest_clock_median = (nr_test_repeats % 2) ? subtest_clock[i][nr_test_repeats / 2] : (subtest_clock[i][nr_test_repeats / 2 - 1] + subtest_clock[i][nr_test_repeats / 2]) / 2;
-        subtest_clock_average[i] /= nr_test_repeats;
-        clock_minimum += subtest_clock[i][0];
-        clock_maximum += subtest_clock[i][nr_test_repeats - 1];
-        clock_median += subtest_clock_median;
-        clock_average += subtest_clock_average[i];
-        subtest_clock_var = 0;
-        for (j = 0; j < nr_test_repeats; ++j) {
-            subtest_clock_var += (subtest_clock[i][j] - subtest_clock_average[i]) * (subtest_clock[i][j] - subtest_clock_average[i]);
+        print_histograms(subtest_names[i], subtest_cpu[i], subtest_time[i], i == nr_subtests - 1);
+    }
+    if (histogram_json != NULL) {
+        fprintf(histogram_json, "}");
+        if (ROUND2_STATS) {
+            fprintf(histogram_json, ", \"round2_stats\": ");
+            round2_stats_print_json(&internal_stats, histogram_json);
         }
-        clock_var += subtest_clock_var;
-        subtest_clock_var /= nr_test_repeats;
-        subtest_clock_stdev = sqrt((double) subtest_clock_var);
+        fprintf(histogram_json, "}\n");
+        fflush(histogram_json);
+    }
 
-        print_cpu_timings(subtest_names[i], subtest_cpu[i][0], subtest_cpu_median, subtest_cpu[i][nr_test_repeats - 1], subtest_cpu_average[i], subtest_cpu_stdev);
-        print_clock_timings(subtest_names[i], subtest_clock[i][0], subtest_clock_median, subtest_clock[i][nr_test_repeats - 1], subtest_clock_average[i], subtest_clock_stdev);
+    print_timings_header();
+    print_timings_separator();
+
+    for (i = 0; i < nr_subtests; ++i) {
+        compute_timing_stats(&stats, subtest_cpu[i]);
+        print_cpu_timings(subtest_names[i], &stats);
+        cpu_total.min += stats.min;
+        cpu_total.med += stats.med;
+        cpu_total.max += stats.max;
+        cpu_total.avg += stats.avg;
+        cpu_total.var += stats.var;
+        cpu_total.rejected += stats.rejected;
+        cpu_total.p99 += stats.p99;
+        cpu_total.p999 += stats.p999;
+
+        compute_timing_stats(&stats, subtest_time[i]);
+        print_clock_timings(subtest_names[i], &stats);
+        time_total.min += stats.min;
+        time_total.med += stats.med;
+        time_total.max += stats.max;
+        time_total.avg += stats.avg;
+        time_total.var += stats.var;
+        time_total.rejected += stats.rejected;
+        time_total.p99 += stats.p99;
+        time_total.p999 += stats.p999;
     }
 
     if (summary != NULL) {
         print_timings_separator();
-        cpu_var /= nr_test_repeats;
-        cpu_stdev = sqrt((double) cpu_var);
-        clock_var /= nr_test_repeats;
-        clock_stdev = sqrt((double) clock_var);
-        print_cpu_timings(summary, cpu_minimum, cpu_median, cpu_maximum, cpu_average, cpu_stdev);
-        print_clock_timings(summary, clock_minimum, clock_median, clock_maximum, clock_average, clock_stdev);
+        print_cpu_timings(summary, &cpu_total);
+        print_clock_timings(summary, &time_total);
+    }
+    if (perf_enabled) {
+        print_perf_counters();
+    }
+    if (ROUND2_STATS) {
+        printf("\nInternal statistics (round2_stats):\n");
+        round2_stats_print_text(&internal_stats, stdout);
     }
     if (netbeans) printf("%%TEST_FINISHED%% time=%.3f %s (%s)\n", elapsed_from(suite_start_time), suite_name, suite_name);
     if (netbeans) printf("%%SUITE_FINISHED%% time=%.3f\n", elapsed_from(suite_start_time));
     printf("\n");
     for (i = 0; i < nr_subtests; ++i) {
-        free(subtest_cpu[i]);
-        free(subtest_clock[i]);
+        hdr_destroy(subtest_cpu[i]);
+        hdr_destroy(subtest_time[i]);
         free(subtest_names[i]);
     }
     free(subtest_cpu);
-    free(subtest_clock);
+    free(subtest_time);
     free(subtest_names);
-    free(subtest_cpu_average);
-    free(subtest_clock_average);
+    free(subtest_perf);
+    subtest_perf = NULL;
+}
+
+void set_speed_histogram_output(FILE *text, FILE *json) {
+    histogram_text = text;
+    histogram_json = json;
+}
+
+uint64_t clock_ns(void) {
+    return now_ns();
+}
+
+uint64_t cpu_cycles_start(void) {
+    uint64_t cycles;
+    CPU_CYCLE_COUNT_START(cycles);
+    return cycles;
+}
+
+uint64_t cpu_cycles_stop(void) {
+    uint64_t cycles;
+    CPU_CYCLE_COUNT_STOP(cycles);
+    return cycles;
 }
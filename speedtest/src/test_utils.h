@@ -39,6 +39,7 @@
 #ifndef TEST_UTILS_H
 #define TEST_UTILS_H
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 
@@ -55,6 +56,22 @@
         code; \
         stop_speed_subtest_timing(subtest, repeat_nr);
 
+/**
+ * Runs the given code a number of times without timing it, so that caches,
+ * branch predictors, and the clock frequency have settled before the timed
+ * test repeats start.
+ *
+ * @param[in] nr_warm_ups the number of times to run the code
+ * @param[in] code        the code to run
+ */
+#define WARM_UP(nr_warm_ups, code) \
+        { \
+            unsigned int warm_up_; \
+            for (warm_up_ = 0; warm_up_ < (nr_warm_ups); ++warm_up_) { \
+                code; \
+            } \
+        }
+
 /**
  * Calculates the number of elapsed milliseconds since the given start time
  *
@@ -136,12 +153,38 @@ extern "C" {
     void start_speed_test(const char *test);
 
     /**
-     * Starts the cpu cycle timing of a single test repeat of a subtest.
+     * Sets where the histograms of the speed test suites are printed to by
+     * `end_speed_test_suite()`, besides the table of statistics.
+     *
+     * @param[in] text the stream to print the percentile distribution of each
+     *                 subtest to, `NULL` for none
+     * @param[in] json the stream to print the histograms of each suite to, as
+     *                 one JSON object per line, `NULL` for none
+     */
+    void set_speed_histogram_output(FILE *text, FILE *json);
+
+    /**
+     * Enables the capture of hardware performance counters (instructions,
+     * cycles, L1D/LLC read misses, branch misses, and dTLB read misses)
+     * during the timed test repeats of the speed test suites started after
+     * this call. Their averages per test repeat, and the resulting
+     * instructions per cycle, are printed after the timings. Counters that
+     * can not be opened (e.g. not on Linux, no PMU, or not permitted by
+     * `perf_event_paranoid`) are reported on `stderr` and left out.
+     *
+     * @return the number of counters that are captured (0 if none)
+     */
+    unsigned int enable_perf_counters(void);
+
+    /**
+     * Starts the timing of a single test repeat of a subtest. The time is
+     * measured in cpu cycles (serialised `rdtsc`/`rdtscp`) and using the raw
+     * monotonic clock.
      */
     void start_speed_subtest_timing(void);
 
     /**
-     * Stops the cpu cycle timing of a single speed subtest test repeat.
+     * Stops the timing of a single speed subtest test repeat.
      *
      * @param[in] subtest the subtest number
      * @param[in] repeat_nr the number of the test repeat
@@ -157,12 +200,43 @@ extern "C" {
     void done_speed_test(const unsigned int subtest, char *test_name);
 
     /**
-     * Prints the message at the end of the speed test suite.
+     * Prints the message at the end of the speed test suite. For each subtest
+     * the minimum, median, maximum, average and standard deviation are
+     * printed, after rejecting the measurements outside Tukey's fences as
+     * outliers, followed by the 99th and 99.9th percentile of all
+     * measurements. The measurements are kept in HDR histograms (at 3
+     * significant digits), so the number of test repeats is not limited by
+     * memory. If the library is compiled with `ROUND2_STATS`, its internal
+     * statistics since the start of the suite are printed as well.
      * @param[in] summary pointer to a string describing the summary, or NULL if
      *                    no summary should be printed
      */
     void end_speed_test_suite(const char *summary);
 
+    /**
+     * Determines the current time of the raw monotonic clock, for tests that
+     * administrate their timings themselves.
+     *
+     * @return the current time in nanoseconds
+     */
+    uint64_t clock_ns(void);
+
+    /**
+     * Determines the cpu cycle count at the start of a measurement, for tests
+     * that administrate their timings themselves.
+     *
+     * @return the cpu cycle count (serialised `rdtsc`)
+     */
+    uint64_t cpu_cycles_start(void);
+
+    /**
+     * Determines the cpu cycle count at the end of a measurement, for tests
+     * that administrate their timings themselves.
+     *
+     * @return the cpu cycle count (serialised `rdtscp`)
+     */
+    uint64_t cpu_cycles_stop(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2017 Koninklijke Philips N.V. All rights reserved. A
+ * copyright license for redistribution and use in source and binary
+ * forms, with or without modification, is hereby granted for
+ * non-commercial, experimental, research, public review and
+ * evaluation purposes, provided that the following conditions are
+ * met:
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution. If you wish to use this software commercially,
+ *   kindly contact info.licensing@philips.com to obtain a commercial
+ *   license.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @cond DEVELOP
+ * @file
+ * Implementation of the multi-threaded throughput test of the speed tests.
+ *
+ * The worker threads only touch their own state while running: each keeps its
+ * own buffers, operation count and latency histograms. The main thread starts
+ * them together (barrier), sleeps for the duration of the test, and then
+ * raises the stop flag. The latencies are kept in HDR histograms, so the
+ * duration of the test is not limited by memory.
+ *
+ * @endcond
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "throughput.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "api.h"
+#include "cpa_kem.h"
+#include "cca_encrypt.h"
+#include "hdr_histogram.h"
+#include "test_utils.h"
+#include "misc.h"
+
+/*******************************************************************************
+ * Private functions
+ ******************************************************************************/
+
+/** The number of timed operations of a handshake */
+#define NR_OPERATIONS 3
+
+/** The highest latency (in nanoseconds) the histograms can hold */
+#define HIGHEST_LATENCY 1000000000000ULL
+
+/** The names of the timed operations, as used in the output */
+static const char *operation_names[] = {"keygen", "enc", "dec"};
+
+/** The message encrypted by the PKE */
+static const char throughput_message[] = "This is the message to be encrypted.";
+
+/** The state shared by the main thread and the worker threads */
+typedef struct {
+    const parameters *params; /**< The algorithm parameters in use */
+    uint8_t fn; /**< The variant to use for the creation of A */
+    pthread_barrier_t start; /**< Starts the workers together */
+    int stop; /**< Set (atomically) when the workers have to stop */
+} throughput_shared;
+
+/** The state of a worker thread */
+typedef struct {
+    throughput_shared *shared; /**< The shared state */
+    pthread_t thread; /**< The thread */
+    uint64_t handshakes; /**< The number of completed handshakes */
+    unsigned int failures; /**< The number of handshakes with a wrong result */
+    hdr_histogram *latency[NR_OPERATIONS]; /**< The latencies per operation */
+} throughput_worker;
+
+/**
+ * Runs handshakes until the stop flag is raised.
+ *
+ * @param[in,out] arg the state of the worker (`throughput_worker`)
+ * @return `NULL`
+ */
+static void *run_worker(void *arg) {
+    throughput_worker *worker = arg;
+    const parameters *params = worker->shared->params;
+    const uint8_t fn = worker->shared->fn;
+    const int is_kem = CRYPTO_CIPHERTEXTBYTES != 0;
+    const unsigned long long message_len = sizeof (throughput_message);
+    const size_t sk_len = is_kem ? params->sk_size : (size_t) (params->sk_size + params->ss_size + params->pk_size);
+    const size_t ct_len = is_kem ? params->ct_size : (size_t) (params->ct_size + params->ss_size + 16 + 12) + (size_t) message_len;
+    unsigned char *pk = checked_malloc(params->pk_size);
+    unsigned char *sk = checked_malloc(sk_len);
+    unsigned char *ct = checked_malloc(ct_len);
+    unsigned char *ss_r = checked_malloc(params->ss_size);
+    unsigned char *ss_i = checked_malloc(params->ss_size);
+    unsigned char *m = checked_malloc(message_len);
+    unsigned long long c_len, m_len;
+    uint64_t start, t[NR_OPERATIONS];
+    int ok;
+
+    pthread_barrier_wait(&worker->shared->start);
+    while (!__atomic_load_n(&worker->shared->stop, __ATOMIC_RELAXED)) {
+        start = clock_ns();
+        if (is_kem) {
+            crypto_kem_keypair_p(pk, sk, params, fn);
+            t[0] = clock_ns();
+            crypto_kem_enc_p(ct, ss_r, pk, params);
+            t[1] = clock_ns();
+            crypto_kem_dec_p(ss_i, ct, sk, params);
+            t[2] = clock_ns();
+            ok = memcmp(ss_r, ss_i, params->ss_size) == 0;
+        } else {
+            crypto_encrypt_keypair_p(pk, sk, params, fn);
+            t[0] = clock_ns();
+            crypto_encrypt_p(ct, &c_len, (const unsigned char *) throughput_message, message_len, pk, params);
+            t[1] = clock_ns();
+            crypto_encrypt_open_p(m, &m_len, ct, c_len, sk, params);
+            t[2] = clock_ns();
+            ok = m_len == message_len && memcmp(m, throughput_message, message_len) == 0;
+        }
+        hdr_record(worker->latency[0], t[0] - start);
+        hdr_record(worker->latency[1], t[1] - t[0]);
+        hdr_record(worker->latency[2], t[2] - t[1]);
+        ++worker->handshakes;
+        if (!ok) {
+            ++worker->failures;
+        }
+    }
+
+    free(pk);
+    free(sk);
+    free(ct);
+    free(ss_r);
+    free(ss_i);
+    free(m);
+
+    return NULL;
+}
+
+/**
+ * Runs the workers for one number of threads and prints the results.
+ *
+ * @param[in]     params      the algorithm parameters in use
+ * @param[in]     fn          the variant to use for the creation of A
+ * @param[in]     nr_threads  the number of threads
+ * @param[in]     duration_ms the duration of the test in milliseconds
+ * @param[in,out] base_rate   the handshakes per second of a single thread
+ *                            (set when `nr_threads` is 1)
+ * @return the number of failed handshakes
+ */
+static unsigned int run_threads(const parameters *params, const uint8_t fn, const unsigned int nr_threads, const unsigned int duration_ms, double *base_rate) {
+    throughput_shared shared;
+    throughput_worker *workers = checked_calloc(nr_threads, sizeof (*workers));
+    hdr_histogram *total[NR_OPERATIONS];
+    struct timespec duration;
+    uint64_t start, elapsed, handshakes = 0;
+    unsigned int failures = 0, i, op;
+    double rate;
+
+    shared.params = params;
+    shared.fn = fn;
+    shared.stop = 0;
+    pthread_barrier_init(&shared.start, NULL, nr_threads + 1);
+    for (i = 0; i < nr_threads; ++i) {
+        workers[i].shared = &shared;
+        for (op = 0; op < NR_OPERATIONS; ++op) {
+            workers[i].latency[op] = hdr_create(1, HIGHEST_LATENCY, 3);
+        }
+        if (pthread_create(&workers[i].thread, NULL, run_worker, &workers[i])) {
+            fprintf(stderr, "Could not create thread %u\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    duration.tv_sec = duration_ms / 1000;
+    duration.tv_nsec = (long) (duration_ms % 1000) * 1000000L;
+    pthread_barrier_wait(&shared.start);
+    start = clock_ns();
+    while (nanosleep(&duration, &duration)) {
+    }
+    __atomic_store_n(&shared.stop, 1, __ATOMIC_RELAXED);
+    for (i = 0; i < nr_threads; ++i) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    /* The handshakes in progress at the stop are completed, and counted */
+    elapsed = clock_ns() - start;
+    pthread_barrier_destroy(&shared.start);
+
+    for (op = 0; op < NR_OPERATIONS; ++op) {
+        total[op] = hdr_create(1, HIGHEST_LATENCY, 3);
+    }
+    for (i = 0; i < nr_threads; ++i) {
+        handshakes += workers[i].handshakes;
+        failures += workers[i].failures;
+        for (op = 0; op < NR_OPERATIONS; ++op) {
+            hdr_add(total[op], workers[i].latency[op]);
+        }
+    }
+    rate = (double) handshakes * 1e9 / (double) elapsed;
+    if (nr_threads == 1) {
+        *base_rate = rate;
+    }
+
+    printf("%7u %12llu %14.1f %14.1f %8.2f %8u\n", nr_threads, (unsigned long long) handshakes, rate, rate / nr_threads,
+            *base_rate > 0 ? rate / (*base_rate * nr_threads) : 0.0, failures);
+    printf("  Thread");
+    for (op = 0; op < NR_OPERATIONS; ++op) {
+        printf(" %7s p50 %7s p99", operation_names[op], operation_names[op]);
+    }
+    printf("  (us)\n");
+    for (i = 0; i < nr_threads; ++i) {
+        printf("  %6u", i);
+        for (op = 0; op < NR_OPERATIONS; ++op) {
+            printf(" %11.1f %11.1f", (double) hdr_value_at_percentile(workers[i].latency[op], 50) / 1000.0,
+                    (double) hdr_value_at_percentile(workers[i].latency[op], 99) / 1000.0);
+        }
+        printf("\n");
+    }
+    for (op = 0; op < NR_OPERATIONS; ++op) {
+        printf("\n  %s latency (us) over all threads:\n", operation_names[op]);
+        hdr_print_text(total[op], stdout, 1000.0, 1);
+        hdr_destroy(total[op]);
+    }
+    printf("\n");
+
+    for (i = 0; i < nr_threads; ++i) {
+        for (op = 0; op < NR_OPERATIONS; ++op) {
+            hdr_destroy(workers[i].latency[op]);
+        }
+    }
+    free(workers);
+
+    return failures;
+}
+
+/*******************************************************************************
+ * Public functions
+ ******************************************************************************/
+
+unsigned int speedtest_throughput(const parameters *params, const uint8_t fn, unsigned int max_threads, const unsigned int duration_ms) {
+    unsigned int nr_failed = 0;
+    unsigned int nr_threads;
+    double base_rate = 0;
+
+    if (max_threads == 0) {
+        const long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        max_threads = nr_cpus > 0 ? (unsigned int) nr_cpus : 1;
+    }
+
+    printf("Throughput with up to %u threads, %u ms per number of threads\n\n", max_threads, duration_ms);
+    printf("%7s %12s %14s %14s %8s %8s\n", "Threads", "Handshakes", "Handshakes/s", "Per thread/s", "Scaling", "Failures");
+    for (nr_threads = 1; nr_threads <= max_threads; nr_threads = nr_threads < max_threads && 2 * nr_threads > max_threads ? max_threads : 2 * nr_threads) {
+        nr_failed += run_threads(params, fn, nr_threads, duration_ms, &base_rate);
+        if (nr_threads == max_threads) {
+            break;
+        }
+    }
+
+    return nr_failed;
+}